@@ -0,0 +1,18 @@
+#ifndef PIKSI_ALLOC_COUNTER_HPP
+#define PIKSI_ALLOC_COUNTER_HPP
+
+#include <libsbp/common.h>
+
+namespace piksi {
+
+#ifdef PIKSI_ALLOC_COUNTER
+// Debug builds (cmake -DPIKSI_ALLOC_COUNTER=ON) replace the global operator
+// new with one that counts. Only C++ allocations are seen: malloc() from C
+// libraries (zenoh-c, libserialport) goes around it.
+u64 thread_allocations(); // by the calling thread since it started
+u64 total_allocations();  // by the whole process
+#endif
+
+} // namespace piksi
+
+#endif
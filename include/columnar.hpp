@@ -0,0 +1,138 @@
+#ifndef PIKSI_COLUMNAR_HPP
+#define PIKSI_COLUMNAR_HPP
+
+#include "piksi_data.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace piksi {
+
+// Columnar log (log_format=columnar, ".pcol"): PiksiData fields stored column
+// by column in blocks of rows, so a reader maps the file and touches only the
+// blocks and columns it asks for. Little-endian; append-only, a block at a
+// time, so a file cut short by a crash loses at most its last block.
+//
+// File header, written once per file:
+//
+//   offset  type      field
+//        0  char[4]   magic "PCOL"
+//        4  u16       version
+//        6  u16       column count
+//        8            per column: u8 type (ColumnType), u8 name length, name
+//                     zero padding to a multiple of 8
+//
+// Then blocks, each a header followed by its columns in schema order, each
+// column `rows` values wide and zero-padded to a multiple of 8 bytes:
+//
+//   offset  type      field
+//        0  char[4]   magic "PCBK"
+//        4  u32       rows
+//        8  u64       block size in bytes, header included
+//       16  f64       t_min  (record_time() of the rows, Unix seconds)
+//       24  f64       t_max
+//       32            columns
+//
+// The block headers are the file's sparse time index: a reader hops from
+// header to header by block size, then binary-searches t_min/t_max.
+constexpr u16 kColumnarVersion = 1;
+constexpr size_t kColumnarBlockHeaderSize = 32;
+constexpr size_t kColumnarBlockRows = 1024; // rows per block unless flushed early
+
+enum class ColumnType : u8 { kF64, kF32, kU8, kU16, kU32, kS32, kS64, kBool };
+size_t column_width(ColumnType type);
+
+struct Column {
+    const char* name; // the CSV/JSON field name (lat, S_llh_h, host_real_ns, ...)
+    ColumnType type;
+    size_t offset;    // in PiksiData
+};
+
+// The columns written by this version, in file order.
+const std::vector<Column>& columnar_schema();
+
+// Time a record is indexed by: utc_timestamp, or the host wall clock when the
+// receiver has not provided UTC yet.
+double record_time(const PiksiData& data);
+
+// File header for the current schema.
+std::string columnar_header();
+// Appends one block holding rows[0..n) to out.
+void append_columnar_block(std::string& out, const PiksiData* rows, size_t n);
+
+// Read-only view of a columnar log through mmap. Columns are looked up by
+// name, so files written by other versions read as long as the names match.
+class ColumnarReader {
+public:
+    struct Block {
+        size_t offset; // of the block header in the file
+        u32 rows;
+        double t_min, t_max;
+        u64 first_row; // rows in the blocks before this one
+    };
+
+    ColumnarReader() = default;
+    ~ColumnarReader();
+    ColumnarReader(const ColumnarReader&) = delete;
+    ColumnarReader& operator=(const ColumnarReader&) = delete;
+
+    // False (with a message on stderr) if the file cannot be mapped or is not a columnar log.
+    bool open(const std::string& path);
+    void close();
+
+    const std::vector<Block>& blocks() const { return blocks_; }
+    u64 rows() const { return rows_; }
+    // Bytes after the last complete block (a torn write), ignored.
+    size_t trailing_bytes() const { return trailing_; }
+    size_t column_count() const { return columns_.size(); }
+    const std::string& column_name(size_t column) const { return columns_[column].name; }
+    ColumnType column_type(size_t column) const { return columns_[column].type; }
+    // Index of the named column; -1 if the file does not have it.
+    int find_column(const std::string& name) const;
+
+    // Earliest and latest record time in the file (0 with no blocks).
+    double t_min() const { return t_min_; }
+    double t_max() const { return t_max_; }
+    // False if block times ever go backwards, e.g. a host clock that was
+    // wrong until UTC arrived (record_time() switches source then).
+    bool time_ordered() const { return time_ordered_; }
+
+    // Blocks [first, last) spanning every block that overlaps [t_from, t_to].
+    // When the file is not time_ordered(), blocks in between may not overlap,
+    // so rows still need filtering by time.
+    void blocks_in_range(double t_from, double t_to, size_t* first, size_t* last) const;
+
+    // One value of a column, widened to double (exact for every type but s64
+    // beyond 2^53; use value_s64() for host timestamps).
+    double value(size_t block, size_t column, u32 row) const;
+    s64 value_s64(size_t block, size_t column, u32 row) const;
+    // A whole f64 column of a block, straight from the map (columns are 8-byte
+    // aligned), for batch work; nullptr for other column types.
+    const double* column_f64(size_t block, size_t column) const;
+    // Rebuilds a whole record; fields missing from the file are zero.
+    void read_row(size_t block, u32 row, PiksiData* data) const;
+
+private:
+    struct FileColumn {
+        std::string name;
+        ColumnType type;
+        int schema_index; // into columnar_schema(), -1 if unknown to this version
+    };
+
+    int fd_ = -1;
+    const u8* map_ = nullptr;
+    size_t size_ = 0;
+    std::vector<FileColumn> columns_;
+    std::vector<Block> blocks_;
+    u64 rows_ = 0;
+    size_t trailing_ = 0;
+    double t_min_ = 0.0;
+    double t_max_ = 0.0;
+    bool time_ordered_ = true;
+
+    const u8* column_data(size_t block, size_t column) const;
+};
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef PIKSI_CORRECTIONS_HPP
+#define PIKSI_CORRECTIONS_HPP
+
+#include "histogram.hpp"
+#include "transport.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace piksi {
+
+struct CorrectionOptions {
+    std::string key;                     // Zenoh key expression; empty: no forwarding
+    size_t queue_bytes = 16 * 1024;      // beyond this the oldest queued corrections are dropped
+    int max_age_ms = 2000;               // corrections queued longer than this are dropped unsent
+    LatencyHistogram* latency = nullptr; // arrival on Zenoh -> written to the port
+};
+
+struct CorrectionStats {
+    u64 received;         // payloads from Zenoh
+    u64 forwarded;        // payloads written to the receiver in full
+    u64 bytes;            // bytes written
+    u64 dropped;          // payloads dropped from a full queue or for being stale
+    u64 write_errors;     // payloads not written at all, e.g. while the link is down
+    u64 truncated;        // payloads cut short by a stalled port or a link drop
+    u64 queue_bytes;      // waiting now
+    u64 queue_max_bytes;  // high-water mark
+    double last_s;        // since the last payload arrived; -1 before the first
+    double receiver_age_s; // age of the corrections the receiver uses (MSG_AGE_CORRECTIONS); -1 if unknown
+};
+
+// Forwards base-station corrections (RTCM3 messages or SBP observation
+// frames, passed through as they arrive) from Zenoh to the receiver.
+//
+// push() runs on Zenoh's thread and only queues. A writer thread drains the
+// queue through the transport, so a slow or saturated UART never holds up
+// decoding; when the queue is full the oldest corrections make room, since a
+// receiver has no use for stale ones.
+class CorrectionForwarder {
+public:
+    explicit CorrectionForwarder(const CorrectionOptions& options);
+    ~CorrectionForwarder();
+    CorrectionForwarder(const CorrectionForwarder&) = delete;
+    CorrectionForwarder& operator=(const CorrectionForwarder&) = delete;
+
+    // Writes through `transport` until stop(), which must come before the
+    // transport is destroyed.
+    void start(Transport& transport);
+    void stop();
+    void push(std::vector<u8> bytes);
+    // Age from MSG_AGE_CORRECTIONS, in deciseconds (0xFFFF: none).
+    void set_receiver_age(u16 age_ds) { receiver_age_ds_.store(age_ds, std::memory_order_relaxed); }
+    CorrectionStats stats() const;
+
+private:
+    struct Entry {
+        std::vector<u8> bytes;
+        s64 received_ns; // CLOCK_MONOTONIC
+    };
+
+    CorrectionOptions options_;
+    Transport* transport_ = nullptr;
+    std::deque<Entry> queue_;
+    size_t queued_bytes_ = 0;
+    std::thread writer_;
+    bool running_ = false;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+
+    std::atomic<u64> received_{0};
+    std::atomic<u64> forwarded_{0};
+    std::atomic<u64> bytes_{0};
+    std::atomic<u64> dropped_{0};
+    std::atomic<u64> write_errors_{0};
+    std::atomic<u64> truncated_{0};
+    std::atomic<u64> queue_max_bytes_{0};
+    std::atomic<s64> last_ns_{0};
+    std::atomic<u16> receiver_age_ds_{0xFFFF};
+
+    void run();
+};
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef PIKSI_DASHBOARD_HPP
+#define PIKSI_DASHBOARD_HPP
+
+#include <libsbp/common.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace piksi {
+
+class PiksiMultiGPS;
+
+struct DashboardOptions {
+    int refresh_hz = 4; // 0: no console output
+    // Redraw in place with ANSI cursor movement. Only when stdout is a
+    // terminal; otherwise one frame is appended per refresh.
+    bool in_place = true;
+};
+
+// Console view of one or more receivers, rendered on its own thread.
+//
+// Every refresh copies each receiver's latest solution snapshot and its
+// counters (all lock-free reads) and writes the whole frame to stdout at
+// once. A slow terminal therefore only delays this thread; the
+// reader threads never wait on the console, and solutions arriving between
+// refreshes are simply not drawn.
+class Dashboard {
+public:
+    Dashboard(std::vector<const PiksiMultiGPS*> receivers, const DashboardOptions& options);
+    ~Dashboard();
+    Dashboard(const Dashboard&) = delete;
+    Dashboard& operator=(const Dashboard&) = delete;
+
+    void start();
+    // Draws a last frame and leaves the cursor below it.
+    void stop();
+
+private:
+    struct ReceiverView {
+        u64 version = 0;       // last solution drawn
+        s64 version_ns = 0;    // when it was first seen (CLOCK_MONOTONIC)
+        u64 rate_version = 0;  // solutions counted at the last rate sample
+        s64 rate_ns = 0;
+        double rate = 0.0;     // solutions per second seen by this process
+    };
+
+    std::vector<const PiksiMultiGPS*> receivers_;
+    std::vector<ReceiverView> views_;
+    DashboardOptions options_;
+    bool color_ = false;
+    int lines_ = 0; // lines of the frame on screen, to move back over
+    std::string frame_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    void run();
+    void render(s64 now_ns);
+    void render_receiver(const PiksiMultiGPS& gps, ReceiverView& view, s64 now_ns);
+    void line(const char* format, ...);
+    void flush();
+};
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef PIKSI_EPOCH_ASSEMBLER_HPP
+#define PIKSI_EPOCH_ASSEMBLER_HPP
+
+#include <libsbp/common.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace piksi {
+
+// Message slices that make up one solution epoch.
+enum EpochPart : u8 {
+    kPartUtc = 1 << 0,
+    kPartLlh = 1 << 1,
+    kPartEcef = 1 << 2,
+    kPartVel = 1 << 3,
+    kPartBaseline = 1 << 4,
+};
+constexpr u8 kAllEpochParts = kPartUtc | kPartLlh | kPartEcef | kPartVel | kPartBaseline;
+
+// Parses a comma separated list such as "utc,llh,ecef,vel,baseline"; 0 if invalid.
+u8 parse_epoch_parts(const std::string& list);
+
+struct EpochStats {
+    u64 complete; // every expected part arrived
+    u64 partial;  // emitted on deadline or when the next epoch started
+    u64 late;     // configured messages for an epoch that was already emitted
+};
+
+// Tracks which parts of the open epoch (keyed by GPS time of week) have
+// arrived and decides when the epoch is emitted. An epoch is complete when
+// every configured part that was present in the previous epoch has arrived,
+// so a part the receiver stops sending (e.g. the baseline after losing the
+// base station) only costs one partial epoch.
+//
+// Parts left out of the configured set never hold an epoch back. One that
+// arrives after its epoch was emitted is dropped like a late part, since it
+// would otherwise land in the next epoch's record, but it is not counted late.
+class EpochAssembler {
+public:
+    enum Arrival { kCurrent, kNewer, kLate };
+
+    using Clock = std::chrono::steady_clock;
+
+    void configure(u8 parts, std::chrono::milliseconds timeout);
+
+    // Classifies a message of the given part for epoch `tow`.
+    Arrival classify(u32 tow, u8 part);
+    void open_epoch(u32 tow, Clock::time_point now);
+    // Marks part received; true when the epoch is complete.
+    bool add(u8 part);
+    bool expired(Clock::time_point now) const;
+    // Closes the open epoch after it has been emitted.
+    void close_epoch();
+
+    bool is_open() const { return open_; }
+    u32 tow() const { return tow_; }
+    u8 parts() const { return parts_; }
+    EpochStats stats() const;
+
+private:
+    u8 configured_ = kAllEpochParts;
+    std::chrono::milliseconds timeout_{50};
+    bool open_ = false;
+    bool emitted_any_ = false;
+    u32 tow_ = 0;
+    u32 last_tow_ = 0;
+    u8 parts_ = 0;
+    u8 last_parts_ = kAllEpochParts;
+    Clock::time_point opened_at_;
+    std::atomic<u64> complete_{0};
+    std::atomic<u64> partial_{0};
+    std::atomic<u64> late_{0};
+};
+
+} // namespace piksi
+
+#endif
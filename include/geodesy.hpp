@@ -0,0 +1,66 @@
+#ifndef PIKSI_GEODESY_HPP
+#define PIKSI_GEODESY_HPP
+
+#include <cstddef>
+
+namespace piksi {
+
+// WGS-84 ellipsoid.
+constexpr double kWgs84A = 6378137.0;
+constexpr double kWgs84F = 1.0 / 298.257223563;
+constexpr double kWgs84E2 = kWgs84F * (2.0 - kWgs84F); // first eccentricity squared
+
+// Latitude and longitude in degrees and height in metres, as in PiksiData.
+void llh_to_ecef(double lat_deg, double lon_deg, double h, double ecef[3]);
+// Iterated to well below a micrometre from 1000 km below the surface out to
+// geostationary height (not deeper: it converges slowly there). This is the
+// reference the batch version below is checked against.
+void ecef_to_llh(const double ecef[3], double* lat_deg, double* lon_deg, double* h);
+
+// Batches in structure-of-arrays form: n points, one array per coordinate,
+// for logs (a columnar block is already laid out this way) and bulk
+// conversions. Outputs may be the input arrays, for conversion in place.
+void llh_to_ecef(const double* lat_deg, const double* lon_deg, const double* h, size_t n,
+                 double* x, double* y, double* z);
+// Closed form (Vermeille 2002) rather than iterated: no trigonometry until
+// the final arctangents. Round-trips llh_to_ecef() to a few tens of
+// nanometres, poles included, from ~50 km off the Earth's centre out to
+// geostationary height (not within ~45 km of the centre), and agrees with
+// ecef_to_llh() as closely wherever that converges. test/geodesy_test.cpp
+// checks both.
+void ecef_to_llh(const double* x, const double* y, const double* z, size_t n,
+                 double* lat_deg, double* lon_deg, double* h);
+
+// Local tangent plane at a reference point, as north-east-down or
+// east-north-up.
+struct LocalFrame {
+    double origin[3]; // ECEF of the reference point
+    double r[3][3];   // ECEF -> NED rotation, rows north, east, down
+
+    static LocalFrame at(double lat_deg, double lon_deg, double h);
+
+    void ecef_to_ned(const double ecef[3], double ned[3]) const;
+    void ned_to_ecef(const double ned[3], double ecef[3]) const;
+    void ecef_to_enu(const double ecef[3], double enu[3]) const;
+    void enu_to_ecef(const double enu[3], double ecef[3]) const;
+
+    // Batch versions: AVX2 when the CPU has it (see geodesy_simd()).
+    void ecef_to_ned(const double* x, const double* y, const double* z, size_t n,
+                     double* north, double* east, double* down) const;
+    void ned_to_ecef(const double* north, const double* east, const double* down, size_t n,
+                     double* x, double* y, double* z) const;
+    void ecef_to_enu(const double* x, const double* y, const double* z, size_t n,
+                     double* east, double* north, double* up) const;
+    void enu_to_ecef(const double* east, const double* north, const double* up, size_t n,
+                     double* x, double* y, double* z) const;
+};
+
+// Name of the kernels the batch rotations run on ("avx2" or "scalar").
+const char* geodesy_simd();
+// Forces the portable kernels (false) or restores the best available (true),
+// to compare the two; returns the kernels now in use.
+const char* set_geodesy_simd(bool enabled);
+
+} // namespace piksi
+
+#endif
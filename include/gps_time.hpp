@@ -0,0 +1,106 @@
+#ifndef PIKSI_GPS_TIME_HPP
+#define PIKSI_GPS_TIME_HPP
+
+#include <libsbp/common.h>
+#include <ctime>
+
+namespace piksi {
+
+// Civil date to days since 1970-01-01 (proleptic Gregorian), after
+// H. Hinnant's days_from_civil. No time zone, no locale, no allocation.
+constexpr s64 days_from_civil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const s64 era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<s64>(doe) - 719468;
+}
+
+// UTC calendar time to UNIX seconds.
+constexpr s64 unix_seconds(int year, unsigned month, unsigned day,
+                           unsigned hours, unsigned minutes, unsigned seconds) {
+    return days_from_civil(year, month, day) * 86400 + hours * 3600 + minutes * 60 + seconds;
+}
+
+constexpr s64 kGpsEpochUnix = unix_seconds(1980, 1, 6, 0, 0, 0);
+constexpr s64 kSecondsPerWeek = 604800;
+
+// GPS - UTC offset, with the UTC instant from which each value applies.
+// Extend this table when IERS announces a new leap second.
+struct LeapSecond {
+    s64 utc_unix;
+    int offset;
+};
+
+constexpr LeapSecond kLeapSeconds[] = {
+    {unix_seconds(1981, 7, 1, 0, 0, 0), 1},  {unix_seconds(1982, 7, 1, 0, 0, 0), 2},
+    {unix_seconds(1983, 7, 1, 0, 0, 0), 3},  {unix_seconds(1985, 7, 1, 0, 0, 0), 4},
+    {unix_seconds(1988, 1, 1, 0, 0, 0), 5},  {unix_seconds(1990, 1, 1, 0, 0, 0), 6},
+    {unix_seconds(1991, 1, 1, 0, 0, 0), 7},  {unix_seconds(1992, 7, 1, 0, 0, 0), 8},
+    {unix_seconds(1993, 7, 1, 0, 0, 0), 9},  {unix_seconds(1994, 7, 1, 0, 0, 0), 10},
+    {unix_seconds(1996, 1, 1, 0, 0, 0), 11}, {unix_seconds(1997, 7, 1, 0, 0, 0), 12},
+    {unix_seconds(1999, 1, 1, 0, 0, 0), 13}, {unix_seconds(2006, 1, 1, 0, 0, 0), 14},
+    {unix_seconds(2009, 1, 1, 0, 0, 0), 15}, {unix_seconds(2012, 7, 1, 0, 0, 0), 16},
+    {unix_seconds(2015, 7, 1, 0, 0, 0), 17}, {unix_seconds(2017, 1, 1, 0, 0, 0), 18},
+};
+
+// Leap seconds between GPS time and UTC at a GPS instant (seconds since the GPS epoch).
+constexpr int gps_utc_offset(s64 gps_seconds) {
+    int offset = 0;
+    for (const LeapSecond& leap : kLeapSeconds) {
+        // The GPS reading at the moment a leap second takes effect.
+        if (gps_seconds >= leap.utc_unix - kGpsEpochUnix + leap.offset) {
+            offset = leap.offset;
+        }
+    }
+    return offset;
+}
+
+// GPS week / time of week (MSG_GPS_TIME) to UNIX seconds in UTC.
+constexpr double gps_to_unix(u16 week, u32 tow_ms, s32 ns_residual) {
+    const s64 gps_ms = static_cast<s64>(week) * kSecondsPerWeek * 1000 + tow_ms;
+    const s64 gps_seconds = gps_ms / 1000;
+    return static_cast<double>(kGpsEpochUnix + gps_seconds - gps_utc_offset(gps_seconds)) +
+           (gps_ms % 1000) * 1e-3 + ns_residual * 1e-9;
+}
+
+static_assert(days_from_civil(1970, 1, 1) == 0, "UNIX epoch");
+static_assert(kGpsEpochUnix == 315964800, "GPS epoch");
+static_assert(gps_utc_offset(unix_seconds(2024, 1, 1, 0, 0, 0) - kGpsEpochUnix) == 18, "leap seconds");
+
+// Host clocks sampled together when bytes come off the wire.
+struct HostTime {
+    s64 mono_ns; // CLOCK_MONOTONIC
+    s64 real_ns; // CLOCK_REALTIME
+};
+
+inline s64 clock_ns(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<s64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+inline HostTime host_now() {
+    return {clock_ns(CLOCK_MONOTONIC), clock_ns(CLOCK_REALTIME)};
+}
+
+// Time of day of a UNIX timestamp, as in PiksiData's UTC fields.
+struct TimeOfDay {
+    u8 hr, min, sec;
+    double ms;
+};
+
+inline TimeOfDay time_of_day(double unix_seconds) {
+    s64 whole = static_cast<s64>(unix_seconds);
+    if (static_cast<double>(whole) > unix_seconds) {
+        whole--;
+    }
+    s64 day_seconds = whole % 86400;
+    return {static_cast<u8>(day_seconds / 3600), static_cast<u8>(day_seconds / 60 % 60),
+            static_cast<u8>(day_seconds % 60), (unix_seconds - static_cast<double>(whole)) * 1e3};
+}
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef PIKSI_HISTOGRAM_HPP
+#define PIKSI_HISTOGRAM_HPP
+
+#include <libsbp/common.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace piksi {
+
+// Latency histogram with HDR-style log-linear buckets: every power of two is
+// split into 64 sub-buckets, so any recorded value is known to within 1.6%
+// from 1 ns up to ~18 minutes, in a fixed 17.5 KiB table. record() is a
+// single relaxed increment and may run on any thread; readers copy the
+// counts and compute percentiles off the hot path.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 7;  // values below 2^7 get one bucket each
+    static constexpr int kMaxBits = 40; // larger values are clamped
+    static constexpr size_t kHalf = size_t(1) << (kSubBits - 1);
+    static constexpr size_t kBuckets = (kMaxBits - kSubBits + 2) * kHalf;
+    using Counts = std::array<u64, kBuckets>;
+
+    void record(s64 ns) {
+        counts_[bucket(ns < 0 ? 0 : static_cast<u64>(ns))].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void snapshot(Counts& out) const {
+        for (size_t i = 0; i < kBuckets; ++i) {
+            out[i] = counts_[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    static size_t bucket(u64 value) {
+        if (value >= (u64(1) << kMaxBits)) {
+            value = (u64(1) << kMaxBits) - 1;
+        }
+        if (value < 2 * kHalf) {
+            return static_cast<size_t>(value);
+        }
+        int shift = (63 - __builtin_clzll(value)) - (kSubBits - 1);
+        return (shift + 1) * kHalf + static_cast<size_t>((value >> shift) - kHalf);
+    }
+
+    // Largest value that falls into bucket i.
+    static u64 bucket_max(size_t i) {
+        if (i < 2 * kHalf) {
+            return i;
+        }
+        int shift = static_cast<int>(i / kHalf) - 1;
+        u64 sub = i % kHalf + kHalf;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    static u64 total(const Counts& counts) {
+        u64 n = 0;
+        for (u64 c : counts) {
+            n += c;
+        }
+        return n;
+    }
+
+    // Value at quantile q (0..1) of the counts, rounded up to its bucket; 0 when empty.
+    static u64 percentile(const Counts& counts, double q) {
+        u64 n = total(counts);
+        if (n == 0) {
+            return 0;
+        }
+        u64 rank = static_cast<u64>(q * static_cast<double>(n - 1)) + 1;
+        u64 seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return bucket_max(i);
+            }
+        }
+        return bucket_max(kBuckets - 1);
+    }
+
+private:
+    std::array<std::atomic<u64>, kBuckets> counts_{};
+};
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef PIKSI_HISTORY_HPP
+#define PIKSI_HISTORY_HPP
+
+#include "piksi_data.hpp"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace piksi {
+
+enum class TimeBase {
+    kGps,  // GPS time of the epoch: week and tow, as gps_time_ns()
+    kHost, // host CLOCK_MONOTONIC at the epoch's first byte (host_mono_ns)
+};
+
+enum class Interpolation {
+    // Straight line between the two epochs around the query.
+    kLinear,
+    // Cubic through both positions with the reported velocities as slopes, so
+    // a turn between epochs is followed; linear where an epoch has no VEL_NED.
+    kHermite,
+};
+
+// The last `capacity` epochs, written by the decoding thread and read from
+// any thread, for fusing GPS with sensors stamped at other times.
+//
+// Each slot sits behind its own seqlock, tagged with the epoch's index, so
+// push() never waits and a reader that loses a slot to the writer mid-query
+// simply searches again. Lookups binary-search the ring, O(log capacity).
+class SolutionHistory {
+public:
+    // max_gap_ms: no interpolation between epochs further apart than this.
+    explicit SolutionHistory(size_t capacity, int max_gap_ms = 1000);
+    SolutionHistory(const SolutionHistory&) = delete;
+    SolutionHistory& operator=(const SolutionHistory&) = delete;
+
+    // Writer side, one thread. Epochs must arrive in GPS time order; one that
+    // does not (a new replay, a receiver reset) starts the history afresh.
+    void push(const PiksiData& data);
+
+    // The solution at time t (ns in the given base): the epoch itself on an
+    // exact match, else interpolated between the epochs either side of t.
+    // Position, ECEF, baseline, local frame, velocity, accuracies and time
+    // fields are interpolated; status, satellites and flags come from the
+    // nearer epoch.
+    // False outside the span held, across a gap, or if the writer kept
+    // overwriting the slots needed.
+    bool at(TimeBase base, s64 t, PiksiData& out, Interpolation mode = Interpolation::kHermite) const;
+    // Oldest and newest times held; false while empty.
+    bool span(TimeBase base, s64& oldest, s64& newest) const;
+    // Epochs held (at most capacity()).
+    size_t size() const;
+    size_t capacity() const { return capacity_; }
+
+    // GPS time as ns since the GPS epoch; tow alone while the week is unknown (0).
+    static s64 gps_time_ns(u16 week, u32 tow_ms);
+
+private:
+    struct Slot {
+        std::atomic<u64> seq{0}; // 2 * (index + 1) when holding epoch `index`, odd while written
+        std::atomic<s64> gps_ns{0};
+        std::atomic<s64> host_ns{0};
+        PiksiData data;
+    };
+
+    size_t capacity_;
+    s64 max_gap_ns_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<u64> head_{0};  // epochs pushed
+    std::atomic<u64> first_{0}; // index of the oldest epoch since the last restart
+    s64 last_gps_ns_ = 0;       // writer's copy
+
+    bool read_key(u64 index, TimeBase base, s64& key) const;
+    bool read_data(u64 index, PiksiData& out) const;
+    static void interpolate(const PiksiData& a, const PiksiData& b, double u, double dt, Interpolation mode,
+                            PiksiData& out);
+};
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef PIKSI_IMU_HPP
+#define PIKSI_IMU_HPP
+
+#include "gps_time.hpp"
+#include <libsbp/common.h>
+#include <libsbp/legacy/imu.h>
+#include <cmath>
+
+namespace piksi {
+
+// One IMU_RAW sample in SI units.
+struct ImuSample {
+    s64 host_mono_ns; // Host CLOCK_MONOTONIC at the first byte of the frame
+    s64 host_real_ns; // Host CLOCK_REALTIME at the first byte of the frame
+    u32 tow;          // Receiver time (ms), time status bits removed
+    u8 tow_f;         // Fraction of a ms (1/256 ms)
+    u8 time_status;   // 0: GPS time of week, 1: since startup, 2: unknown, 3: last PPS
+    float acc[3];     // Acceleration x, y, z (m/s^2)
+    float gyr[3];     // Angular rate x, y, z (rad/s)
+};
+
+// Sensor type and ranges from the latest IMU_AUX; the defaults match the
+// Piksi Multi's BMI160 out of the box (+-8 g, +-1000 deg/s).
+struct ImuInfo {
+    u8 imu_type = 0;         // 0: Bosch BMI160, 1: ST ASM330LLH
+    u8 imu_conf = 0x12;      // bits 0-3: accelerometer range, bits 4-7: gyroscope range
+    float temperature = NAN; // deg C, NaN until the first IMU_AUX
+
+    float acc_scale() const; // m/s^2 per LSB
+    float gyr_scale() const; // rad/s per LSB
+};
+
+void apply_imu_aux(const msg_imu_aux_t& aux, ImuInfo* info);
+ImuSample scale_imu_raw(const msg_imu_raw_t& raw, const ImuInfo& info, const HostTime& rx);
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef PIKSI_LINK_MONITOR_HPP
+#define PIKSI_LINK_MONITOR_HPP
+
+#include <libsbp/common.h>
+#include <atomic>
+
+namespace piksi {
+
+enum class LinkState : u8 {
+    kUp,     // frames are arriving
+    kDown,   // port closed, waiting for the next reopen attempt
+    kResync, // port reopened, waiting for the first frame
+};
+const char* link_state_name(LinkState state);
+
+struct LinkOptions {
+    bool reconnect = true;    // false: a lost link ends acquisition
+    int timeout_ms = 3000;    // no heartbeat for this long counts as a lost link (0 = never)
+    int backoff_min_ms = 20;  // wait before the second reopen attempt, doubled per failure
+    int backoff_max_ms = 250;
+};
+
+struct LinkStats {
+    LinkState state;
+    u64 drops;              // times the link was lost (read error, hangup or heartbeat timeout)
+    u64 heartbeat_timeouts; // of those, from the heartbeat watchdog
+    u64 reconnects;         // reopened and receiving again
+    u64 failed_opens;       // reopen attempts that failed
+    double last_outage_s;   // last byte before the drop to the first frame after it
+    double max_outage_s;
+    double total_outage_s;
+};
+
+// Connection state machine for a serial receiver. The reader thread reports
+// heartbeats, frames, drops and reopen results and asks when to try next;
+// the policy (watchdog, exponential backoff) and the accounting live here.
+// stats() may be called from any thread.
+class LinkMonitor {
+public:
+    void configure(const LinkOptions& options) { options_ = options; }
+    const LinkOptions& options() const { return options_; }
+    LinkState state() const { return state_.load(std::memory_order_relaxed); }
+
+    void heartbeat(s64 now_ns) { last_heartbeat_ns_ = now_ns; }
+    // A valid frame arrived; ends an outage in progress.
+    void frame(s64 now_ns);
+    // True when the link is open but heartbeats stopped.
+    bool timed_out(s64 now_ns) const;
+    // The port failed or went silent. last_rx_ns: when its last bytes arrived.
+    void lost(s64 last_rx_ns, s64 now_ns, bool heartbeat_timeout);
+    // The port could not be opened at startup; retried like a lost link, but
+    // the first connection is not counted as a reconnect.
+    void unavailable(s64 now_ns);
+    // First reopen is immediate; each failure doubles the wait up to the maximum.
+    s64 next_attempt_ns() const { return next_attempt_ns_; }
+    void open_failed(s64 now_ns);
+    void reopened(s64 now_ns);
+
+    LinkStats stats() const;
+
+private:
+    LinkOptions options_;
+    std::atomic<LinkState> state_{LinkState::kUp};
+    s64 last_heartbeat_ns_ = 0;
+    s64 outage_start_ns_ = 0; // 0: never connected
+    s64 next_attempt_ns_ = 0;
+    s64 backoff_ns_ = 0;
+    std::atomic<u64> drops_{0};
+    std::atomic<u64> heartbeat_timeouts_{0};
+    std::atomic<u64> reconnects_{0};
+    std::atomic<u64> failed_opens_{0};
+    std::atomic<s64> last_outage_ns_{0};
+    std::atomic<s64> max_outage_ns_{0};
+    std::atomic<s64> total_outage_ns_{0};
+};
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef PIKSI_LOGGER_HPP
+#define PIKSI_LOGGER_HPP
+
+#include "piksi_data.hpp"
+#include "histogram.hpp"
+#include "rotating_file.hpp"
+#include "spsc_ring.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace piksi {
+
+enum class LogFormat {
+    kCsv,    // same columns as the original piksi_gps CSV
+    kBinary, // concatenated encode_binary() records
+    kColumnar, // blocks of columns with a time index (see columnar.hpp)
+};
+
+// Parses "csv", "binary" or "columnar"; false if unknown.
+bool parse_log_format(const std::string& value, LogFormat* format);
+// File extension for the format, with the dot.
+const char* log_extension(LogFormat format);
+
+struct LoggerOptions {
+    LogFormat format = LogFormat::kCsv;
+    RotationOptions rotation;
+    size_t queue_capacity = 4096; // records
+    int batch_ms = 100;           // longest a record waits before being written
+    int block_ms = 10000;         // columnar: longest a partial block is held back
+    // Optional: records first-byte-to-written latency (PiksiData::host_mono_ns).
+    LatencyHistogram* latency = nullptr;
+};
+
+struct LoggerStats {
+    u64 queued;  // records waiting for the writer thread
+    u64 written; // records handed to the file
+    u64 dropped; // records lost because the queue was full
+    u64 files;   // files opened, including rotations
+};
+
+// Solution logger with a background writer thread. push() only copies the
+// record into a bounded queue, so a slow disk never stalls acquisition; when
+// the queue is full the record is dropped and counted instead.
+class Logger {
+public:
+    explicit Logger(const LoggerOptions& options);
+    ~Logger();
+
+    void start();
+    // Writes everything still queued, then stops the writer thread.
+    void stop();
+    bool push(const PiksiData& data);
+    LoggerStats stats() const;
+
+private:
+    LoggerOptions options_;
+    SpscRing<PiksiData> queue_;
+    RotatingFile file_;
+    std::string batch_;
+    std::vector<s64> batch_stamps_; // host_mono_ns of the records in batch_
+    std::vector<PiksiData> block_;  // columnar rows not yet written
+    std::chrono::steady_clock::time_point block_started_;
+    u32 seq_ = 0;
+    std::thread writer_;
+    std::atomic<bool> running_{false};
+    std::atomic<u64> written_{0};
+    std::atomic<u64> dropped_{0};
+    std::atomic<u64> files_{0};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    void run();
+    void drain();
+    void flush_batch();
+    u64 flush_block();
+};
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef PIKSI_METRICS_HPP
+#define PIKSI_METRICS_HPP
+
+#include "histogram.hpp"
+#include "epoch_assembler.hpp"
+#include "transport.hpp"
+#include "logger.hpp"
+#include "link_monitor.hpp"
+#include "corrections.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace piksi {
+
+// Pipeline stages, each timed from the host arrival of the first byte
+// (CLOCK_MONOTONIC, see Transport::rx_time()):
+//   decode   - a frame's callback has run
+//   assemble - its epoch was closed into a solution
+//   publish  - the publisher thread handed the solution to Zenoh
+//   log      - the logger's write(2) of the record returned
+// except for corrections, which are timed from their arrival on Zenoh:
+//   correction - the correction was written to the receiver's port
+enum class Stage { kDecode, kAssemble, kPublish, kLog, kCorrection };
+constexpr size_t kStageCount = 5;
+const char* stage_name(Stage stage);
+
+// Error counters since start, readable from any thread.
+struct ErrorCounts {
+    u64 crc;
+    u64 read;
+    u64 framing_bytes;
+    u64 imu_dropped;
+    u64 hot_path_allocs; // heap allocations in loop() after warm-up (PIKSI_ALLOC_COUNTER builds only)
+};
+
+// Everything needed to account for where a receiver's time goes. The
+// recording side is lock-free and meant for the reader thread (and the
+// logger thread for Stage::kLog); report() is called by one thread at a time.
+class Metrics {
+public:
+    void record(Stage stage, s64 ns) { stages_[static_cast<size_t>(stage)].record(ns); }
+    LatencyHistogram& histogram(Stage stage) { return stages_[static_cast<size_t>(stage)]; }
+
+    // Frame of msg_type decoded (whether or not a callback is registered).
+    void count_message(u16 msg_type);
+    void count_crc_error() { crc_errors_.fetch_add(1, std::memory_order_relaxed); }
+    void count_read_error() { read_errors_.fetch_add(1, std::memory_order_relaxed); }
+    // Bytes thrown away while hunting for a preamble.
+    void count_framing(u32 bytes) { framing_bytes_.fetch_add(bytes, std::memory_order_relaxed); }
+    // IMU sample lost because its batch queue was full.
+    void count_imu_dropped() { imu_dropped_.fetch_add(1, std::memory_order_relaxed); }
+    void count_hot_path_allocs(u64 allocs) { hot_path_allocs_.fetch_add(allocs, std::memory_order_relaxed); }
+    // Solutions the publisher thread skipped because a newer one was already stored.
+    void count_coalesced(u64 solutions) { coalesced_.fetch_add(solutions, std::memory_order_relaxed); }
+
+    ErrorCounts errors() const;
+    // Latency of a stage at quantile q (0..1) since start, in ns; 0 before the first record.
+    u64 percentile(Stage stage, double q) const;
+
+    // JSON for the window since the previous report: per-message counts and
+    // rates, error counters, and per-stage latency percentiles (us).
+    // `corrections` is null when corrections are not forwarded.
+    std::string report(const std::string& name, const EpochStats& epochs, const TransportStats& transport,
+                       const LoggerStats& log, const LinkStats& link, const CorrectionStats* corrections);
+    // Human-readable latency summary since start, one line per stage.
+    std::string summary() const;
+
+private:
+    static constexpr size_t kMaxTypes = 32;
+
+    struct TypeCounter {
+        std::atomic<u16> type{0};
+        std::atomic<u64> count{0};
+    };
+
+    std::array<LatencyHistogram, kStageCount> stages_;
+    std::array<TypeCounter, kMaxTypes> types_;
+    std::atomic<size_t> type_count_{0};
+    std::atomic<u64> other_types_{0};
+    std::atomic<u64> crc_errors_{0};
+    std::atomic<u64> read_errors_{0};
+    std::atomic<u64> framing_bytes_{0};
+    std::atomic<u64> imu_dropped_{0};
+    std::atomic<u64> coalesced_{0};
+    std::atomic<u64> hot_path_allocs_{0};
+
+    // Reporting state: totals at the previous report.
+    bool reported_ = false;
+    std::chrono::steady_clock::time_point last_report_;
+    std::array<u64, kMaxTypes> last_counts_{};
+    std::array<LatencyHistogram::Counts, kStageCount> last_stages_{};
+};
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef PIKSI_PAYLOAD_POOL_HPP
+#define PIKSI_PAYLOAD_POOL_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace piksi {
+
+// Fixed set of preallocated buffers lent to Zenoh as payloads without copying.
+// A buffer is handed back by the payload deleter once Zenoh is done with it.
+// Zenoh may do that after the publisher is gone (a local subscriber still
+// holds the sample, or the session still queues it), so owners keep the pool
+// in a shared_ptr and each deleter holds a reference.
+template <size_t BufferSize, size_t Count>
+class PayloadPool {
+public:
+    PayloadPool() {
+        for (auto& flag : in_use_) {
+            flag.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // nullptr when every buffer is still in flight.
+    uint8_t* acquire() {
+        for (size_t i = 0; i < Count; ++i) {
+            size_t slot = (next_ + i) % Count;
+            bool expected = false;
+            if (in_use_[slot].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                next_ = (slot + 1) % Count;
+                return buffers_[slot].data();
+            }
+        }
+        return nullptr;
+    }
+
+    void release(uint8_t* buffer) {
+        size_t slot = static_cast<size_t>(buffer - buffers_[0].data()) / BufferSize;
+        in_use_[slot].store(false, std::memory_order_release);
+    }
+
+private:
+    std::array<std::array<uint8_t, BufferSize>, Count> buffers_;
+    std::array<std::atomic<bool>, Count> in_use_;
+    size_t next_ = 0;
+};
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef PIKSI_DATA_HPP
+#define PIKSI_DATA_HPP
+
+#include <libsbp/common.h>
+
+namespace piksi {
+
+struct PiksiData {
+    double lat, lon, h;              // Latitude, longitude, height (LLH)
+    float S_llh_h, S_llh_v;          // LLH horizontal/vertical accuracy (m)
+    double ecef_x, ecef_y, ecef_z;   // ECEF position (m)
+    float S_ecef;                    // ECEF accuracy (m)
+    double n, e, d;                  // Baseline NED (m)
+    float S_rtk_x_h, S_rtk_x_v;      // RTK horizontal/vertical accuracy (m)
+    double v_n, v_e, v_d;            // Velocity NED (m/s)
+    float S_rtk_v_h, S_rtk_v_v;      // Velocity horizontal/vertical accuracy (m/s)
+    u8 hr, min, sec;                 // UTC time
+    double ms;                       // UTC milliseconds
+    float utc;                       // UTC time in hours (hr + min/60 + sec/3600)
+    double utc_timestamp;            // UNIX timestamp of the epoch (UTC_TIME, else GPS_TIME - leap seconds)
+    int sats;                        // Number of satellites
+    int status;                      // GPS status
+    bool rtk_solution;               // RTK solution availability
+    double frequency;                // Update frequency (Hz)
+    u32 tow;                         // GPS time of week of the epoch (ms)
+    u8 epoch_parts;                  // EpochPart bits that arrived for this epoch
+    u16 gps_week;                    // GPS week number (0 until MSG_GPS_TIME is seen)
+    s64 host_mono_ns;                // Host CLOCK_MONOTONIC at the first byte of the epoch
+    s64 host_real_ns;                // Host CLOCK_REALTIME at the first byte of the epoch
+    double local_e, local_n, local_u; // ENU position from local_origin (m; 0 without one)
+};
+
+} // namespace piksi
+
+#endif
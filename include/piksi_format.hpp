@@ -0,0 +1,137 @@
+#ifndef PIKSI_FORMAT_HPP
+#define PIKSI_FORMAT_HPP
+
+#include "piksi_data.hpp"
+#include "imu.hpp"
+#include <ostream>
+#include <string>
+#include <cstddef>
+
+namespace piksi {
+
+// JSON object published on the Zenoh key, one per solution. seq numbers the
+// published solutions, as in the binary payload below.
+std::string to_json(const PiksiData& data, u32 seq);
+
+// Binary payload: fixed-layout, little-endian, schema-versioned encoding of
+// PiksiData. Field order and widths are mirrored by the decoder in
+// script/piksi_zenoh.py; bump kBinaryVersion whenever the layout changes.
+//
+//   offset  type      field
+//        0  char[2]   magic "PK"
+//        2  u8        version
+//        3  u8        flags (bit 0: rtk_solution)
+//        4  u32       seq
+//        8  f64       utc_timestamp
+//       16  f32       utc
+//       20  u8[3]     hr, min, sec
+//       23  u8        epoch_parts (v2; pad in v1)
+//       24  f64       ms
+//       32  f64       frequency
+//       40  s32       status
+//       44  s32       sats
+//       48  f64[3]    lat, lon, h
+//       72  f32[2]    S_llh_h, S_llh_v
+//       80  f64[3]    ecef_x, ecef_y, ecef_z
+//      104  f32       S_ecef
+//      108  f64[3]    n, e, d
+//      132  f32[2]    S_rtk_x_h, S_rtk_x_v
+//      140  f64[3]    v_n, v_e, v_d
+//      164  f32[2]    S_rtk_v_h, S_rtk_v_v
+//      172  u32       tow (v2)
+//      176  s64       host_mono_ns (v3)
+//      184  s64       host_real_ns (v3)
+//      192  u16       gps_week (v3)
+//      194  u8[2]     reserved
+//      196  f64[3]    local_e, local_n, local_u (v4)
+//      220
+constexpr u8 kBinaryVersion = 4;
+constexpr size_t kBinarySize = 220;
+
+// Serializes into buf (at least kBinarySize bytes); returns the encoded size.
+size_t encode_binary(const PiksiData& data, u32 seq, u8* buf);
+
+// Decoders for the full-solution payloads, used by subscribers such as
+// piksi_record. Fields a payload does not carry (older binary versions, or
+// JSON keys that are missing) are left untouched in data. False if buf is not
+// such a payload.
+bool decode_binary(const u8* buf, size_t len, PiksiData* data, u32* seq);
+bool decode_json(const char* buf, size_t len, PiksiData* data, u32* seq);
+// Either of the above, told apart by the "PK" magic.
+bool decode_solution(const u8* buf, size_t len, PiksiData* data, u32* seq);
+
+// Per-topic keys: <zenoh_key> carries the full solution above, the others
+// <zenoh_key>/<topic_name()> carry one slice of it.
+enum class Topic { kFull, kLlh, kVel, kBaseline, kTime };
+constexpr size_t kTopicCount = 5;
+const char* topic_name(Topic topic);
+
+// JSON for one topic (the full topic is to_json(), like encode_binary() below).
+std::string topic_json(Topic topic, const PiksiData& data, u32 seq);
+
+// Binary topic payload, kTopicSize bytes for every slice topic:
+//
+//   offset  type      field
+//        0  char[2]   magic "PT"
+//        2  u8        version
+//        3  u8        topic (Topic enum value)
+//        4  u32       seq
+//        8  u32       tow
+//       12  u8        status
+//       13  u8        sats
+//       14  u8        flags (bit 0: rtk_solution)
+//       15  u8        reserved
+//       16  s64       host_mono_ns
+//       24            llh:      f64[3] lat, lon, h;  f32[2] S_llh_h, S_llh_v
+//                     vel:      f64[3] v_n, v_e, v_d;  f32[2] S_rtk_v_h, S_rtk_v_v
+//                     baseline: f64[3] n, e, d;  f32[2] S_rtk_x_h, S_rtk_x_v
+//                     time:     f64 utc_timestamp, f64 ms, s64 host_real_ns,
+//                               u16 gps_week, u8[3] hr, min, sec, u8[3] reserved
+//       56
+constexpr u8 kTopicVersion = 1;
+constexpr size_t kTopicSize = 56;
+
+// Writes kTopicSize bytes, or kBinarySize for the full topic.
+size_t encode_topic(Topic topic, const PiksiData& data, u32 seq, u8* buf);
+
+// IMU batch payload: a header followed by `count` samples, little-endian,
+// published on <zenoh_key>/imu. Mirrored by script/piksi_zenoh.py.
+//
+//   offset  type      field
+//        0  char[2]   magic "PI"
+//        2  u8        version
+//        3  u8        count
+//        4  u32       seq (batch sequence number)
+//        8  u8        imu_type
+//        9  u8        imu_conf
+//       10  u8[2]     reserved
+//       12  f32       temperature (deg C, NaN if unknown)
+//       16            samples, kImuSampleSize bytes each:
+//           +0  s64       host_mono_ns
+//           +8  s64       host_real_ns
+//          +16  u32       tow (ms)
+//          +20  u8        tow_f (1/256 ms)
+//          +21  u8        time_status
+//          +22  u8[2]     reserved
+//          +24  f32[3]    acc x, y, z (m/s^2)
+//          +36  f32[3]    gyr x, y, z (rad/s)
+//          +48
+constexpr u8 kImuBatchVersion = 1;
+constexpr size_t kImuHeaderSize = 16;
+constexpr size_t kImuSampleSize = 48;
+constexpr size_t kMaxImuBatch = 64;
+constexpr size_t kImuBatchMaxSize = kImuHeaderSize + kMaxImuBatch * kImuSampleSize;
+
+size_t encode_imu_header(u8 count, u32 seq, const ImuInfo& info, u8* buf);
+size_t encode_imu_sample(const ImuSample& sample, u8* buf);
+
+// CSV log layout written by piksi_gps. The append_ variants format with
+// snprintf into a caller-owned buffer; the output is identical.
+void append_csv_header(std::string& out);
+void append_csv_row(std::string& out, const PiksiData& data);
+void write_csv_header(std::ostream& os);
+void write_csv_row(std::ostream& os, const PiksiData& data);
+
+} // namespace piksi
+
+#endif
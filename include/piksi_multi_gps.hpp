@@ -1,7 +1,6 @@
 #ifndef PIKSI_MULTI_GPS_HPP
 #define PIKSI_MULTI_GPS_HPP
 
-#include <libserialport.h>
 #include <libsbp/sbp.h>
 #include <libsbp/legacy/system.h>
 #include <libsbp/legacy/navigation.h>
@@ -10,82 +9,293 @@
 #include <libsbp/legacy/api.h>
 #include <libsbp/legacy/compat.h>
 #include <libsbp/legacy/cpp/payload_handler.h>
+#include <array>
 #include <string>
+#include <vector>
 #include <iostream>
 #include <chrono>
 #include <ctime>
 #include <zenoh.hxx>
 #include <optional>
-
-using namespace zenoh;
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include "transport.hpp"
+#include "piksi_data.hpp"
+#include "piksi_format.hpp"
+#include "payload_pool.hpp"
+#include "publisher.hpp"
+#include "snapshot.hpp"
+#include "epoch_assembler.hpp"
+#include "logger.hpp"
+#include "raw_capture.hpp"
+#include "metrics.hpp"
+#include "link_monitor.hpp"
+#include "corrections.hpp"
+#include "predictor.hpp"
+#include "history.hpp"
+#include "dashboard.hpp"
+#include "realtime.hpp"
+#include "alloc_counter.hpp"
+#include "settings.hpp"
+#include "imu.hpp"
+#include "spsc_ring.hpp"
 
 namespace piksi {
 
-struct PiksiData {
-    double lat, lon, h;              // Latitude, longitude, height (LLH)
-    float S_llh_h, S_llh_v;          // LLH horizontal/vertical accuracy (m)
-    double ecef_x, ecef_y, ecef_z;   // ECEF position (m)
-    float S_ecef;                    // ECEF accuracy (m)
-    double n, e, d;                  // Baseline NED (m)
-    float S_rtk_x_h, S_rtk_x_v;      // RTK horizontal/vertical accuracy (m)
-    double v_n, v_e, v_d;            // Velocity NED (m/s)
-    float S_rtk_v_h, S_rtk_v_v;      // Velocity horizontal/vertical accuracy (m/s)
-    u8 hr, min, sec;                 // UTC time
-    double ms;                       // UTC milliseconds
-    float utc;                       // UTC time in hours (hr + min/60 + sec/3600)
-    double utc_timestamp;            // UNIX timestamp from UTC (seconds since epoch)
-    int sats;                        // Number of satellites
-    int status;                      // GPS status
-    bool rtk_solution;               // RTK solution availability
-    double frequency;                // Update frequency (Hz)
-};
-
 class PiksiMultiGPS {
 public:
-    PiksiMultiGPS(const std::string& config_file_path = "../config.cfg");
+    static const char* const kDefaultSection;
+
+    using SolutionCallback = std::function<void(const PiksiData&)>;
+    using ImuCallback = std::function<void(const ImuSample&)>;
+
+    // Reads the receiver's settings from the given config section. Receivers
+    // in one process may share a Zenoh session; otherwise each opens its own.
+    // With zenoh=false no session is opened or used whatever zenoh_enabled
+    // says, for applications that only consume solutions in process.
+    PiksiMultiGPS(const std::string& config_file_path = "../config.cfg",
+                  const std::string& section = kDefaultSection,
+                  std::shared_ptr<zenoh::Session> session = nullptr, bool zenoh = true);
     ~PiksiMultiGPS();
+    PiksiMultiGPS(const PiksiMultiGPS&) = delete;
+    PiksiMultiGPS& operator=(const PiksiMultiGPS&) = delete;
 
-    void open();
-    void configure();
-    void init_loop();
+    // shm: let co-located subscribers receive through Zenoh shared memory.
+    static std::shared_ptr<zenoh::Session> open_session(bool shm = false);
+
+    // Opens the port (or recording) and starts the background threads. A
+    // serial port that cannot be opened yet is retried by loop() like a lost
+    // link; false only when that is not possible (replay, reconnect=false).
+    bool open();
+    // Applies receiver settings from the config (baud switch first, then the
+    // batch); false if any of them could not be confirmed.
+    bool configure();
+    // Waits for the first heartbeat; false if none arrives within
+    // heartbeat_timeout_ms, the stream ends, or stop() is called.
+    bool init_loop();
+    // Decodes what has arrived. A read error, hangup or link_timeout_ms
+    // without a heartbeat closes the port; later calls reopen it with
+    // exponential backoff and resynchronise the parser.
     void loop();
     void close();
+    // Single-threaded access: only valid on the thread that calls loop().
     const PiksiData& get_data() const { return data_; }
     bool has_new_data() {
-        bool temp = has_new_data_;
-        has_new_data_ = false; // Reset the flag after checking
-        return temp;
+        return has_new_data_.exchange(false); // Reset the flag after checking
     }
     bool get_log_to_csv() const { return log_to_csv_; }
+    // Empty for the default section, "rover" for "[Piksi Multi GPS rover]".
+    const std::string& get_name() const { return name_; }
+    std::shared_ptr<zenoh::Session> get_session() const { return session_; }
+    bool get_reader_thread() const { return reader_thread_; }
+    EpochStats get_epoch_stats() const { return assembler_.stats(); }
+    LoggerStats get_logger_stats() const { return logger_ ? logger_->stats() : LoggerStats{}; }
+    RawCaptureStats get_capture_stats() const { return capture_ ? capture_->stats() : RawCaptureStats{}; }
+    // Per-stage latency percentiles since start (see Metrics::summary()).
+    std::string get_latency_summary() const { return metrics_.summary(); }
+    u64 get_latency_percentile(Stage stage, double q) const { return metrics_.percentile(stage, q); }
+    ErrorCounts get_errors() const { return metrics_.errors(); }
+    LinkStats get_link_stats() const { return link_.stats(); }
+    // True when corrections_key is set and corrections are forwarded to the receiver.
+    bool forwards_corrections() const { return corrections_ != nullptr; }
+    CorrectionStats get_correction_stats() const { return corrections_ ? corrections_->stats() : CorrectionStats{}; }
+    // Latency-compensated solution at host CLOCK_MONOTONIC time host_mono_ns
+    // (e.g. clock_ns(CLOCK_MONOTONIC) for "now"); any thread, never blocks.
+    // False when predict_enabled is off, before the first fix, or further
+    // than predict_max_ms from the last one. See StatePredictor.
+    bool predict(s64 host_mono_ns, PiksiData& out) const { return predictor_ && predictor_->predict(host_mono_ns, out); }
+    // The last history_size solutions, for looking up or interpolating the
+    // state at a past GPS or host time from any thread; nullptr when
+    // history_size is 0.
+    const SolutionHistory* get_history() const { return history_.get(); }
+    // Console settings (console_hz, console_in_place); main() uses the first receiver's.
+    const DashboardOptions& get_console_options() const { return console_options_; }
+    // True once a replayed recording has been fully consumed, or the link
+    // was lost with reconnect=false.
+    bool finished() const { return (transport_ && transport_->eof()) || link_failed_; }
+
+    // Reader thread mode: init_loop() and loop() run on their own thread and
+    // every solution is handed to consumers as a complete snapshot.
+    void start();
+    void stop();
+    bool running() const { return running_; }
+    // Copies the latest solution; returns its sequence number (0: none yet). Never blocks.
+    uint64_t latest(PiksiData& out) const { return snapshot_.load(out); }
+    // Waits for a solution newer than `seen`; false on timeout.
+    bool wait_for_data(uint64_t& seen, PiksiData& out, std::chrono::milliseconds timeout) {
+        return snapshot_.wait_newer(seen, out, timeout);
+    }
+    // Copies the latest IMU sample; returns how many have been decoded (0: none yet).
+    uint64_t latest_imu(ImuSample& out) const { return imu_snapshot_.load(out); }
+
+    // In-process consumers, called on the decoding thread (the reader thread,
+    // or the caller of loop()) for every solution or IMU sample as soon as it
+    // is complete. The reference is only valid during the call. Callbacks hold up decoding while they run,
+    // so they should copy what they need and return. Register before start()
+    // or init_loop().
+    void on_solution(SolutionCallback callback) { solution_callbacks_.push_back(std::move(callback)); }
+    void on_imu(ImuCallback callback) { imu_callbacks_.push_back(std::move(callback)); }
 
 private:
+    std::string section_;
+    std::string name_;
     std::string port_;
-    int baud_rate_;
-    const char* serial_port_name_;
+    int baud_rate_;             // host rate now; target_baud_rate_ once switched
+    int config_baud_rate_ = 0;  // baud_rate from the config, the receiver's rate after a reboot
+    std::string replay_file_;
+    bool replay_realtime_ = true;
+    int read_timeout_ms_ = 100;
+    int heartbeat_timeout_ms_ = 10000;
+    LinkOptions link_options_;
+    LinkMonitor link_;
+    std::atomic<bool> link_failed_{false};
+    bool needs_configure_ = false; // settings go out again after the next heartbeat
+    bool heartbeat_seen_ = false;  // since the port was last opened
+    std::vector<Setting> settings_;
+    int target_baud_rate_ = 0;
+    std::string receiver_uart_ = "uart1";
+    int settings_timeout_ms_ = 500;
+    int settings_retries_ = 3;
+    bool settings_save_ = false;
+    SettingsManager* settings_session_ = nullptr; // during configure(); gets the settings responses
+    std::unique_ptr<Transport> transport_;
     sbp_state_t s_;
     sbp_state_t s0_;
     PiksiData data_;
-    static int loop_count_;
-    static bool flag_start_;
-    std::chrono::time_point<std::chrono::high_resolution_clock> last_update_;
-    bool has_new_data_ = false;
-    std::optional<Session> session_;
-    std::optional<Publisher> pub_;
+    int loop_count_ = 0;
+    bool flag_start_ = false;
+    bool parsers_ready_ = false;
+    sbp_msg_callbacks_node_t heartbeat_node_0_;
+    sbp_msg_callbacks_node_t gps_time_node_;
+    sbp_msg_callbacks_node_t gps_week_node_;
+    sbp_msg_callbacks_node_t pos_llh_node_;
+    sbp_msg_callbacks_node_t pos_ecef_node_;
+    sbp_msg_callbacks_node_t vel_ned_node_;
+    sbp_msg_callbacks_node_t baseline_node_;
+    sbp_msg_callbacks_node_t heartbeat_node_;
+    sbp_msg_callbacks_node_t imu_raw_node_;
+    sbp_msg_callbacks_node_t imu_aux_node_;
+    sbp_msg_callbacks_node_t age_corrections_node_;
+    sbp_msg_callbacks_node_t settings_write_node_0_;
+    sbp_msg_callbacks_node_t settings_read_node_0_;
+    sbp_msg_callbacks_node_t settings_write_node_;
+    sbp_msg_callbacks_node_t settings_read_node_;
+    // Emit times (CLOCK_MONOTONIC ns) of the last epochs, for a windowed frequency.
+    std::array<s64, 10> emit_times_ = {};
+    size_t emit_count_ = 0;
+    std::atomic<bool> has_new_data_{false};
+    Snapshot<PiksiData> snapshot_;
+    std::vector<SolutionCallback> solution_callbacks_;
+    std::vector<ImuCallback> imu_callbacks_;
+    bool reader_thread_ = false;
+    RealtimeOptions realtime_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_requested_{false};
+    std::thread reader_;
+    std::shared_ptr<zenoh::Session> session_;
+    std::string zenoh_key_;
+    PublisherOptions publisher_options_;
+    std::unique_ptr<SolutionPublisher> publisher_;
     bool log_to_csv_ = true;
+    LoggerOptions log_options_;
+    std::unique_ptr<Logger> logger_;
+    bool capture_raw_ = false;
+    bool capture_dir_set_ = false;
+    RawCaptureOptions capture_options_;
+    std::unique_ptr<RawCapture> capture_;
+    bool zenoh_enabled_ = true;
+    DashboardOptions console_options_;
+    EpochAssembler assembler_;
+    u8 epoch_parts_ = kAllEpochParts;
+    int epoch_timeout_ms_ = 50;
+    HostTime frame_rx_ = {}; // first byte of the frame being parsed
+    HostTime epoch_rx_ = {}; // first byte of the first frame of the open epoch
+    // Last valid MSG_GPS_TIME and UTC_TIME; merged into the epoch with the same tow.
+    msg_gps_time_t gps_time_ = {};
+    bool gps_time_valid_ = false;
+    u32 utc_tow_ = 0;
+    bool utc_valid_ = false;
+    Metrics metrics_;
+    int stats_period_ms_ = 1000;
+    std::string stats_key_;
+    std::optional<zenoh::Publisher> stats_pub_;
+    s64 next_stats_ns_ = 0;
+    // IMU samples wait in imu_ring_ until a batch is full or imu_batch_ms old.
+    bool imu_enabled_ = true;
+    std::string imu_key_;
+    int imu_batch_ = 20;
+    int imu_batch_ms_ = 50;
+    ImuInfo imu_info_;
+    SpscRing<ImuSample> imu_ring_{4 * kMaxImuBatch};
+    Snapshot<ImuSample> imu_snapshot_;
+    std::optional<zenoh::Publisher> imu_pub_;
+    std::shared_ptr<PayloadPool<kImuBatchMaxSize, 4>> imu_pool_ =
+        std::make_shared<PayloadPool<kImuBatchMaxSize, 4>>(); // shared with the payload deleters
+    u32 imu_seq_ = 0;
+    s64 imu_oldest_ns_ = 0; // host time of the oldest queued sample
+    // Corrections from Zenoh to the receiver; the subscriber is declared after
+    // the forwarder so that it is destroyed first.
+    CorrectionOptions corrections_options_;
+    std::unique_ptr<CorrectionForwarder> corrections_;
+    std::optional<zenoh::Subscriber<void>> corrections_sub_;
+    // State prediction between fixes; the publisher reads from the predictor,
+    // so it is declared after it.
+    bool predict_enabled_ = false;
+    double predict_hz_ = 100.0;
+    std::string predict_key_;
+    PredictorOptions predictor_options_;
+    std::unique_ptr<StatePredictor> predictor_;
+    std::unique_ptr<PredictionPublisher> prediction_publisher_;
+    // Mission frame for local_e/n/u (local_origin); none: the fields stay 0.
+    std::optional<LocalFrame> local_origin_;
+    int history_size_ = 0;
+    int history_max_gap_ms_ = 1000;
+    std::unique_ptr<SolutionHistory> history_;
+#ifdef PIKSI_ALLOC_COUNTER
+    bool hot_path_alloc_reported_ = false;
+#endif
 
-    void setup_port(int baud);
     void read_config(const std::string& config_file_path);
+    static bool parse_int(const std::string& key, const std::string& value, int& out);
+    static bool parse_double(const std::string& key, const std::string& value, double& out);
+    void set_topic_rate(const std::string& key, const std::string& value);
+    void set_setting(const Setting& setting);
+    void setup_parsers();
+    bool settings_step();
+    int decode_step();
+    void service(s64 now);
+    bool ensure_link();
+    void drop_link(const char* reason, bool heartbeat_timeout);
+    void reapply_settings();
+    void reset_parser();
+    bool begin_part(u32 tow, u8 part);
+    void end_part(u8 part);
+    void emit_epoch();
+    void publish();
+    void publish_stats();
+#ifdef PIKSI_ALLOC_COUNTER
+    void check_allocations(u64 before);
+#endif
+    void publish_imu();
     static s32 piksi_port_read(u8 *buff, u32 n, void *context);
     static s32 piksi_port_write(u8 *buff, u32 n, void *context);
 
     // Callback functions for SBP messages
     static void heartbeat_callback_0(u16 sender_id, u8 len, u8 msg[], void *context);
     static void heartbeat_callback(u16 sender_id, u8 len, u8 msg[], void *context);
+    static void imu_raw_callback(u16 sender_id, u8 len, u8 msg[], void *context);
+    static void imu_aux_callback(u16 sender_id, u8 len, u8 msg[], void *context);
+    static void age_corrections_callback(u16 sender_id, u8 len, u8 msg[], void *context);
+    static void settings_write_resp_callback(u16 sender_id, u8 len, u8 msg[], void *context);
+    static void settings_read_resp_callback(u16 sender_id, u8 len, u8 msg[], void *context);
     static void baseline_callback(u16 sender_id, u8 len, u8 msg[], void *context);
     static void pos_llh_callback(u16 sender_id, u8 len, u8 msg[], void *context);
     static void pos_ecef_callback(u16 sender_id, u8 len, u8 msg[], void *context);
     static void vel_ned_callback(u16 sender_id, u8 len, u8 msg[], void *context);
     static void gps_time_callback(u16 sender_id, u8 len, u8 msg[], void *context);
+    static void gps_week_callback(u16 sender_id, u8 len, u8 msg[], void *context);
 };
 
 } // namespace piksi
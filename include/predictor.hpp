@@ -0,0 +1,69 @@
+#ifndef PIKSI_PREDICTOR_HPP
+#define PIKSI_PREDICTOR_HPP
+
+#include "piksi_data.hpp"
+#include "geodesy.hpp"
+#include "snapshot.hpp"
+#include <optional>
+
+namespace piksi {
+
+struct PredictorOptions {
+    // White-acceleration process noise (m/s^2): how hard the vehicle may
+    // manoeuvre between fixes. Larger follows faster, smaller smooths more.
+    double accel_noise = 2.0;
+    // Age of a fix when its first byte arrives. < 0: measured per fix as host
+    // CLOCK_REALTIME - utc_timestamp, which needs the host clock disciplined
+    // (NTP/PTP/PPS) and is taken as 0 without UTC.
+    int latency_ms = -1;
+    // predict() refuses to extrapolate further than this past the last fix.
+    int max_horizon_ms = 1000;
+    // Also predict local_e/n/u in this frame (local_origin).
+    std::optional<LocalFrame> local_origin;
+};
+
+// Latency-compensated state between fixes. Each valid solution updates a
+// constant-velocity Kalman filter per axis in a local NED frame, with the
+// position (POS_LLH, else POS_ECEF) and velocity (VEL_NED) weighted by the
+// accuracies the receiver reports. predict() extrapolates that state to any
+// host CLOCK_MONOTONIC instant, so a controller sees where the vehicle is now
+// rather than where it was when the fix was computed.
+class StatePredictor {
+public:
+    explicit StatePredictor(const PredictorOptions& options = PredictorOptions());
+
+    // Decoding thread only; fixes without a position or with status 0 are ignored.
+    void update(const PiksiData& data);
+    // Any thread, never blocks. Fills out like a solution valid at host_mono_ns:
+    // positions, baseline and velocity from the filter, accuracies grown by the
+    // prediction, tow/UTC advanced. False before the first fix or beyond
+    // max_horizon_ms.
+    bool predict(s64 host_mono_ns, PiksiData& out) const;
+    // Number of fixes the filter has taken (0: nothing to predict from).
+    uint64_t fixes() const { return state_.version(); }
+
+private:
+    struct Axis {
+        double x[2];    // position (m), velocity (m/s)
+        double p[2][2]; // covariance
+    };
+    struct State {
+        PiksiData fix;      // last fix as decoded
+        s64 t_ns;           // host CLOCK_MONOTONIC at which the fix was valid
+        LocalFrame frame;   // NED around the first fix since the last reset
+        Axis axis[3];       // north, east, down, after the update with fix
+    };
+
+    PredictorOptions options_;
+    State state_w_ = {}; // writer's copy
+    bool valid_ = false;
+    Snapshot<State> state_;
+
+    s64 fix_time(const PiksiData& data) const;
+    static void propagate(const Axis& in, double dt, double q, Axis& out);
+    static void correct(Axis& axis, int index, double z, double r);
+};
+
+} // namespace piksi
+
+#endif
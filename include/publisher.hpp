@@ -0,0 +1,112 @@
+#ifndef PIKSI_PUBLISHER_HPP
+#define PIKSI_PUBLISHER_HPP
+
+#include "piksi_data.hpp"
+#include "piksi_format.hpp"
+#include "payload_pool.hpp"
+#include "snapshot.hpp"
+#include "metrics.hpp"
+#include "predictor.hpp"
+#include <zenoh.hxx>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace piksi {
+
+struct PublisherOptions {
+    std::string key = "fdcl/piksi";
+    bool binary = false;
+    // Publish through Zenoh shared memory (needs a zenoh-c built with
+    // shared-memory and unstable API support; ignored otherwise).
+    bool shm = false;
+    // Per Topic: < 0 off, 0 every solution, > 0 at most this many per second.
+    std::array<double, kTopicCount> rate_hz = {0.0, -1.0, -1.0, -1.0, -1.0};
+};
+
+// Publishes solutions on their Zenoh keys from its own thread, so the decode
+// path only stores a snapshot. The thread always takes the latest solution:
+// if several were stored while it was busy, the older ones are skipped
+// (latest-value coalescing) and counted, and subscribers see a seq gap.
+class SolutionPublisher {
+public:
+    SolutionPublisher(std::shared_ptr<zenoh::Session> session, const PublisherOptions& options,
+                      Snapshot<PiksiData>& source, Metrics& metrics);
+    ~SolutionPublisher();
+    SolutionPublisher(const SolutionPublisher&) = delete;
+    SolutionPublisher& operator=(const SolutionPublisher&) = delete;
+
+    void start();
+    // Publishes the latest solution if it has not gone out yet, then joins the thread.
+    void stop();
+
+    // True when this build can publish through Zenoh shared memory.
+    static bool shm_supported();
+
+private:
+    struct TopicState {
+        std::optional<zenoh::Publisher> pub;
+        u32 period_ms = 0; // 0: every solution
+        u32 last_tow = 0;
+        bool sent = false;
+    };
+
+    std::shared_ptr<zenoh::Session> session_;
+    PublisherOptions options_;
+    Snapshot<PiksiData>& source_;
+    Metrics& metrics_;
+    std::array<TopicState, kTopicCount> topics_;
+    // One buffer per topic per solution in flight; shared with the payload deleters.
+    std::shared_ptr<PayloadPool<kBinarySize, 16>> pool_ = std::make_shared<PayloadPool<kBinarySize, 16>>();
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    uint64_t seen_ = 0;
+    struct Shm;
+    std::unique_ptr<Shm> shm_;
+
+    void run();
+    void publish(const PiksiData& data);
+    static bool due(TopicState& topic, u32 tow);
+    void put(Topic topic, TopicState& topic_state, const PiksiData& data, u32 seq);
+};
+
+// Publishes StatePredictor output on its own key at a fixed host rate, so
+// subscribers get a fresh state between fixes. Nothing goes out before the
+// first fix or once the last one is older than the predictor's horizon.
+class PredictionPublisher {
+public:
+    PredictionPublisher(std::shared_ptr<zenoh::Session> session, const std::string& key, bool binary, double rate_hz,
+                        const StatePredictor& predictor);
+    ~PredictionPublisher();
+    PredictionPublisher(const PredictionPublisher&) = delete;
+    PredictionPublisher& operator=(const PredictionPublisher&) = delete;
+
+    void start();
+    void stop();
+    u64 published() const { return published_.load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<zenoh::Session> session_;
+    std::optional<zenoh::Publisher> pub_;
+    bool binary_;
+    s64 period_ns_;
+    const StatePredictor& predictor_;
+    std::shared_ptr<PayloadPool<kBinarySize, 4>> pool_ = std::make_shared<PayloadPool<kBinarySize, 4>>();
+    std::thread thread_;
+    bool running_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<u64> published_{0};
+
+    void run();
+    void put(const PiksiData& data, u32 seq);
+};
+
+} // namespace piksi
+
+#endif
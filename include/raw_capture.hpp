@@ -0,0 +1,107 @@
+#ifndef PIKSI_RAW_CAPTURE_HPP
+#define PIKSI_RAW_CAPTURE_HPP
+
+#include "gps_time.hpp"
+#include "rotating_file.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace piksi {
+
+// Raw capture (capture_raw=true): every byte the SBP parser reads is written
+// unmodified to rotated "<time>_raw.sbp" files, which replay_file and Swift's
+// tools read as they are. Host arrival times go to a sidecar "<file>.idx":
+//
+//   offset  type      field
+//        0  char[4]   magic "PIDX"
+//        4  u16       version
+//        6  u16       reserved
+//        8            entries: u64 offset in the .sbp, s64 host_mono_ns, s64 host_real_ns
+//                     (the bytes from offset on arrived at these host times)
+//
+// A rotation can split a frame across two files; SBP readers resynchronise on
+// the next preamble.
+constexpr u16 kRawIndexVersion = 1;
+
+struct RawCaptureOptions {
+    RotationOptions rotation;
+    size_t buffer_bytes = 1 << 20; // per buffer
+    size_t buffers = 8;            // the writer may fall this far behind before bytes are dropped
+    int flush_ms = 200;            // longest captured bytes wait before being written
+};
+
+struct RawCaptureStats {
+    u64 bytes;   // bytes handed to the file
+    u64 dropped; // bytes lost because every buffer was waiting for the disk
+    u64 files;   // files opened, including rotations
+};
+
+// Off-thread writer for the raw stream. append() runs on the reader thread
+// and only copies into a preallocated buffer; full buffers are handed to the
+// writer thread, and when none is free the bytes are dropped and counted
+// rather than stalling acquisition.
+class RawCapture {
+public:
+    explicit RawCapture(const RawCaptureOptions& options);
+    ~RawCapture();
+    RawCapture(const RawCapture&) = delete;
+    RawCapture& operator=(const RawCapture&) = delete;
+
+    void start();
+    // Writes everything appended so far, then stops the writer thread. Call
+    // once the reader thread no longer appends.
+    void stop();
+    // Reader thread only.
+    void append(const u8* data, size_t n, const HostTime& rx);
+    // Hands a partial buffer to the writer once its first byte is flush_ms
+    // old. Reader thread only, called while the link is idle or down, when
+    // append() is not.
+    void flush_if_due(s64 now_ns);
+    RawCaptureStats stats() const;
+
+private:
+    struct IndexEntry {
+        u64 offset; // in the buffer, then in the file
+        s64 mono_ns;
+        s64 real_ns;
+    };
+    struct Buffer {
+        std::unique_ptr<u8[]> bytes;
+        size_t size = 0;
+        std::vector<IndexEntry> index;
+        s64 started_ns = 0;
+    };
+
+    RawCaptureOptions options_;
+    std::vector<Buffer> buffers_;
+    Buffer* active_ = nullptr;
+    HostTime last_rx_ = {};
+    std::vector<Buffer*> free_;
+    std::vector<Buffer*> ready_; // in capture order
+    RotatingFile file_;
+    std::string index_path_;
+    std::FILE* index_ = nullptr;
+    u64 file_offset_ = 0;
+    std::thread writer_;
+    std::atomic<bool> running_{false};
+    std::atomic<u64> written_{0};
+    std::atomic<u64> dropped_{0};
+    std::atomic<u64> files_{0};
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+
+    bool next_buffer(const HostTime& rx);
+    void submit();
+    void run();
+    void write(Buffer& buffer);
+};
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef PIKSI_REALTIME_HPP
+#define PIKSI_REALTIME_HPP
+
+#include <string>
+#include <vector>
+
+namespace piksi {
+
+// Scheduling for the acquisition thread (rt_cpus, rt_priority, rt_mlockall).
+struct RealtimeOptions {
+    std::vector<int> cpus; // pin to these CPUs; empty: wherever the kernel likes
+    int priority = 0;      // SCHED_FIFO priority 1-99; 0: normal scheduling
+    bool lock_memory = false;
+
+    bool enabled() const { return !cpus.empty() || priority > 0 || lock_memory; }
+};
+
+// "2", "2,3" or "0-3" (ranges and lists may be mixed); false if malformed.
+bool parse_cpu_list(const std::string& value, std::vector<int>* cpus);
+
+// Applies the options to the calling thread. mlockall() covers the whole
+// process: every page mapped now or later stays resident, so a page fault
+// never stalls a read. Without the privilege for a step (CAP_SYS_NICE and
+// CAP_IPC_LOCK, or matching rtprio/memlock limits) a warning is printed and
+// the remaining steps still run; returns false if any step failed.
+bool apply_realtime(const RealtimeOptions& options);
+
+} // namespace piksi
+
+#endif
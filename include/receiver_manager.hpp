@@ -0,0 +1,40 @@
+#ifndef PIKSI_RECEIVER_MANAGER_HPP
+#define PIKSI_RECEIVER_MANAGER_HPP
+
+#include "piksi_multi_gps.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace piksi {
+
+// Drives every receiver configured in one config file from a single process.
+//
+// Each "[Piksi Multi GPS]" or "[Piksi Multi GPS <name>]" section describes one
+// receiver with its own port, settings and Zenoh key. All receivers share one
+// Zenoh session and each decodes on its own reader thread.
+class ReceiverManager {
+public:
+    explicit ReceiverManager(const std::string& config_file_path);
+    ~ReceiverManager();
+
+    // Receiver section names found in the config file, in file order.
+    static std::vector<std::string> find_sections(const std::string& config_file_path);
+
+    // Opens, configures and starts every receiver.
+    void start();
+    void stop();
+    // True while at least one receiver is still acquiring.
+    bool running() const;
+
+    size_t size() const { return receivers_.size(); }
+    PiksiMultiGPS& receiver(size_t i) { return *receivers_[i]; }
+
+private:
+    std::shared_ptr<zenoh::Session> session_;
+    std::vector<std::unique_ptr<PiksiMultiGPS>> receivers_;
+};
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef PIKSI_ROTATING_FILE_HPP
+#define PIKSI_ROTATING_FILE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace piksi {
+
+enum class FsyncPolicy {
+    kNone,     // leave it to the kernel
+    kBatch,    // fsync after every batch written
+    kPeriodic, // fsync at most once per period
+};
+
+// Parses "none", "batch" or "periodic"; false if unknown.
+bool parse_fsync_policy(const std::string& value, FsyncPolicy* policy);
+
+struct RotationOptions {
+    std::string directory = ".";
+    std::string suffix;                // e.g. "_gps_data.csv"
+    uint64_t rotate_bytes = 0;         // 0: no size limit
+    int rotate_seconds = 0;            // 0: no time limit
+    FsyncPolicy fsync = FsyncPolicy::kNone;
+    int fsync_period_ms = 1000;
+};
+
+// Append-only file named after its creation time (local time, like
+// "2024-03-01_12-00-00<suffix>"), replaced by a fresh one once it exceeds the
+// configured size or age. Written with plain write(2) calls by one thread.
+class RotatingFile {
+public:
+    explicit RotatingFile(const RotationOptions& options);
+    ~RotatingFile();
+
+    // Written at the start of every file.
+    void set_header(const std::string& header) { header_ = header; }
+
+    bool write(const char* data, size_t n);
+    // Applies the fsync policy at the end of a batch.
+    void end_batch();
+    void close();
+
+    const std::string& path() const { return path_; }
+    uint64_t files_opened() const { return files_opened_; }
+
+private:
+    RotationOptions options_;
+    std::string header_;
+    std::string path_;
+    int fd_ = -1;
+    uint64_t bytes_ = 0;
+    uint64_t files_opened_ = 0;
+    std::chrono::steady_clock::time_point opened_at_;
+    std::chrono::steady_clock::time_point last_sync_;
+
+    bool open_next();
+    bool write_all(const char* data, size_t n);
+};
+
+} // namespace piksi
+
+#endif
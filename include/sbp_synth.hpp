@@ -0,0 +1,41 @@
+#ifndef PIKSI_SBP_SYNTH_HPP
+#define PIKSI_SBP_SYNTH_HPP
+
+#include <libsbp/sbp.h>
+#include <vector>
+
+namespace piksi {
+
+// Frames a receiver sitting at RTK Fixed would send, for piksi_bench and
+// piksi_sim. Every frame is complete (preamble, header, CRC) and is appended
+// to the caller's buffer; the position creeps north from epoch to epoch so
+// consecutive solutions differ.
+class SbpSynth {
+public:
+    explicit SbpSynth(u16 sender_id = 0x42);
+
+    void heartbeat(std::vector<u8>& out);
+    // GPS_TIME, UTC_TIME, POS_ECEF, POS_LLH, BASELINE_NED and VEL_NED for one
+    // solution epoch, in the order a Piksi Multi sends them. UTC_TIME follows
+    // from the GPS time.
+    void epoch(std::vector<u8>& out, u16 week, u32 tow_ms);
+    // IMU_RAW at tow_ms + tow_f/256 ms: level and still, plus a little noise.
+    void imu_raw(std::vector<u8>& out, u32 tow_ms, u8 tow_f);
+    // IMU_AUX for the default BMI160 ranges (see ImuInfo).
+    void imu_aux(std::vector<u8>& out);
+    // AGE_CORRECTIONS in deciseconds (0xFFFF: no corrections).
+    void age_corrections(std::vector<u8>& out, u32 tow_ms, u16 age_ds);
+    void message(std::vector<u8>& out, u16 msg_type, const void* payload, u8 len);
+
+private:
+    sbp_state_t state_;
+    u16 sender_id_;
+    u64 epochs_ = 0;
+    u32 noise_ = 1;
+
+    static s32 append_bytes(u8 *buff, u32 n, void *context);
+};
+
+} // namespace piksi
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef PIKSI_SETTINGS_HPP
+#define PIKSI_SETTINGS_HPP
+
+#include "transport.hpp"
+#include <libsbp/sbp.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace piksi {
+
+// One receiver setting, e.g. {"solution", "soln_freq", "10"}.
+struct Setting {
+    std::string section;
+    std::string name;
+    std::string value;
+};
+
+// Parses "section.name" (the part of a "setting.section.name" config key
+// after the prefix); false if either part is missing.
+bool parse_setting_key(const std::string& key, Setting* setting);
+
+// Talks to the receiver's settings service over the owner's open transport.
+// It has no parser of its own: while waiting for a response it calls `step`,
+// which decodes the next bytes through the owner's normal read path and
+// hands SETTINGS_WRITE_RESP and SETTINGS_READ_RESP to on_write_resp() and
+// on_read_resp(). Solutions, metrics and capture keep running meanwhile.
+//
+// Writes are pipelined: every outstanding SETTINGS_WRITE is sent, then the
+// WRITE_RESPs are collected until the timeout, and only the unanswered ones
+// are resent, up to `retries` times. An accepted write is then confirmed
+// with a SETTINGS_READ_REQ whose READ_RESP must carry the written value.
+class SettingsManager {
+public:
+    // One decoding step; false once the link is gone and waiting is pointless.
+    using Step = std::function<bool()>;
+
+    SettingsManager(Transport& transport, int timeout_ms, int retries, Step step);
+
+    // True if every setting was accepted and read back with its value.
+    bool write_all(const std::vector<Setting>& settings);
+    // Reads one setting; false on timeout.
+    bool read(const std::string& section, const std::string& name, std::string* value);
+    // Changes <uart>.baudrate on the receiver and the host port together,
+    // verifying the link at the new rate. On failure both sides are brought
+    // back to the old rate; rates_unknown() is then set if the receiver
+    // answers at neither.
+    bool switch_baud(const std::string& uart, int from_baud, int to_baud);
+    bool rates_unknown() const { return rates_unknown_; }
+    // Persists the current settings to the receiver's flash.
+    bool save();
+
+    void on_write_resp(u8 len, const u8 msg[]);
+    void on_read_resp(u8 len, const u8 msg[]);
+
+private:
+    struct Pending {
+        const Setting* setting;
+        int status; // WRITE_RESP status, -1 while unanswered
+    };
+
+    Transport& transport_;
+    std::chrono::milliseconds timeout_;
+    int retries_;
+    Step step_;
+    sbp_state_t state_; // only frames outgoing messages
+    std::vector<Pending> pending_;
+    std::string read_key_;   // "section\0name" awaited by read()
+    std::string read_value_;
+    bool read_done_ = false;
+    bool rates_unknown_ = false;
+
+    bool send(u16 msg_type, const std::string& payload);
+    bool write_baud(const std::string& uart, int baud);
+    bool restore_baud(const std::string& uart, int from_baud, int to_baud);
+    // Decodes until done() or the timeout expires.
+    bool pump(const std::function<bool()>& done);
+
+    static s32 port_write(u8 *buff, u32 n, void *context);
+};
+
+} // namespace piksi
+
+#endif
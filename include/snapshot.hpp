@@ -0,0 +1,95 @@
+#ifndef PIKSI_SNAPSHOT_HPP
+#define PIKSI_SNAPSHOT_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace piksi {
+
+// Latest-value handoff from one writer thread to any number of readers.
+//
+// The value lives behind a seqlock: the writer never waits on readers, and a
+// reader that overlaps a write simply copies again, so a read always returns
+// one complete value. Readers may also sleep until a newer value is stored;
+// the writer only touches the mutex when someone is actually waiting.
+template <typename T>
+class Snapshot {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshot requires a trivially copyable type");
+
+public:
+    // Writer side. Must only be called from one thread.
+    void store(const T& value) {
+        uint64_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&value_, &value, sizeof(T));
+        seq_.store(seq + 2, std::memory_order_release);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) > 0) {
+            { std::lock_guard<std::mutex> lock(mutex_); }
+            cv_.notify_all();
+        }
+    }
+
+    // Number of values stored so far; 0 until the first store().
+    uint64_t version() const {
+        return seq_.load(std::memory_order_acquire) / 2;
+    }
+
+    // Copies the latest value into out and returns its version (0: nothing stored yet).
+    uint64_t load(T& out) const {
+        for (;;) {
+            uint64_t before = seq_.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::memcpy(&out, &value_, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == before) {
+                return before / 2;
+            }
+        }
+    }
+
+    // Blocks until a value newer than `seen` is stored, copies it into out and
+    // updates `seen`. Returns false on timeout.
+    bool wait_newer(uint64_t& seen, T& out, std::chrono::milliseconds timeout) {
+        if (version() <= seen) {
+            waiters_.fetch_add(1, std::memory_order_seq_cst);
+            std::unique_lock<std::mutex> lock(mutex_);
+            bool ready = cv_.wait_for(lock, timeout, [&] { return version() > seen; });
+            lock.unlock();
+            waiters_.fetch_sub(1, std::memory_order_relaxed);
+            if (!ready) {
+                return false;
+            }
+        }
+        seen = load(out);
+        return true;
+    }
+
+    // Wakes every waiting reader without storing a value (used on shutdown).
+    void notify_all() {
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        cv_.notify_all();
+    }
+
+private:
+    std::atomic<uint64_t> seq_{0};
+    T value_{};
+    std::atomic<int> waiters_{0};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+} // namespace piksi
+
+#endif
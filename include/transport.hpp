@@ -0,0 +1,135 @@
+#ifndef PIKSI_TRANSPORT_HPP
+#define PIKSI_TRANSPORT_HPP
+
+#include <libserialport.h>
+#include <libsbp/sbp.h>
+#include "gps_time.hpp"
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+
+namespace piksi {
+
+struct TransportStats {
+    u64 bytes;    // bytes received
+    u64 reads;    // read(2) calls (or file reads) that returned data
+    u64 timeouts; // reads that gave up after the read timeout
+};
+
+// Byte source/sink the SBP parser reads from and writes to.
+//
+// read() returns the number of bytes copied, 0 when nothing arrived within
+// the transport's timeout, or SBP_READ_ERROR. write() may be called from a
+// thread other than the one that reads, opens and closes.
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    virtual bool open() = 0;
+    virtual void close() = 0;
+    virtual s32 read(u8 *buff, u32 n) = 0;
+    virtual s32 write(const u8 *buff, u32 n) = 0;
+    // True once the source can never produce another byte (end of a recording).
+    virtual bool eof() const { return false; }
+    // Changes the host line rate (serial only), discarding unread input; on a
+    // closed port, sets the rate the next open() uses.
+    virtual bool set_baud(int baud) { (void)baud; return true; }
+    // Suppresses progress and error messages from open() and close(), for
+    // reconnect attempts that report on their own.
+    void set_quiet(bool quiet) { quiet_ = quiet; }
+    TransportStats stats() const { return stats_; }
+    // Host clocks when the bytes most recently handed out came off the wire.
+    HostTime rx_time() const { return rx_time_; }
+
+protected:
+    TransportStats stats_ = {};
+    HostTime rx_time_ = {};
+    bool quiet_ = false;
+
+    std::ostream& info() { return quiet_ ? null_ : std::cout; }
+    std::ostream& error() { return quiet_ ? null_ : std::cerr; }
+
+private:
+    std::ostream null_{nullptr}; // discards everything written to it
+};
+
+// Live receiver on a serial port.
+//
+// The port is opened through libserialport but read directly from its file
+// descriptor: each wakeup (epoll on Linux, poll elsewhere) drains everything
+// the kernel has buffered into a 64 KiB receive buffer, and the SBP parser's
+// small reads are then served from memory.
+class SerialTransport : public Transport {
+public:
+    SerialTransport(const std::string& port, int baud_rate, int read_timeout_ms = 100);
+    ~SerialTransport() override;
+
+    bool open() override;
+    void close() override;
+    s32 read(u8 *buff, u32 n) override;
+    s32 write(const u8 *buff, u32 n) override;
+    bool set_baud(int baud) override;
+
+private:
+    std::string port_name_;
+    int baud_rate_;
+    int read_timeout_ms_;
+    std::mutex port_mutex_;  // port_ against write() from another thread, held per chunk
+    std::mutex write_mutex_; // one write() at a time, so frames never interleave
+    std::atomic<u32> generation_{0}; // bumped by close() to abandon a pending write
+    struct sp_port *port_ = nullptr;
+    int fd_ = -1;
+    int poll_fd_ = -1;
+
+    std::vector<u8> rx_;
+    size_t head_ = 0;
+    size_t tail_ = 0;
+
+    bool setup_port(int baud);
+    bool setup_polling();
+    void release_port();
+    int wait_readable();
+    s32 fill();
+};
+
+// Recorded .sbp byte stream from a file, or stdin when the path is "-".
+// With realtime pacing, frames are released according to the GPS time of week
+// they carry; otherwise the stream is fed as fast as the parser consumes it.
+class ReplayTransport : public Transport {
+public:
+    ReplayTransport(const std::string& path, bool realtime);
+    ~ReplayTransport() override;
+
+    bool open() override;
+    void close() override;
+    s32 read(u8 *buff, u32 n) override;
+    s32 write(const u8 *buff, u32 n) override;
+    bool eof() const override;
+
+private:
+    std::string path_;
+    bool realtime_;
+    std::FILE *file_ = nullptr;
+    bool file_eof_ = false;
+
+    std::vector<u8> buffer_;
+    size_t head_ = 0;     // next byte handed to the parser
+    size_t released_ = 0; // end of the bytes already paced out
+    size_t tail_ = 0;     // end of the bytes read from the file
+
+    bool paced_ = false;
+    u32 base_tow_ = 0;
+    std::chrono::steady_clock::time_point base_time_;
+
+    bool ensure(size_t n);
+    bool release_next();
+    void pace(u32 tow);
+};
+
+} // namespace piksi
+
+#endif
@@ -1,14 +1,15 @@
 import zenoh
 import json
+import struct
 import sys
 import argparse
-import os
 import csv
 from datetime import datetime
 
 # Parse command line arguments
 parser = argparse.ArgumentParser(description="Zenoh GPS Data Subscriber")
 parser.add_argument('--save-csv', action='store_true', help='Save received data to gps_data.csv')
+parser.add_argument('--imu', action='store_true', help='Also print IMU batches from fdcl/piksi/imu')
 args = parser.parse_args()
 
 # Zenoh configuration for UDP transport
@@ -18,33 +19,120 @@ conf.insert_json5('listen/endpoints', '["udp/0.0.0.0:7447"]')
 
 session = zenoh.open(conf)
 
+# Binary payload layout, mirrors encode_binary() in include/piksi_format.hpp
+BINARY_MAGIC = b'PK'
+BINARY_LAYOUTS = {
+    1: (struct.Struct('<2sBBIdfBBBxddiidddffdddfdddffdddff'),
+        ['utc_timestamp', 'utc', 'hr', 'min', 'sec', 'ms', 'frequency', 'status', 'sats',
+         'lat', 'lon', 'h', 'S_llh_h', 'S_llh_v', 'ecef_x', 'ecef_y', 'ecef_z', 'S_ecef',
+         'n', 'e', 'd', 'S_rtk_x_h', 'S_rtk_x_v', 'v_n', 'v_e', 'v_d', 'S_rtk_v_h', 'S_rtk_v_v']),
+    2: (struct.Struct('<2sBBIdfBBBBddiidddffdddfdddffdddffI'),
+        ['utc_timestamp', 'utc', 'hr', 'min', 'sec', 'epoch_parts', 'ms', 'frequency', 'status', 'sats',
+         'lat', 'lon', 'h', 'S_llh_h', 'S_llh_v', 'ecef_x', 'ecef_y', 'ecef_z', 'S_ecef',
+         'n', 'e', 'd', 'S_rtk_x_h', 'S_rtk_x_v', 'v_n', 'v_e', 'v_d', 'S_rtk_v_h', 'S_rtk_v_v', 'tow']),
+    3: (struct.Struct('<2sBBIdfBBBBddiidddffdddfdddffdddffIqqH2x'),
+        ['utc_timestamp', 'utc', 'hr', 'min', 'sec', 'epoch_parts', 'ms', 'frequency', 'status', 'sats',
+         'lat', 'lon', 'h', 'S_llh_h', 'S_llh_v', 'ecef_x', 'ecef_y', 'ecef_z', 'S_ecef',
+         'n', 'e', 'd', 'S_rtk_x_h', 'S_rtk_x_v', 'v_n', 'v_e', 'v_d', 'S_rtk_v_h', 'S_rtk_v_v', 'tow',
+         'host_mono_ns', 'host_real_ns', 'gps_week']),
+    4: (struct.Struct('<2sBBIdfBBBBddiidddffdddfdddffdddffIqqH2xddd'),
+        ['utc_timestamp', 'utc', 'hr', 'min', 'sec', 'epoch_parts', 'ms', 'frequency', 'status', 'sats',
+         'lat', 'lon', 'h', 'S_llh_h', 'S_llh_v', 'ecef_x', 'ecef_y', 'ecef_z', 'S_ecef',
+         'n', 'e', 'd', 'S_rtk_x_h', 'S_rtk_x_v', 'v_n', 'v_e', 'v_d', 'S_rtk_v_h', 'S_rtk_v_v', 'tow',
+         'host_mono_ns', 'host_real_ns', 'gps_week', 'local_e', 'local_n', 'local_u']),
+}
+
+# Binary topic slices (<key>/llh, /vel, /baseline, /time), mirrors encode_topic()
+TOPIC_MAGIC = b'PT'
+TOPIC_HEADER = struct.Struct('<2sBBIIBBBxq')
+TOPIC_LAYOUTS = {
+    1: (struct.Struct('<dddff'), ['lat', 'lon', 'h', 'S_llh_h', 'S_llh_v']),
+    2: (struct.Struct('<dddff'), ['v_n', 'v_e', 'v_d', 'S_rtk_v_h', 'S_rtk_v_v']),
+    3: (struct.Struct('<dddff'), ['n', 'e', 'd', 'S_rtk_x_h', 'S_rtk_x_v']),
+    4: (struct.Struct('<ddqHBBB3x'), ['utc_timestamp', 'ms', 'host_real_ns', 'gps_week', 'hr', 'min', 'sec']),
+}
+
+def decode_topic(payload):
+    magic, version, topic, seq, tow, status, sats, flags, host_mono_ns = TOPIC_HEADER.unpack_from(payload)
+    if version != 1 or topic not in TOPIC_LAYOUTS:
+        raise ValueError(f"unsupported topic payload v{version} topic {topic}")
+    layout, names = TOPIC_LAYOUTS[topic]
+    data = dict(zip(names, layout.unpack_from(payload, TOPIC_HEADER.size)))
+    data.update(seq=seq, tow=tow, status=status, sats=sats, rtk_solution=bool(flags & 0x01),
+                host_mono_ns=host_mono_ns)
+    return data
+
+def decode_payload(payload):
+    """Decode either payload_format published by piksi_gps into a dict."""
+    if payload[:2] == TOPIC_MAGIC:
+        return decode_topic(payload)
+    if payload[:2] != BINARY_MAGIC:
+        return json.loads(payload.decode('utf-8'))
+    version = payload[2]
+    if version not in BINARY_LAYOUTS:
+        raise ValueError(f"unsupported binary payload version {version}")
+    layout, names = BINARY_LAYOUTS[version]
+    fields = layout.unpack_from(payload)
+    data = dict(zip(names, fields[4:]))
+    data['rtk_solution'] = bool(fields[2] & 0x01)
+    data['seq'] = fields[3]
+    return data
+
+# IMU batch layout, mirrors encode_imu_header()/encode_imu_sample() in include/piksi_format.hpp
+IMU_MAGIC = b'PI'
+IMU_HEADER = struct.Struct('<2sBBIBB2xf')
+IMU_SAMPLE = struct.Struct('<qqIBB2xffffff')
+IMU_SAMPLE_NAMES = ['host_mono_ns', 'host_real_ns', 'tow', 'tow_f', 'time_status',
+                    'acc_x', 'acc_y', 'acc_z', 'gyr_x', 'gyr_y', 'gyr_z']
+
+def decode_imu_batch(payload):
+    """Decode one IMU batch into (header dict, list of sample dicts)."""
+    magic, version, count, seq, imu_type, imu_conf, temperature = IMU_HEADER.unpack_from(payload)
+    if magic != IMU_MAGIC or version != 1:
+        raise ValueError(f"unsupported IMU payload {magic!r} v{version}")
+    header = {'seq': seq, 'imu_type': imu_type, 'imu_conf': imu_conf, 'temperature': temperature}
+    samples = [dict(zip(IMU_SAMPLE_NAMES, IMU_SAMPLE.unpack_from(payload, IMU_HEADER.size + i * IMU_SAMPLE.size)))
+               for i in range(count)]
+    return header, samples
+
+def imu_listener(sample):
+    try:
+        header, samples = decode_imu_batch(sample.payload.to_bytes())
+        print(f"Received IMU batch {header['seq']}: {len(samples)} samples, {header['temperature']:.1f} C")
+        if samples:
+            print(samples[-1])
+    except Exception as e:
+        print(f"Error decoding IMU payload: {e}")
+
+# One file per session, opened once; piksi_record does the same natively at higher rates.
+CSV_COLUMNS = ['seq', 'utc_timestamp', 'utc', 'hr', 'min', 'sec', 'ms', 'frequency', 'rtk_solution', 'status', 'lat', 'lon', 'h', 'S_llh_h', 'S_llh_v', 'ecef_x', 'ecef_y', 'ecef_z', 'S_ecef', 'n', 'e', 'd', 'S_rtk_x_h', 'S_rtk_x_v', 'v_n', 'v_e', 'v_d', 'S_rtk_v_h', 'S_rtk_v_v', 'sats']
+csv_file = None
+csv_writer = None
+if args.save_csv:
+    csv_file = open(f"{datetime.now().strftime('%Y-%m-%d_%H-%M-%S')}_gps_data.csv", 'w', newline='')
+    csv_writer = csv.writer(csv_file)
+    csv_writer.writerow([col.upper() for col in CSV_COLUMNS])  # Match C++ header style
+
 def listener(sample):
     try:
-        # Assuming the version uses to_bytes().decode('utf-8')
-        payload_str = sample.payload.to_bytes().decode('utf-8')
-        data = json.loads(payload_str)
+        data = decode_payload(sample.payload.to_bytes())
         print("Received GPS data:")
         print(data)
 
-        if args.save_csv:
-            # Generate filename with current date and time
-            current_time = datetime.now().strftime("%Y-%m-%d_%H-%M-%S")
-            file = f"{current_time}_gps_data.csv"
-            columns = ['utc_timestamp', 'utc', 'hr', 'min', 'sec', 'ms', 'frequency', 'rtk_solution', 'status', 'lat', 'lon', 'h', 'S_llh_h', 'S_llh_v', 'ecef_x', 'ecef_y', 'ecef_z', 'S_ecef', 'n', 'e', 'd', 'S_rtk_x_h', 'S_rtk_x_v', 'v_n', 'v_e', 'v_d', 'S_rtk_v_h', 'S_rtk_v_v', 'sats']
-            row = [data.get(col, '') for col in columns]
-            file_exists = os.path.exists(file) and os.path.getsize(file) > 0
-            with open(file, 'a', newline='') as f:
-                writer = csv.writer(f)
-                if not file_exists:
-                    writer.writerow([col.upper() for col in columns])  # Match C++ header style
-                writer.writerow(row)
+        if csv_writer:
+            csv_writer.writerow([data.get(col, '') for col in CSV_COLUMNS])
     except Exception as e:
         print(f"Error decoding payload: {e}")
 
 sub = session.declare_subscriber('fdcl/piksi', listener)
+imu_sub = session.declare_subscriber('fdcl/piksi/imu', imu_listener) if args.imu else None
 
 print("Subscribed to 'fdcl/piksi'. Press Ctrl+C to exit.")
 sys.stdin.readline()
 
 sub.undeclare()
-session.close()
\ No newline at end of file
+if imu_sub:
+    imu_sub.undeclare()
+session.close()
+if csv_file:
+    csv_file.close()
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "alloc_counter.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Compiled only with PIKSI_ALLOC_COUNTER (see CMakeLists.txt).
+
+namespace piksi {
+
+static thread_local u64 t_allocs = 0;
+static std::atomic<u64> g_allocs{0};
+
+u64 thread_allocations() {
+    return t_allocs;
+}
+
+u64 total_allocations() {
+    return g_allocs.load(std::memory_order_relaxed);
+}
+
+} // namespace piksi
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(std::size_t size) {
+    piksi::t_allocs++;
+    piksi::g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+#pragma GCC diagnostic pop
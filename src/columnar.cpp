@@ -0,0 +1,315 @@
+#include "columnar.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace piksi {
+
+static const char kFileMagic[4] = {'P', 'C', 'O', 'L'};
+static const char kBlockMagic[4] = {'P', 'C', 'B', 'K'};
+
+static size_t pad8(size_t n) {
+    return (n + 7) & ~static_cast<size_t>(7);
+}
+
+size_t column_width(ColumnType type) {
+    switch (type) {
+    case ColumnType::kF64:
+    case ColumnType::kS64:
+        return 8;
+    case ColumnType::kF32:
+    case ColumnType::kU32:
+    case ColumnType::kS32:
+        return 4;
+    case ColumnType::kU16:
+        return 2;
+    case ColumnType::kU8:
+    case ColumnType::kBool:
+        return 1;
+    }
+    return 0;
+}
+
+#define PIKSI_COLUMN(name, type) {#name, ColumnType::type, offsetof(PiksiData, name)}
+const std::vector<Column>& columnar_schema() {
+    static const std::vector<Column> schema = {
+        PIKSI_COLUMN(utc_timestamp, kF64), PIKSI_COLUMN(tow, kU32), PIKSI_COLUMN(gps_week, kU16),
+        PIKSI_COLUMN(host_mono_ns, kS64), PIKSI_COLUMN(host_real_ns, kS64),
+        PIKSI_COLUMN(utc, kF32), PIKSI_COLUMN(hr, kU8), PIKSI_COLUMN(min, kU8), PIKSI_COLUMN(sec, kU8),
+        PIKSI_COLUMN(ms, kF64), PIKSI_COLUMN(frequency, kF64), PIKSI_COLUMN(rtk_solution, kBool),
+        PIKSI_COLUMN(status, kS32), PIKSI_COLUMN(sats, kS32), PIKSI_COLUMN(epoch_parts, kU8),
+        PIKSI_COLUMN(lat, kF64), PIKSI_COLUMN(lon, kF64), PIKSI_COLUMN(h, kF64),
+        PIKSI_COLUMN(S_llh_h, kF32), PIKSI_COLUMN(S_llh_v, kF32),
+        PIKSI_COLUMN(ecef_x, kF64), PIKSI_COLUMN(ecef_y, kF64), PIKSI_COLUMN(ecef_z, kF64),
+        PIKSI_COLUMN(S_ecef, kF32),
+        PIKSI_COLUMN(n, kF64), PIKSI_COLUMN(e, kF64), PIKSI_COLUMN(d, kF64),
+        PIKSI_COLUMN(S_rtk_x_h, kF32), PIKSI_COLUMN(S_rtk_x_v, kF32),
+        PIKSI_COLUMN(v_n, kF64), PIKSI_COLUMN(v_e, kF64), PIKSI_COLUMN(v_d, kF64),
+        PIKSI_COLUMN(S_rtk_v_h, kF32), PIKSI_COLUMN(S_rtk_v_v, kF32),
+        PIKSI_COLUMN(local_e, kF64), PIKSI_COLUMN(local_n, kF64), PIKSI_COLUMN(local_u, kF64),
+    };
+    return schema;
+}
+#undef PIKSI_COLUMN
+
+double record_time(const PiksiData& data) {
+    return data.utc_timestamp >= 0.0 ? data.utc_timestamp : data.host_real_ns * 1e-9;
+}
+
+template <typename T>
+static void append(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+std::string columnar_header() {
+    std::string header(kFileMagic, sizeof(kFileMagic));
+    const std::vector<Column>& schema = columnar_schema();
+    append<u16>(header, kColumnarVersion);
+    append<u16>(header, static_cast<u16>(schema.size()));
+    for (const Column& column : schema) {
+        size_t len = std::strlen(column.name);
+        append<u8>(header, static_cast<u8>(column.type));
+        append<u8>(header, static_cast<u8>(len));
+        header.append(column.name, len);
+    }
+    header.resize(pad8(header.size()), '\0');
+    return header;
+}
+
+void append_columnar_block(std::string& out, const PiksiData* rows, size_t n) {
+    size_t start = out.size();
+    double t_min = 0.0;
+    double t_max = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double t = record_time(rows[i]);
+        t_min = (i == 0) ? t : std::min(t_min, t);
+        t_max = (i == 0) ? t : std::max(t_max, t);
+    }
+    out.append(kBlockMagic, sizeof(kBlockMagic));
+    append<u32>(out, static_cast<u32>(n));
+    append<u64>(out, 0); // block size, filled in below
+    append<double>(out, t_min);
+    append<double>(out, t_max);
+
+    // Transposes the rows: each field is copied out of every record in turn.
+    for (const Column& column : columnar_schema()) {
+        size_t width = column_width(column.type);
+        size_t offset = out.size();
+        out.resize(offset + pad8(width * n), '\0');
+        char* p = &out[offset];
+        for (size_t i = 0; i < n; ++i, p += width) {
+            std::memcpy(p, reinterpret_cast<const char*>(&rows[i]) + column.offset, width);
+        }
+    }
+    u64 size = out.size() - start;
+    std::memcpy(&out[start + 8], &size, sizeof(size));
+}
+
+ColumnarReader::~ColumnarReader() {
+    close();
+}
+
+void ColumnarReader::close() {
+    if (map_) {
+        ::munmap(const_cast<u8*>(map_), size_);
+        map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    columns_.clear();
+    blocks_.clear();
+    rows_ = 0;
+    trailing_ = 0;
+    t_min_ = t_max_ = 0.0;
+    time_ordered_ = true;
+}
+
+template <typename T>
+static T load(const u8* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+bool ColumnarReader::open(const std::string& path) {
+    close();
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd_ < 0 || ::fstat(fd_, &st) != 0) {
+        std::cerr << "Log: Cannot open " << path << ": " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ < 8) {
+        std::cerr << "Log: " << path << " is not a columnar log." << std::endl;
+        close();
+        return false;
+    }
+    void* map = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        std::cerr << "Log: Cannot map " << path << ": " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    map_ = static_cast<const u8*>(map);
+
+    if (std::memcmp(map_, kFileMagic, sizeof(kFileMagic)) != 0 || load<u16>(map_ + 4) == 0 ||
+        load<u16>(map_ + 4) > kColumnarVersion) {
+        std::cerr << "Log: " << path << " is not a columnar log this version can read." << std::endl;
+        close();
+        return false;
+    }
+    u16 count = load<u16>(map_ + 6);
+    size_t p = 8;
+    const std::vector<Column>& schema = columnar_schema();
+    for (u16 i = 0; i < count; ++i) {
+        if (p + 2 > size_ || p + 2 + map_[p + 1] > size_ || map_[p] > static_cast<u8>(ColumnType::kBool)) {
+            std::cerr << "Log: " << path << " has a corrupt header." << std::endl;
+            close();
+            return false;
+        }
+        FileColumn column;
+        column.type = static_cast<ColumnType>(map_[p]);
+        column.name.assign(reinterpret_cast<const char*>(map_ + p + 2), map_[p + 1]);
+        column.schema_index = -1;
+        for (size_t s = 0; s < schema.size(); ++s) {
+            if (column.name == schema[s].name && column.type == schema[s].type) {
+                column.schema_index = static_cast<int>(s);
+            }
+        }
+        columns_.push_back(column);
+        p += 2 + map_[p + 1];
+    }
+    p = pad8(p);
+
+    // Walk the block headers; only one page per block is touched.
+    while (p + kColumnarBlockHeaderSize <= size_) {
+        const u8* header = map_ + p;
+        u64 block_size = load<u64>(header + 8);
+        if (std::memcmp(header, kBlockMagic, sizeof(kBlockMagic)) != 0 || block_size < kColumnarBlockHeaderSize ||
+            block_size > size_ - p) {
+            break;
+        }
+        u32 rows = load<u32>(header + 4);
+        u64 expected = kColumnarBlockHeaderSize;
+        for (const FileColumn& column : columns_) {
+            expected += pad8(column_width(column.type) * rows);
+        }
+        if (expected != block_size) {
+            break;
+        }
+        Block block;
+        block.offset = p;
+        block.rows = rows;
+        block.t_min = load<double>(header + 16);
+        block.t_max = load<double>(header + 24);
+        block.first_row = rows_;
+        blocks_.push_back(block);
+        rows_ += block.rows;
+        p += block_size;
+    }
+    trailing_ = size_ - p;
+
+    for (size_t b = 0; b < blocks_.size(); ++b) {
+        const Block& block = blocks_[b];
+        t_min_ = b == 0 ? block.t_min : std::min(t_min_, block.t_min);
+        t_max_ = b == 0 ? block.t_max : std::max(t_max_, block.t_max);
+        if (b > 0 && (block.t_min < blocks_[b - 1].t_min || block.t_max < blocks_[b - 1].t_max)) {
+            time_ordered_ = false;
+        }
+    }
+    return true;
+}
+
+int ColumnarReader::find_column(const std::string& name) const {
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        if (columns_[i].name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void ColumnarReader::blocks_in_range(double t_from, double t_to, size_t* first, size_t* last) const {
+    if (!time_ordered_) {
+        // Binary searches would skip or misplace blocks; check every one instead.
+        *first = *last = 0;
+        bool found = false;
+        for (size_t b = 0; b < blocks_.size(); ++b) {
+            if (blocks_[b].t_max >= t_from && blocks_[b].t_min <= t_to) {
+                *first = found ? *first : b;
+                *last = b + 1;
+                found = true;
+            }
+        }
+        return;
+    }
+    // Blocks are appended in time order, so both bounds are binary searches.
+    auto begin = std::partition_point(blocks_.begin(), blocks_.end(),
+                                      [t_from](const Block& b) { return b.t_max < t_from; });
+    auto end = std::partition_point(begin, blocks_.end(), [t_to](const Block& b) { return b.t_min <= t_to; });
+    *first = static_cast<size_t>(begin - blocks_.begin());
+    *last = static_cast<size_t>(end - blocks_.begin());
+}
+
+const u8* ColumnarReader::column_data(size_t block, size_t column) const {
+    const Block& b = blocks_[block];
+    size_t offset = b.offset + kColumnarBlockHeaderSize;
+    for (size_t i = 0; i < column; ++i) {
+        offset += pad8(column_width(columns_[i].type) * b.rows);
+    }
+    return map_ + offset;
+}
+
+double ColumnarReader::value(size_t block, size_t column, u32 row) const {
+    ColumnType type = columns_[column].type;
+    const u8* p = column_data(block, column) + column_width(type) * row;
+    switch (type) {
+    case ColumnType::kF64: return load<double>(p);
+    case ColumnType::kF32: return load<float>(p);
+    case ColumnType::kU8: return load<u8>(p);
+    case ColumnType::kU16: return load<u16>(p);
+    case ColumnType::kU32: return load<u32>(p);
+    case ColumnType::kS32: return load<s32>(p);
+    case ColumnType::kS64: return static_cast<double>(load<s64>(p));
+    case ColumnType::kBool: return load<u8>(p) ? 1.0 : 0.0;
+    }
+    return 0.0;
+}
+
+s64 ColumnarReader::value_s64(size_t block, size_t column, u32 row) const {
+    if (columns_[column].type == ColumnType::kS64) {
+        return load<s64>(column_data(block, column) + 8 * static_cast<size_t>(row));
+    }
+    return static_cast<s64>(value(block, column, row));
+}
+
+const double* ColumnarReader::column_f64(size_t block, size_t column) const {
+    if (columns_[column].type != ColumnType::kF64) {
+        return nullptr;
+    }
+    return reinterpret_cast<const double*>(column_data(block, column));
+}
+
+void ColumnarReader::read_row(size_t block, u32 row, PiksiData* data) const {
+    std::memset(data, 0, sizeof(*data));
+    const std::vector<Column>& schema = columnar_schema();
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        if (columns_[i].schema_index < 0) {
+            continue;
+        }
+        size_t width = column_width(columns_[i].type);
+        std::memcpy(reinterpret_cast<u8*>(data) + schema[columns_[i].schema_index].offset,
+                    column_data(block, i) + width * row, width);
+    }
+}
+
+} // namespace piksi
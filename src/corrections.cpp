@@ -0,0 +1,125 @@
+#include "corrections.hpp"
+#include <iostream>
+
+namespace piksi {
+
+CorrectionForwarder::CorrectionForwarder(const CorrectionOptions& options) : options_(options) {}
+
+CorrectionForwarder::~CorrectionForwarder() {
+    stop();
+}
+
+void CorrectionForwarder::start(Transport& transport) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    transport_ = &transport;
+    running_ = true;
+    writer_ = std::thread(&CorrectionForwarder::run, this);
+}
+
+void CorrectionForwarder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    cv_.notify_all();
+    writer_.join();
+    CorrectionStats s = stats();
+    std::cout << "GPS: Forwarded " << s.forwarded << " of " << s.received << " corrections (" << s.bytes
+              << " bytes)";
+    if (s.dropped > 0 || s.write_errors > 0 || s.truncated > 0) {
+        std::cout << ", dropped " << s.dropped << ", " << s.write_errors << " write errors, " << s.truncated
+                  << " truncated";
+    }
+    std::cout << "." << std::endl;
+}
+
+void CorrectionForwarder::push(std::vector<u8> bytes) {
+    s64 now = clock_ns(CLOCK_MONOTONIC);
+    received_.fetch_add(1, std::memory_order_relaxed);
+    last_ns_.store(now, std::memory_order_relaxed);
+    if (bytes.empty()) {
+        return;
+    }
+    if (bytes.size() > options_.queue_bytes) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (queued_bytes_ + bytes.size() > options_.queue_bytes) {
+            queued_bytes_ -= queue_.front().bytes.size();
+            queue_.pop_front();
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        queued_bytes_ += bytes.size();
+        queue_.push_back({std::move(bytes), now});
+        if (queued_bytes_ > queue_max_bytes_.load(std::memory_order_relaxed)) {
+            queue_max_bytes_.store(queued_bytes_, std::memory_order_relaxed);
+        }
+    }
+    cv_.notify_one();
+}
+
+CorrectionStats CorrectionForwarder::stats() const {
+    CorrectionStats s;
+    s.received = received_.load(std::memory_order_relaxed);
+    s.forwarded = forwarded_.load(std::memory_order_relaxed);
+    s.bytes = bytes_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.write_errors = write_errors_.load(std::memory_order_relaxed);
+    s.truncated = truncated_.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        s.queue_bytes = queued_bytes_;
+    }
+    s.queue_max_bytes = queue_max_bytes_.load(std::memory_order_relaxed);
+    s64 last = last_ns_.load(std::memory_order_relaxed);
+    s.last_s = last > 0 ? (clock_ns(CLOCK_MONOTONIC) - last) * 1e-9 : -1.0;
+    u16 age = receiver_age_ds_.load(std::memory_order_relaxed);
+    s.receiver_age_s = age == 0xFFFF ? -1.0 : age / 10.0;
+    return s;
+}
+
+void CorrectionForwarder::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return !queue_.empty() || !running_; });
+        if (!running_) {
+            break; // whatever is still queued would only be stale by the next start
+        }
+        Entry entry = std::move(queue_.front());
+        queue_.pop_front();
+        queued_bytes_ -= entry.bytes.size();
+        lock.unlock();
+
+        s64 now = clock_ns(CLOCK_MONOTONIC);
+        if (now - entry.received_ns > options_.max_age_ms * 1000000LL) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            u32 n = static_cast<u32>(entry.bytes.size());
+            s32 written = transport_->write(entry.bytes.data(), n);
+            if (written > 0) {
+                bytes_.fetch_add(static_cast<u64>(written), std::memory_order_relaxed);
+            }
+            if (written == static_cast<s32>(n)) {
+                forwarded_.fetch_add(1, std::memory_order_relaxed);
+                if (options_.latency) {
+                    options_.latency->record(clock_ns(CLOCK_MONOTONIC) - entry.received_ns);
+                }
+            } else if (written > 0) {
+                truncated_.fetch_add(1, std::memory_order_relaxed); // the transport flushed the rest
+            } else {
+                write_errors_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        lock.lock();
+    }
+}
+
+} // namespace piksi
@@ -0,0 +1,214 @@
+#include "dashboard.hpp"
+#include "piksi_multi_gps.hpp"
+#include "gps_time.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <unistd.h>
+
+namespace piksi {
+
+// Solutions not refreshed for this long are shown as stale.
+static const s64 kStaleNs = 2000000000LL;
+// The solution rate is measured over at least this long, so a refresh faster
+// than the solution rate does not alternate between 0 and 2 per window.
+static const s64 kRateWindowNs = 1000000000LL;
+
+// Fix mode (lower 3 bits of status) and its ANSI color.
+static const char* fix_mode_name(int status, const char** color) {
+    switch (status & 0x07) {
+    case 1: *color = "\033[31m"; return "SPP";       // Red
+    case 2: *color = "\033[36m"; return "DGPS";      // Cyan
+    case 3: *color = "\033[34m"; return "RTK Float"; // Blue
+    case 4: *color = "\033[32m"; return "RTK Fixed"; // Green
+    case 5: *color = "\033[37m"; return "DR";        // White
+    case 6: *color = "\033[35m"; return "SBAS";      // Purple
+    default: *color = "\033[31m"; return "Invalid";  // Red
+    }
+}
+
+Dashboard::Dashboard(std::vector<const PiksiMultiGPS*> receivers, const DashboardOptions& options)
+    : receivers_(std::move(receivers)), views_(receivers_.size()), options_(options) {
+    bool tty = ::isatty(STDOUT_FILENO) == 1;
+    options_.in_place = options_.in_place && tty;
+    color_ = tty;
+    frame_.reserve(4096);
+}
+
+Dashboard::~Dashboard() {
+    stop();
+}
+
+void Dashboard::start() {
+    if (running_ || options_.refresh_hz <= 0 || receivers_.empty()) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&Dashboard::run, this);
+}
+
+void Dashboard::stop() {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    thread_.join();
+    render(clock_ns(CLOCK_MONOTONIC));
+}
+
+void Dashboard::run() {
+    auto period = std::chrono::microseconds(1000000 / options_.refresh_hz);
+    auto next = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        lock.unlock();
+        render(clock_ns(CLOCK_MONOTONIC));
+        lock.lock();
+        // Fixed schedule; a frame that took longer than a period is not caught up.
+        next = std::max(next + period, std::chrono::steady_clock::now());
+        cv_.wait_until(lock, next, [this] { return !running_; });
+    }
+}
+
+void Dashboard::render(s64 now_ns) {
+    frame_.clear();
+    if (options_.in_place && lines_ > 0) {
+        char up[16];
+        snprintf(up, sizeof(up), "\033[%dA\r", lines_);
+        frame_ += up;
+    }
+    lines_ = 0;
+    for (size_t i = 0; i < receivers_.size(); ++i) {
+        render_receiver(*receivers_[i], views_[i], now_ns);
+    }
+    if (options_.in_place) {
+        frame_ += "\033[J"; // clear whatever a taller previous frame left below
+    } else {
+        frame_ += '\n';
+    }
+    flush();
+}
+
+void Dashboard::render_receiver(const PiksiMultiGPS& gps, ReceiverView& view, s64 now_ns) {
+    PiksiData data;
+    u64 version = gps.latest(data);
+    if (version != view.version) {
+        view.version = version;
+        view.version_ns = now_ns;
+    }
+    if (view.rate_ns == 0) {
+        view.rate_ns = now_ns;
+        view.rate_version = version;
+    } else if (now_ns - view.rate_ns >= kRateWindowNs) {
+        view.rate = (version - view.rate_version) * 1e9 / (now_ns - view.rate_ns);
+        view.rate_ns = now_ns;
+        view.rate_version = version;
+    }
+
+    const std::string& name = gps.get_name();
+    const char* color = "";
+    const char* fix = fix_mode_name(data.status, &color);
+    const char* reset = color_ ? "\033[0m" : "";
+    if (!color_) {
+        color = "";
+    }
+
+    if (version == 0) {
+        line("Piksi Multi GPS%s%s%s  waiting for the first solution", name.empty() ? "" : " [",
+             name.c_str(), name.empty() ? "" : "]");
+    } else {
+        line("Piksi Multi GPS%s%s%s  %02d:%02d:%06.3f UTC  week %u  tow %.3f s  #%llu%s",
+             name.empty() ? "" : " [", name.c_str(), name.empty() ? "" : "]", data.hr, data.min,
+             data.sec + data.ms / 1e3, data.gps_week, data.tow / 1e3, static_cast<unsigned long long>(version),
+             now_ns - view.version_ns > kStaleNs ? "  STALE" : "");
+    }
+
+    char latency[32] = "N/A";
+    if (version > 0 && data.utc_timestamp >= 0.0 && data.host_real_ns > 0) {
+        snprintf(latency, sizeof(latency), "%.1f ms", (data.host_real_ns * 1e-9 - data.utc_timestamp) * 1e3);
+    }
+    line("  Fix     %s%-9s%s %s sats %2d   rate %5.1f Hz   latency %s   assemble p99 %.0f us", color,
+         version > 0 ? fix : "-", reset, data.rtk_solution ? "RTK" : "   ", version > 0 ? data.sats : 0, view.rate,
+         latency, gps.get_latency_percentile(Stage::kAssemble, 0.99) / 1e3);
+    line("  LLH     lat %14.9f  lon %14.9f  h %10.3f m     acc h %.3f v %.3f m", data.lat, data.lon, data.h,
+         data.S_llh_h, data.S_llh_v);
+    line("  NED     n %10.3f  e %10.3f  d %10.3f m           acc h %.3f v %.3f m", data.n, data.e, data.d,
+         data.S_rtk_x_h, data.S_rtk_x_v);
+    line("  Vel     n %10.3f  e %10.3f  d %10.3f m/s         acc h %.3f v %.3f m/s", data.v_n, data.v_e, data.v_d,
+         data.S_rtk_v_h, data.S_rtk_v_v);
+
+    ErrorCounts errors = gps.get_errors();
+    EpochStats epochs = gps.get_epoch_stats();
+    LoggerStats log = gps.get_logger_stats();
+    RawCaptureStats capture = gps.get_capture_stats();
+    line("  Errors  crc %llu  read %llu  framing %llu B   epochs partial %llu late %llu   "
+         "log dropped %llu   capture dropped %llu B   imu dropped %llu",
+         static_cast<unsigned long long>(errors.crc), static_cast<unsigned long long>(errors.read),
+         static_cast<unsigned long long>(errors.framing_bytes), static_cast<unsigned long long>(epochs.partial),
+         static_cast<unsigned long long>(epochs.late), static_cast<unsigned long long>(log.dropped),
+         static_cast<unsigned long long>(capture.dropped), static_cast<unsigned long long>(errors.imu_dropped));
+
+    LinkStats link = gps.get_link_stats();
+    line("  Link    %-6s  drops %llu (heartbeat %llu)  reconnects %llu  last outage %.2f s  max %.2f s",
+         link_state_name(link.state), static_cast<unsigned long long>(link.drops),
+         static_cast<unsigned long long>(link.heartbeat_timeouts), static_cast<unsigned long long>(link.reconnects),
+         link.last_outage_s, link.max_outage_s);
+
+    if (gps.forwards_corrections()) {
+        CorrectionStats corr = gps.get_correction_stats();
+        char age[16] = "N/A";
+        if (corr.receiver_age_s >= 0.0) {
+            snprintf(age, sizeof(age), "%.1f s", corr.receiver_age_s);
+        }
+        char last[16] = "never";
+        if (corr.last_s >= 0.0) {
+            snprintf(last, sizeof(last), "%.1f s ago", corr.last_s);
+        }
+        line("  Corr    age %s  last %s  queue %llu B (max %llu)  forwarded %llu  dropped %llu  "
+             "write errors %llu  truncated %llu   p99 %.1f ms",
+             age, last, static_cast<unsigned long long>(corr.queue_bytes),
+             static_cast<unsigned long long>(corr.queue_max_bytes), static_cast<unsigned long long>(corr.forwarded),
+             static_cast<unsigned long long>(corr.dropped), static_cast<unsigned long long>(corr.write_errors),
+             static_cast<unsigned long long>(corr.truncated),
+             gps.get_latency_percentile(Stage::kCorrection, 0.99) / 1e6);
+    }
+}
+
+void Dashboard::line(const char* format, ...) {
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    frame_.append(text, n < 0 ? 0 : std::min<size_t>(n, sizeof(text) - 1));
+    if (options_.in_place) {
+        frame_ += "\033[K"; // the previous frame's line may have been longer
+    }
+    frame_ += '\n';
+    lines_++;
+}
+
+// One write(2) per frame, bypassing the stdio lock that other threads'
+// messages take: a blocked terminal stalls nobody but this thread.
+void Dashboard::flush() {
+    const char* p = frame_.data();
+    size_t left = frame_.size();
+    while (left > 0) {
+        ssize_t n = ::write(STDOUT_FILENO, p, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+}
+
+} // namespace piksi
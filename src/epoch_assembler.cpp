@@ -0,0 +1,106 @@
+#include "epoch_assembler.hpp"
+#include <sstream>
+
+namespace piksi {
+
+static const s64 kMsPerWeek = 604800000;
+
+// Signed difference a - b in ms, accounting for the week rollover.
+static s64 tow_diff(u32 a, u32 b) {
+    s64 d = static_cast<s64>(a) - static_cast<s64>(b);
+    if (d < -kMsPerWeek / 2) {
+        d += kMsPerWeek;
+    } else if (d > kMsPerWeek / 2) {
+        d -= kMsPerWeek;
+    }
+    return d;
+}
+
+u8 parse_epoch_parts(const std::string& list) {
+    u8 parts = 0;
+    std::istringstream is(list);
+    std::string name;
+    while (std::getline(is, name, ',')) {
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        if (name == "utc") {
+            parts |= kPartUtc;
+        } else if (name == "llh") {
+            parts |= kPartLlh;
+        } else if (name == "ecef") {
+            parts |= kPartEcef;
+        } else if (name == "vel") {
+            parts |= kPartVel;
+        } else if (name == "baseline") {
+            parts |= kPartBaseline;
+        } else {
+            return 0;
+        }
+    }
+    return parts;
+}
+
+void EpochAssembler::configure(u8 parts, std::chrono::milliseconds timeout) {
+    configured_ = parts;
+    last_parts_ = parts;
+    timeout_ = timeout;
+}
+
+EpochAssembler::Arrival EpochAssembler::classify(u32 tow, u8 part) {
+    if (open_) {
+        s64 d = tow_diff(tow, tow_);
+        if (d == 0) {
+            return kCurrent;
+        }
+        if (d > 0) {
+            return kNewer;
+        }
+    } else if (!emitted_any_ || tow_diff(tow, last_tow_) > 0) {
+        return kNewer;
+    }
+
+    if ((part & configured_) == 0) {
+        return kLate; // not waited for, so not counted late either
+    }
+    late_++;
+    if (tow == last_tow_) {
+        last_parts_ |= part; // expect it again next epoch
+    }
+    return kLate;
+}
+
+void EpochAssembler::open_epoch(u32 tow, Clock::time_point now) {
+    open_ = true;
+    tow_ = tow;
+    parts_ = 0;
+    opened_at_ = now;
+}
+
+bool EpochAssembler::add(u8 part) {
+    parts_ |= part;
+    u8 expected = configured_ & last_parts_;
+    return expected != 0 && (parts_ & expected) == expected;
+}
+
+bool EpochAssembler::expired(Clock::time_point now) const {
+    return open_ && now - opened_at_ >= timeout_;
+}
+
+void EpochAssembler::close_epoch() {
+    u8 expected = configured_ & last_parts_;
+    if ((parts_ & expected) == expected) {
+        complete_++;
+    } else {
+        partial_++;
+    }
+    open_ = false;
+    emitted_any_ = true;
+    last_tow_ = tow_;
+    last_parts_ = parts_;
+}
+
+EpochStats EpochAssembler::stats() const {
+    return {complete_.load(), partial_.load(), late_.load()};
+}
+
+} // namespace piksi
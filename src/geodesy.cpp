@@ -0,0 +1,222 @@
+#include "geodesy.hpp"
+#include <atomic>
+#include <cmath>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PIKSI_GEODESY_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace piksi {
+
+static const double kDegToRad = M_PI / 180.0;
+
+void llh_to_ecef(double lat_deg, double lon_deg, double h, double ecef[3]) {
+    double lat = lat_deg * kDegToRad;
+    double lon = lon_deg * kDegToRad;
+    double sin_lat = std::sin(lat);
+    double cos_lat = std::cos(lat);
+    double n = kWgs84A / std::sqrt(1.0 - kWgs84E2 * sin_lat * sin_lat); // prime vertical radius
+    ecef[0] = (n + h) * cos_lat * std::cos(lon);
+    ecef[1] = (n + h) * cos_lat * std::sin(lon);
+    ecef[2] = (n * (1.0 - kWgs84E2) + h) * sin_lat;
+}
+
+void ecef_to_llh(const double ecef[3], double* lat_deg, double* lon_deg, double* h) {
+    double p = std::hypot(ecef[0], ecef[1]);
+    double lat = std::atan2(ecef[2], p * (1.0 - kWgs84E2));
+    double height = 0.0;
+    // Converges by about three orders of magnitude per pass from this start.
+    for (int i = 0; i < 4; ++i) {
+        double sin_lat = std::sin(lat);
+        double n = kWgs84A / std::sqrt(1.0 - kWgs84E2 * sin_lat * sin_lat);
+        // This form of the height stays well conditioned at the poles.
+        height = p * std::cos(lat) + ecef[2] * sin_lat - kWgs84A * kWgs84A / n;
+        lat = std::atan2(ecef[2], p * (1.0 - kWgs84E2 * n / (n + height)));
+    }
+    *lat_deg = lat / kDegToRad;
+    *lon_deg = std::atan2(ecef[1], ecef[0]) / kDegToRad;
+    *h = height;
+}
+
+LocalFrame LocalFrame::at(double lat_deg, double lon_deg, double h) {
+    LocalFrame frame;
+    llh_to_ecef(lat_deg, lon_deg, h, frame.origin);
+    double sin_lat = std::sin(lat_deg * kDegToRad);
+    double cos_lat = std::cos(lat_deg * kDegToRad);
+    double sin_lon = std::sin(lon_deg * kDegToRad);
+    double cos_lon = std::cos(lon_deg * kDegToRad);
+    double r[3][3] = {
+        {-sin_lat * cos_lon, -sin_lat * sin_lon, cos_lat},
+        {-sin_lon, cos_lon, 0.0},
+        {-cos_lat * cos_lon, -cos_lat * sin_lon, -sin_lat},
+    };
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            frame.r[i][j] = r[i][j];
+        }
+    }
+    return frame;
+}
+
+void LocalFrame::ecef_to_ned(const double ecef[3], double ned[3]) const {
+    double d[3] = {ecef[0] - origin[0], ecef[1] - origin[1], ecef[2] - origin[2]};
+    for (int i = 0; i < 3; ++i) {
+        ned[i] = r[i][0] * d[0] + r[i][1] * d[1] + r[i][2] * d[2];
+    }
+}
+
+void LocalFrame::ned_to_ecef(const double ned[3], double ecef[3]) const {
+    for (int j = 0; j < 3; ++j) {
+        ecef[j] = origin[j] + r[0][j] * ned[0] + r[1][j] * ned[1] + r[2][j] * ned[2];
+    }
+}
+
+void LocalFrame::ecef_to_enu(const double ecef[3], double enu[3]) const {
+    double ned[3];
+    ecef_to_ned(ecef, ned);
+    enu[0] = ned[1];
+    enu[1] = ned[0];
+    enu[2] = -ned[2];
+}
+
+void LocalFrame::enu_to_ecef(const double enu[3], double ecef[3]) const {
+    double ned[3] = {enu[1], enu[0], -enu[2]};
+    ned_to_ecef(ned, ecef);
+}
+
+void llh_to_ecef(const double* lat_deg, const double* lon_deg, const double* h, size_t n,
+                 double* x, double* y, double* z) {
+    // Bound by sin/cos, which have no vector form without a vector libm.
+    for (size_t i = 0; i < n; ++i) {
+        double ecef[3];
+        llh_to_ecef(lat_deg[i], lon_deg[i], h[i], ecef);
+        x[i] = ecef[0];
+        y[i] = ecef[1];
+        z[i] = ecef[2];
+    }
+}
+
+void ecef_to_llh(const double* x, const double* y, const double* z, size_t n,
+                 double* lat_deg, double* lon_deg, double* h) {
+    const double e4 = kWgs84E2 * kWgs84E2;
+    const double inv_a2 = 1.0 / (kWgs84A * kWgs84A);
+    for (size_t i = 0; i < n; ++i) {
+        double xi = x[i], yi = y[i], zi = z[i];
+        double rho2 = xi * xi + yi * yi;
+        double rho = std::sqrt(rho2);
+        double p = rho2 * inv_a2;
+        double q = (1.0 - kWgs84E2) * zi * zi * inv_a2;
+        double r = (p + q - e4) / 6.0;
+        double s = e4 * p * q / (4.0 * r * r * r);
+        double t = std::cbrt(1.0 + s + std::sqrt(s * (2.0 + s)));
+        double u = r * (1.0 + t + 1.0 / t);
+        double v = std::sqrt(u * u + e4 * q);
+        double w = kWgs84E2 * (u + v - q) / (2.0 * v);
+        double k = std::sqrt(u + v + w * w) - w;
+        double d = k * rho / (k + kWgs84E2);
+        double dz = std::sqrt(d * d + zi * zi);
+        lat_deg[i] = 2.0 * std::atan2(zi, d + dz) / kDegToRad;
+        lon_deg[i] = std::atan2(yi, xi) / kDegToRad;
+        h[i] = (k + kWgs84E2 - 1.0) / k * dz;
+    }
+}
+
+// out = m (in - pre) + post, point by point.
+static void rotate_scalar(const double m[3][3], const double pre[3], const double post[3], const double* a,
+                          const double* b, const double* c, size_t n, double* o0, double* o1, double* o2) {
+    for (size_t i = 0; i < n; ++i) {
+        double d0 = a[i] - pre[0], d1 = b[i] - pre[1], d2 = c[i] - pre[2];
+        o0[i] = m[0][0] * d0 + m[0][1] * d1 + m[0][2] * d2 + post[0];
+        o1[i] = m[1][0] * d0 + m[1][1] * d1 + m[1][2] * d2 + post[1];
+        o2[i] = m[2][0] * d0 + m[2][1] * d1 + m[2][2] * d2 + post[2];
+    }
+}
+
+#ifdef PIKSI_GEODESY_AVX2
+// Four points per iteration; the tail goes through the scalar kernel. Loads
+// come before stores within an iteration, so outputs may alias inputs.
+__attribute__((target("avx2,fma")))
+static void rotate_avx2(const double m[3][3], const double pre[3], const double post[3], const double* a,
+                        const double* b, const double* c, size_t n, double* o0, double* o1, double* o2) {
+    __m256d m00 = _mm256_set1_pd(m[0][0]), m01 = _mm256_set1_pd(m[0][1]), m02 = _mm256_set1_pd(m[0][2]);
+    __m256d m10 = _mm256_set1_pd(m[1][0]), m11 = _mm256_set1_pd(m[1][1]), m12 = _mm256_set1_pd(m[1][2]);
+    __m256d m20 = _mm256_set1_pd(m[2][0]), m21 = _mm256_set1_pd(m[2][1]), m22 = _mm256_set1_pd(m[2][2]);
+    __m256d pre0 = _mm256_set1_pd(pre[0]), pre1 = _mm256_set1_pd(pre[1]), pre2 = _mm256_set1_pd(pre[2]);
+    __m256d post0 = _mm256_set1_pd(post[0]), post1 = _mm256_set1_pd(post[1]), post2 = _mm256_set1_pd(post[2]);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), pre0);
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(b + i), pre1);
+        __m256d d2 = _mm256_sub_pd(_mm256_loadu_pd(c + i), pre2);
+        __m256d r0 = _mm256_fmadd_pd(m02, d2, _mm256_fmadd_pd(m01, d1, _mm256_fmadd_pd(m00, d0, post0)));
+        __m256d r1 = _mm256_fmadd_pd(m12, d2, _mm256_fmadd_pd(m11, d1, _mm256_fmadd_pd(m10, d0, post1)));
+        __m256d r2 = _mm256_fmadd_pd(m22, d2, _mm256_fmadd_pd(m21, d1, _mm256_fmadd_pd(m20, d0, post2)));
+        _mm256_storeu_pd(o0 + i, r0);
+        _mm256_storeu_pd(o1 + i, r1);
+        _mm256_storeu_pd(o2 + i, r2);
+    }
+    rotate_scalar(m, pre, post, a + i, b + i, c + i, n - i, o0 + i, o1 + i, o2 + i);
+}
+
+static bool cpu_has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+#else
+static bool cpu_has_avx2() {
+    return false;
+}
+#endif
+
+static std::atomic<bool>& simd_enabled() {
+    static std::atomic<bool> enabled{cpu_has_avx2()};
+    return enabled;
+}
+
+const char* geodesy_simd() {
+    return simd_enabled().load(std::memory_order_relaxed) ? "avx2" : "scalar";
+}
+
+const char* set_geodesy_simd(bool enabled) {
+    simd_enabled().store(enabled && cpu_has_avx2(), std::memory_order_relaxed);
+    return geodesy_simd();
+}
+
+static void rotate(const double m[3][3], const double pre[3], const double post[3], const double* a,
+                   const double* b, const double* c, size_t n, double* o0, double* o1, double* o2) {
+#ifdef PIKSI_GEODESY_AVX2
+    if (simd_enabled().load(std::memory_order_relaxed)) {
+        rotate_avx2(m, pre, post, a, b, c, n, o0, o1, o2);
+        return;
+    }
+#endif
+    rotate_scalar(m, pre, post, a, b, c, n, o0, o1, o2);
+}
+
+static const double kZero[3] = {0.0, 0.0, 0.0};
+
+void LocalFrame::ecef_to_ned(const double* x, const double* y, const double* z, size_t n,
+                             double* north, double* east, double* down) const {
+    rotate(r, origin, kZero, x, y, z, n, north, east, down);
+}
+
+void LocalFrame::ned_to_ecef(const double* north, const double* east, const double* down, size_t n,
+                             double* x, double* y, double* z) const {
+    double t[3][3] = {{r[0][0], r[1][0], r[2][0]}, {r[0][1], r[1][1], r[2][1]}, {r[0][2], r[1][2], r[2][2]}};
+    rotate(t, kZero, origin, north, east, down, n, x, y, z);
+}
+
+void LocalFrame::ecef_to_enu(const double* x, const double* y, const double* z, size_t n,
+                             double* east, double* north, double* up) const {
+    double m[3][3] = {{r[1][0], r[1][1], r[1][2]}, {r[0][0], r[0][1], r[0][2]}, {-r[2][0], -r[2][1], -r[2][2]}};
+    rotate(m, origin, kZero, x, y, z, n, east, north, up);
+}
+
+void LocalFrame::enu_to_ecef(const double* east, const double* north, const double* up, size_t n,
+                             double* x, double* y, double* z) const {
+    double t[3][3] = {{r[1][0], r[0][0], -r[2][0]}, {r[1][1], r[0][1], -r[2][1]}, {r[1][2], r[0][2], -r[2][2]}};
+    rotate(t, kZero, origin, east, north, up, n, x, y, z);
+}
+
+} // namespace piksi
@@ -0,0 +1,248 @@
+#include "history.hpp"
+#include "epoch_assembler.hpp"
+#include "geodesy.hpp"
+#include "gps_time.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace piksi {
+
+static const s64 kWeekNs = kSecondsPerWeek * 1000000000LL;
+// A query that keeps losing its slots to the writer gives up after this many searches.
+static const int kReadAttempts = 4;
+
+SolutionHistory::SolutionHistory(size_t capacity, int max_gap_ms)
+    : capacity_(std::max<size_t>(capacity, 2)), max_gap_ns_(static_cast<s64>(max_gap_ms) * 1000000),
+      slots_(new Slot[capacity_]) {}
+
+s64 SolutionHistory::gps_time_ns(u16 week, u32 tow_ms) {
+    return week * kWeekNs + static_cast<s64>(tow_ms) * 1000000;
+}
+
+void SolutionHistory::push(const PiksiData& data) {
+    u64 index = head_.load(std::memory_order_relaxed);
+    s64 gps_ns = gps_time_ns(data.gps_week, data.tow);
+    if (index > first_.load(std::memory_order_relaxed) && gps_ns <= last_gps_ns_) {
+        first_.store(index, std::memory_order_release);
+    }
+    last_gps_ns_ = gps_ns;
+
+    Slot& slot = slots_[index % capacity_];
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.gps_ns.store(gps_ns, std::memory_order_relaxed);
+    slot.host_ns.store(data.host_mono_ns, std::memory_order_relaxed);
+    std::memcpy(&slot.data, &data, sizeof(PiksiData));
+    slot.seq.store(2 * (index + 1), std::memory_order_release);
+    head_.store(index + 1, std::memory_order_release);
+}
+
+size_t SolutionHistory::size() const {
+    u64 head = head_.load(std::memory_order_acquire);
+    u64 first = std::max<u64>(first_.load(std::memory_order_acquire), head > capacity_ ? head - capacity_ : 0);
+    return static_cast<size_t>(head - std::min(first, head));
+}
+
+bool SolutionHistory::read_key(u64 index, TimeBase base, s64& key) const {
+    const Slot& slot = slots_[index % capacity_];
+    u64 tag = 2 * (index + 1);
+    if (slot.seq.load(std::memory_order_acquire) != tag) {
+        return false; // overwritten by a newer epoch, or being written
+    }
+    key = base == TimeBase::kGps ? slot.gps_ns.load(std::memory_order_relaxed)
+                                 : slot.host_ns.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.seq.load(std::memory_order_relaxed) == tag;
+}
+
+bool SolutionHistory::read_data(u64 index, PiksiData& out) const {
+    const Slot& slot = slots_[index % capacity_];
+    u64 tag = 2 * (index + 1);
+    if (slot.seq.load(std::memory_order_acquire) != tag) {
+        return false;
+    }
+    std::memcpy(&out, &slot.data, sizeof(PiksiData));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.seq.load(std::memory_order_relaxed) == tag;
+}
+
+bool SolutionHistory::span(TimeBase base, s64& oldest, s64& newest) const {
+    for (int attempt = 0; attempt < kReadAttempts; ++attempt) {
+        u64 head = head_.load(std::memory_order_acquire);
+        u64 first = std::max<u64>(first_.load(std::memory_order_acquire), head > capacity_ ? head - capacity_ : 0);
+        if (first >= head) {
+            return false;
+        }
+        if (read_key(first, base, oldest) && read_key(head - 1, base, newest)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SolutionHistory::at(TimeBase base, s64 t, PiksiData& out, Interpolation mode) const {
+    for (int attempt = 0; attempt < kReadAttempts; ++attempt) {
+        u64 head = head_.load(std::memory_order_acquire);
+        u64 lo = std::max<u64>(first_.load(std::memory_order_acquire), head > capacity_ ? head - capacity_ : 0);
+        if (lo >= head) {
+            return false;
+        }
+        // The oldest slot is the next one the writer reuses; leave it out of a full ring.
+        if (head - lo == capacity_) {
+            lo++;
+        }
+        s64 oldest = 0, newest = 0;
+        if (!read_key(lo, base, oldest) || !read_key(head - 1, base, newest)) {
+            continue;
+        }
+        if (t < oldest || t > newest) {
+            return false;
+        }
+
+        // Last epoch at or before t.
+        u64 left = lo, right = head - 1;
+        bool torn = false;
+        while (left < right) {
+            u64 mid = left + (right - left + 1) / 2;
+            s64 key = 0;
+            if (!read_key(mid, base, key)) {
+                torn = true;
+                break;
+            }
+            if (key <= t) {
+                left = mid;
+            } else {
+                right = mid - 1;
+            }
+        }
+        s64 k0 = 0, k1 = 0;
+        if (torn || !read_key(left, base, k0)) {
+            continue;
+        }
+        if (k0 == t) {
+            if (read_data(left, out)) {
+                return true;
+            }
+            continue;
+        }
+        PiksiData a, b;
+        if (!read_key(left + 1, base, k1) || !read_data(left, a) || !read_data(left + 1, b)) {
+            continue;
+        }
+        if (k1 - k0 > max_gap_ns_ || k1 <= k0) {
+            return false;
+        }
+        double u = static_cast<double>(t - k0) / static_cast<double>(k1 - k0);
+        double dt = (gps_time_ns(b.gps_week, b.tow) - gps_time_ns(a.gps_week, a.tow)) * 1e-9;
+        interpolate(a, b, u, dt, mode, out);
+        return true;
+    }
+    return false;
+}
+
+// Blends a 3-vector from a to b at fraction u: cubic Hermite when slopes (per
+// second, over dt seconds) are given, else a straight line.
+static void blend(const double a[3], const double b[3], const double* va, const double* vb, double u, double dt,
+                  double out[3]) {
+    if (!va || !vb) {
+        for (int i = 0; i < 3; ++i) {
+            out[i] = a[i] + u * (b[i] - a[i]);
+        }
+        return;
+    }
+    double u2 = u * u, u3 = u2 * u;
+    double h00 = 2 * u3 - 3 * u2 + 1;
+    double h10 = u3 - 2 * u2 + u;
+    double h01 = -2 * u3 + 3 * u2;
+    double h11 = u3 - u2;
+    for (int i = 0; i < 3; ++i) {
+        out[i] = h00 * a[i] + h10 * dt * va[i] + h01 * b[i] + h11 * dt * vb[i];
+    }
+}
+
+static double lerp(double a, double b, double u) {
+    return a + u * (b - a);
+}
+
+static void ecef_velocity(const PiksiData& d, double out[3]) {
+    LocalFrame frame = LocalFrame::at(d.lat, d.lon, d.h);
+    double ned[3] = {d.v_n, d.v_e, d.v_d};
+    for (int j = 0; j < 3; ++j) {
+        out[j] = frame.r[0][j] * ned[0] + frame.r[1][j] * ned[1] + frame.r[2][j] * ned[2];
+    }
+}
+
+void SolutionHistory::interpolate(const PiksiData& a, const PiksiData& b, double u, double dt, Interpolation mode,
+                                  PiksiData& out) {
+    out = u < 0.5 ? a : b;
+    u8 both = a.epoch_parts & b.epoch_parts;
+    bool hermite = mode == Interpolation::kHermite && (both & kPartVel) && dt > 0.0;
+
+    // Positions go through ECEF, so a path across the antimeridian or near a pole stays straight.
+    double va_ecef[3], vb_ecef[3];
+    if (hermite) {
+        ecef_velocity(a, va_ecef);
+        ecef_velocity(b, vb_ecef);
+    }
+    const double* va = hermite ? va_ecef : nullptr;
+    const double* vb = hermite ? vb_ecef : nullptr;
+    double pa[3], pb[3], p[3];
+    if (both & kPartLlh) {
+        llh_to_ecef(a.lat, a.lon, a.h, pa);
+        llh_to_ecef(b.lat, b.lon, b.h, pb);
+    } else {
+        pa[0] = a.ecef_x, pa[1] = a.ecef_y, pa[2] = a.ecef_z;
+        pb[0] = b.ecef_x, pb[1] = b.ecef_y, pb[2] = b.ecef_z;
+    }
+    blend(pa, pb, va, vb, u, dt, p);
+    ecef_to_llh(p, &out.lat, &out.lon, &out.h);
+    double ea[3] = {a.ecef_x, a.ecef_y, a.ecef_z};
+    double eb[3] = {b.ecef_x, b.ecef_y, b.ecef_z};
+    blend(ea, eb, va, vb, u, dt, p);
+    out.ecef_x = p[0], out.ecef_y = p[1], out.ecef_z = p[2];
+
+    double na[3] = {a.n, a.e, a.d};
+    double nb[3] = {b.n, b.e, b.d};
+    double vna[3] = {a.v_n, a.v_e, a.v_d};
+    double vnb[3] = {b.v_n, b.v_e, b.v_d};
+    blend(na, nb, hermite ? vna : nullptr, hermite ? vnb : nullptr, u, dt, p);
+    out.n = p[0], out.e = p[1], out.d = p[2];
+
+    double la[3] = {a.local_e, a.local_n, a.local_u};
+    double lb[3] = {b.local_e, b.local_n, b.local_u};
+    double vla[3] = {a.v_e, a.v_n, -a.v_d};
+    double vlb[3] = {b.v_e, b.v_n, -b.v_d};
+    blend(la, lb, hermite ? vla : nullptr, hermite ? vlb : nullptr, u, dt, p);
+    out.local_e = p[0], out.local_n = p[1], out.local_u = p[2];
+
+    out.v_n = lerp(a.v_n, b.v_n, u);
+    out.v_e = lerp(a.v_e, b.v_e, u);
+    out.v_d = lerp(a.v_d, b.v_d, u);
+
+    out.S_llh_h = static_cast<float>(lerp(a.S_llh_h, b.S_llh_h, u));
+    out.S_llh_v = static_cast<float>(lerp(a.S_llh_v, b.S_llh_v, u));
+    out.S_ecef = static_cast<float>(lerp(a.S_ecef, b.S_ecef, u));
+    out.S_rtk_x_h = static_cast<float>(lerp(a.S_rtk_x_h, b.S_rtk_x_h, u));
+    out.S_rtk_x_v = static_cast<float>(lerp(a.S_rtk_x_v, b.S_rtk_x_v, u));
+    out.S_rtk_v_h = static_cast<float>(lerp(a.S_rtk_v_h, b.S_rtk_v_h, u));
+    out.S_rtk_v_v = static_cast<float>(lerp(a.S_rtk_v_v, b.S_rtk_v_v, u));
+
+    s64 ga = gps_time_ns(a.gps_week, a.tow);
+    s64 gps_ns = ga + static_cast<s64>(std::llround(u * (gps_time_ns(b.gps_week, b.tow) - ga)));
+    out.gps_week = a.gps_week > 0 ? static_cast<u16>(gps_ns / kWeekNs) : 0;
+    out.tow = static_cast<u32>((gps_ns % kWeekNs) / 1000000);
+    if (a.utc_timestamp > 0.0 && b.utc_timestamp > 0.0) {
+        out.utc_timestamp = lerp(a.utc_timestamp, b.utc_timestamp, u);
+        TimeOfDay tod = time_of_day(out.utc_timestamp);
+        out.hr = tod.hr;
+        out.min = tod.min;
+        out.sec = tod.sec;
+        out.ms = tod.ms;
+        out.utc = out.hr + out.min / 60.0 + (out.sec + out.ms / 1000.0) / 3600.0;
+    }
+    out.host_mono_ns = a.host_mono_ns + static_cast<s64>(std::llround(u * (b.host_mono_ns - a.host_mono_ns)));
+    out.host_real_ns = a.host_real_ns + static_cast<s64>(std::llround(u * (b.host_real_ns - a.host_real_ns)));
+}
+
+} // namespace piksi
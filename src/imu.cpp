@@ -0,0 +1,48 @@
+#include "imu.hpp"
+
+namespace piksi {
+
+static const float kGravity = 9.80665f;
+static const float kDegToRad = static_cast<float>(M_PI / 180.0);
+
+float ImuInfo::acc_scale() const {
+    // Range code n selects +-2^(n+1) g over the signed 16-bit span.
+    int range_g = 2 << (imu_conf & 0x0F);
+    return range_g * kGravity / 32768.0f;
+}
+
+float ImuInfo::gyr_scale() const {
+    // Range code n selects +-2000/2^n deg/s.
+    int range_dps = 2000 >> ((imu_conf >> 4) & 0x0F);
+    return range_dps * kDegToRad / 32768.0f;
+}
+
+void apply_imu_aux(const msg_imu_aux_t& aux, ImuInfo* info) {
+    info->imu_type = aux.imu_type;
+    info->imu_conf = aux.imu_conf;
+    if (aux.imu_type == 1) {
+        info->temperature = 25.0f + aux.temp / 256.0f; // ASM330LLH
+    } else {
+        info->temperature = 23.0f + aux.temp / 512.0f; // BMI160
+    }
+}
+
+ImuSample scale_imu_raw(const msg_imu_raw_t& raw, const ImuInfo& info, const HostTime& rx) {
+    ImuSample sample;
+    sample.host_mono_ns = rx.mono_ns;
+    sample.host_real_ns = rx.real_ns;
+    sample.tow = raw.tow & 0x3FFFFFFF;
+    sample.time_status = static_cast<u8>(raw.tow >> 30);
+    sample.tow_f = raw.tow_f;
+    float acc = info.acc_scale();
+    float gyr = info.gyr_scale();
+    sample.acc[0] = raw.acc_x * acc;
+    sample.acc[1] = raw.acc_y * acc;
+    sample.acc[2] = raw.acc_z * acc;
+    sample.gyr[0] = raw.gyr_x * gyr;
+    sample.gyr[1] = raw.gyr_y * gyr;
+    sample.gyr[2] = raw.gyr_z * gyr;
+    return sample;
+}
+
+} // namespace piksi
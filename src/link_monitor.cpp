@@ -0,0 +1,82 @@
+#include "link_monitor.hpp"
+#include <algorithm>
+
+namespace piksi {
+
+const char* link_state_name(LinkState state) {
+    switch (state) {
+    case LinkState::kUp:
+        return "up";
+    case LinkState::kDown:
+        return "down";
+    case LinkState::kResync:
+        return "resync";
+    }
+    return "?";
+}
+
+void LinkMonitor::frame(s64 now_ns) {
+    if (state() != LinkState::kResync) {
+        return;
+    }
+    state_.store(LinkState::kUp, std::memory_order_relaxed);
+    if (outage_start_ns_ == 0) {
+        return; // first connection
+    }
+    s64 outage = now_ns - outage_start_ns_;
+    last_outage_ns_.store(outage, std::memory_order_relaxed);
+    max_outage_ns_.store(std::max(max_outage_ns_.load(std::memory_order_relaxed), outage), std::memory_order_relaxed);
+    total_outage_ns_.fetch_add(outage, std::memory_order_relaxed);
+    reconnects_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool LinkMonitor::timed_out(s64 now_ns) const {
+    return options_.timeout_ms > 0 && state() != LinkState::kDown &&
+           now_ns - last_heartbeat_ns_ > options_.timeout_ms * 1000000LL;
+}
+
+void LinkMonitor::lost(s64 last_rx_ns, s64 now_ns, bool heartbeat_timeout) {
+    if (state() == LinkState::kUp) {
+        // An outage that is still in progress (lost again while resyncing) keeps its start.
+        outage_start_ns_ = last_rx_ns > 0 ? last_rx_ns : now_ns;
+    }
+    drops_.fetch_add(1, std::memory_order_relaxed);
+    if (heartbeat_timeout) {
+        heartbeat_timeouts_.fetch_add(1, std::memory_order_relaxed);
+    }
+    backoff_ns_ = 0;
+    next_attempt_ns_ = now_ns;
+    state_.store(LinkState::kDown, std::memory_order_relaxed);
+}
+
+void LinkMonitor::unavailable(s64 now_ns) {
+    outage_start_ns_ = 0;
+    backoff_ns_ = options_.backoff_min_ms * 1000000LL;
+    next_attempt_ns_ = now_ns + backoff_ns_;
+    state_.store(LinkState::kDown, std::memory_order_relaxed);
+}
+
+void LinkMonitor::open_failed(s64 now_ns) {
+    failed_opens_.fetch_add(1, std::memory_order_relaxed);
+    backoff_ns_ = backoff_ns_ == 0 ? options_.backoff_min_ms * 1000000LL
+                                   : std::min<s64>(backoff_ns_ * 2, options_.backoff_max_ms * 1000000LL);
+    next_attempt_ns_ = now_ns + backoff_ns_;
+}
+
+void LinkMonitor::reopened(s64 now_ns) {
+    last_heartbeat_ns_ = now_ns; // the watchdog starts over
+    state_.store(LinkState::kResync, std::memory_order_relaxed);
+}
+
+LinkStats LinkMonitor::stats() const {
+    return {state(),
+            drops_.load(std::memory_order_relaxed),
+            heartbeat_timeouts_.load(std::memory_order_relaxed),
+            reconnects_.load(std::memory_order_relaxed),
+            failed_opens_.load(std::memory_order_relaxed),
+            last_outage_ns_.load(std::memory_order_relaxed) * 1e-9,
+            max_outage_ns_.load(std::memory_order_relaxed) * 1e-9,
+            total_outage_ns_.load(std::memory_order_relaxed) * 1e-9};
+}
+
+} // namespace piksi
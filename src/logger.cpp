@@ -0,0 +1,173 @@
+#include "logger.hpp"
+#include "piksi_format.hpp"
+#include "gps_time.hpp"
+#include "columnar.hpp"
+
+namespace piksi {
+
+// Batches larger than this are written without waiting for the batch period.
+static const size_t kMaxBatchBytes = 256 * 1024;
+
+bool parse_log_format(const std::string& value, LogFormat* format) {
+    if (value == "csv") {
+        *format = LogFormat::kCsv;
+    } else if (value == "binary") {
+        *format = LogFormat::kBinary;
+    } else if (value == "columnar") {
+        *format = LogFormat::kColumnar;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* log_extension(LogFormat format) {
+    switch (format) {
+    case LogFormat::kCsv:
+        return ".csv";
+    case LogFormat::kBinary:
+        return ".bin";
+    case LogFormat::kColumnar:
+        return ".pcol";
+    }
+    return "";
+}
+
+Logger::Logger(const LoggerOptions& options)
+    : options_(options), queue_(options.queue_capacity), file_(options.rotation) {
+    if (options_.format == LogFormat::kCsv) {
+        std::string header;
+        append_csv_header(header);
+        file_.set_header(header);
+    } else if (options_.format == LogFormat::kColumnar) {
+        file_.set_header(columnar_header());
+        block_.reserve(kColumnarBlockRows);
+    }
+    batch_.reserve(kMaxBatchBytes + kBinarySize + 1024);
+    if (options_.latency) {
+        batch_stamps_.reserve(kMaxBatchBytes / 64);
+    }
+}
+
+Logger::~Logger() {
+    stop();
+}
+
+void Logger::start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    writer_ = std::thread(&Logger::run, this);
+}
+
+void Logger::stop() {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    writer_.join();
+    file_.close();
+}
+
+bool Logger::push(const PiksiData& data) {
+    if (!queue_.push(data)) {
+        dropped_++;
+        return false;
+    }
+    return true;
+}
+
+LoggerStats Logger::stats() const {
+    return {queue_.size(), written_.load(), dropped_.load(), files_.load()};
+}
+
+void Logger::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        cv_.wait_for(lock, std::chrono::milliseconds(options_.batch_ms), [this] { return !running_; });
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+    lock.unlock();
+    drain();
+}
+
+// Formats everything queued into large batches and writes them out.
+void Logger::drain() {
+    PiksiData data;
+    u64 records = 0;
+    while (queue_.pop(data)) {
+        if (options_.format == LogFormat::kColumnar) {
+            // Rows wait for a full block; they are counted as written once it is.
+            if (block_.empty()) {
+                block_started_ = std::chrono::steady_clock::now();
+            }
+            block_.push_back(data);
+            if (block_.size() >= kColumnarBlockRows) {
+                records += flush_block();
+            }
+            continue;
+        }
+        if (options_.format == LogFormat::kCsv) {
+            append_csv_row(batch_, data);
+        } else {
+            size_t offset = batch_.size();
+            batch_.resize(offset + kBinarySize);
+            batch_.resize(offset + encode_binary(data, seq_++, reinterpret_cast<u8*>(&batch_[offset])));
+        }
+        if (options_.latency) {
+            batch_stamps_.push_back(data.host_mono_ns);
+        }
+        records++;
+        if (batch_.size() >= kMaxBatchBytes) {
+            flush_batch();
+        }
+    }
+    if (!batch_.empty()) {
+        flush_batch();
+    }
+    if (!block_.empty() && (!running_ || std::chrono::steady_clock::now() - block_started_ >=
+                                             std::chrono::milliseconds(options_.block_ms))) {
+        records += flush_block(); // partial block: held back long enough, or stopping
+    }
+    if (records > 0) {
+        file_.end_batch();
+        written_ += records;
+        files_ = file_.files_opened();
+    }
+}
+
+u64 Logger::flush_block() {
+    append_columnar_block(batch_, block_.data(), block_.size());
+    if (options_.latency) {
+        for (const PiksiData& row : block_) {
+            batch_stamps_.push_back(row.host_mono_ns);
+        }
+    }
+    u64 rows = block_.size();
+    block_.clear();
+    flush_batch();
+    return rows;
+}
+
+void Logger::flush_batch() {
+    file_.write(batch_.data(), batch_.size());
+    batch_.clear();
+    if (options_.latency) {
+        s64 now = clock_ns(CLOCK_MONOTONIC);
+        for (s64 stamp : batch_stamps_) {
+            if (stamp > 0) {
+                options_.latency->record(now - stamp);
+            }
+        }
+        batch_stamps_.clear();
+    }
+}
+
+} // namespace piksi
@@ -0,0 +1,148 @@
+#include "metrics.hpp"
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+namespace piksi {
+
+const char* stage_name(Stage stage) {
+    switch (stage) {
+    case Stage::kDecode:
+        return "decode";
+    case Stage::kAssemble:
+        return "assemble";
+    case Stage::kPublish:
+        return "publish";
+    case Stage::kLog:
+        return "log";
+    case Stage::kCorrection:
+        return "correction";
+    }
+    return "?";
+}
+
+void Metrics::count_message(u16 msg_type) {
+    size_t n = type_count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < n; ++i) {
+        if (types_[i].type.load(std::memory_order_relaxed) == msg_type) {
+            types_[i].count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    if (n == kMaxTypes) {
+        other_types_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // Only the reader thread adds types; publish the slot after filling it.
+    types_[n].type.store(msg_type, std::memory_order_relaxed);
+    types_[n].count.store(1, std::memory_order_relaxed);
+    type_count_.store(n + 1, std::memory_order_release);
+}
+
+ErrorCounts Metrics::errors() const {
+    return {crc_errors_.load(std::memory_order_relaxed), read_errors_.load(std::memory_order_relaxed),
+            framing_bytes_.load(std::memory_order_relaxed), imu_dropped_.load(std::memory_order_relaxed),
+            hot_path_allocs_.load(std::memory_order_relaxed)};
+}
+
+u64 Metrics::percentile(Stage stage, double q) const {
+    LatencyHistogram::Counts counts;
+    stages_[static_cast<size_t>(stage)].snapshot(counts);
+    return LatencyHistogram::percentile(counts, q);
+}
+
+static void write_latency(std::ostream& os, const LatencyHistogram::Counts& counts) {
+    os << "{\"count\":" << LatencyHistogram::total(counts)
+       << ",\"p50\":" << LatencyHistogram::percentile(counts, 0.50) / 1e3
+       << ",\"p90\":" << LatencyHistogram::percentile(counts, 0.90) / 1e3
+       << ",\"p99\":" << LatencyHistogram::percentile(counts, 0.99) / 1e3
+       << ",\"p999\":" << LatencyHistogram::percentile(counts, 0.999) / 1e3
+       << ",\"max\":" << LatencyHistogram::percentile(counts, 1.0) / 1e3 << "}";
+}
+
+std::string Metrics::report(const std::string& name, const EpochStats& epochs, const TransportStats& transport,
+                            const LoggerStats& log, const LinkStats& link, const CorrectionStats* corrections) {
+    auto now = std::chrono::steady_clock::now();
+    double window = reported_ ? std::chrono::duration<double>(now - last_report_).count() : 0.0;
+    reported_ = true;
+    last_report_ = now;
+
+    std::ostringstream json;
+    json << std::setprecision(6);
+    json << "{\"name\":\"" << name << "\",\"window_s\":" << window << ",\"messages\":{";
+    size_t n = type_count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < n; ++i) {
+        char type[8];
+        snprintf(type, sizeof(type), "0x%04X", types_[i].type.load(std::memory_order_relaxed));
+        u64 count = types_[i].count.load(std::memory_order_relaxed);
+        double rate = window > 0.0 ? (count - last_counts_[i]) / window : 0.0;
+        last_counts_[i] = count;
+        json << (i ? "," : "") << "\"" << type << "\":{\"count\":" << count << ",\"rate\":" << rate << "}";
+    }
+    json << "},\"other_messages\":" << other_types_.load(std::memory_order_relaxed)
+         << ",\"errors\":{\"crc\":" << crc_errors_.load(std::memory_order_relaxed)
+         << ",\"read\":" << read_errors_.load(std::memory_order_relaxed)
+         << ",\"framing_bytes\":" << framing_bytes_.load(std::memory_order_relaxed)
+         << ",\"imu_dropped\":" << imu_dropped_.load(std::memory_order_relaxed)
+#ifdef PIKSI_ALLOC_COUNTER
+         << ",\"hot_path_allocs\":" << hot_path_allocs_.load(std::memory_order_relaxed)
+#endif
+         << "}"
+         << ",\"epochs\":{\"complete\":" << epochs.complete << ",\"partial\":" << epochs.partial
+         << ",\"late\":" << epochs.late << "}"
+         << ",\"transport\":{\"bytes\":" << transport.bytes << ",\"reads\":" << transport.reads
+         << ",\"timeouts\":" << transport.timeouts << "}"
+         << ",\"log\":{\"queued\":" << log.queued << ",\"written\":" << log.written
+         << ",\"dropped\":" << log.dropped << "}"
+         << ",\"publish\":{\"coalesced\":" << coalesced_.load(std::memory_order_relaxed) << "}"
+         << ",\"link\":{\"state\":\"" << link_state_name(link.state) << "\",\"drops\":" << link.drops
+         << ",\"heartbeat_timeouts\":" << link.heartbeat_timeouts << ",\"reconnects\":" << link.reconnects
+         << ",\"failed_opens\":" << link.failed_opens << ",\"last_outage_s\":" << link.last_outage_s
+         << ",\"max_outage_s\":" << link.max_outage_s << ",\"total_outage_s\":" << link.total_outage_s << "}";
+    if (corrections) {
+        json << ",\"corrections\":{\"received\":" << corrections->received
+             << ",\"forwarded\":" << corrections->forwarded << ",\"bytes\":" << corrections->bytes
+             << ",\"dropped\":" << corrections->dropped << ",\"write_errors\":" << corrections->write_errors
+             << ",\"truncated\":" << corrections->truncated
+             << ",\"queue_bytes\":" << corrections->queue_bytes
+             << ",\"queue_max_bytes\":" << corrections->queue_max_bytes << ",\"last_s\":" << corrections->last_s
+             << ",\"receiver_age_s\":" << corrections->receiver_age_s << "}";
+    }
+
+    // Latency percentiles over this window only: current counts minus the previous report's.
+    json << ",\"latency_us\":{";
+    LatencyHistogram::Counts counts;
+    for (size_t s = 0; s < kStageCount; ++s) {
+        stages_[s].snapshot(counts);
+        LatencyHistogram::Counts window_counts;
+        for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+            window_counts[i] = counts[i] - last_stages_[s][i];
+        }
+        last_stages_[s] = counts;
+        json << (s ? "," : "") << "\"" << stage_name(static_cast<Stage>(s)) << "\":";
+        write_latency(json, window_counts);
+    }
+    json << "}}";
+    return json.str();
+}
+
+std::string Metrics::summary() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    LatencyHistogram::Counts counts;
+    for (size_t s = 0; s < kStageCount; ++s) {
+        stages_[s].snapshot(counts);
+        u64 n = LatencyHistogram::total(counts);
+        if (n == 0) {
+            continue;
+        }
+        out << "  " << std::left << std::setw(9) << stage_name(static_cast<Stage>(s)) << std::right
+            << " n=" << n
+            << " p50=" << LatencyHistogram::percentile(counts, 0.50) / 1e3 << "us"
+            << " p99=" << LatencyHistogram::percentile(counts, 0.99) / 1e3 << "us"
+            << " max=" << LatencyHistogram::percentile(counts, 1.0) / 1e3 << "us\n";
+    }
+    return out.str();
+}
+
+} // namespace piksi
@@ -0,0 +1,390 @@
+// Throughput benchmark for the decode -> publish -> log path.
+//
+// Usage: piksi_bench [recording.sbp] [--epochs N] [--iterations N] [--publish] [--capture]
+//
+// Without a recording, a synthetic stream of N solution epochs is generated.
+// The stream is replayed as fast as possible through PiksiMultiGPS, then the
+// JSON and binary payloads, the CSV row formatting and the cost of handing a
+// record to the background logger are timed on the last decoded solution.
+//
+// The geodesy stages convert N points spread over the globe (N = iterations),
+// poles included, from 1000 km below the surface to geostationary height,
+// per-point through the scalar reference, then in one batch through each
+// kernel available. The batches are checked against the reference and by
+// round trip; a disagreement above kGeodesyTolerance fails the run. The
+// ctest target geodesy_test checks the full documented range.
+
+#include "piksi_multi_gps.hpp"
+#include "piksi_format.hpp"
+#include "geodesy.hpp"
+#include "sbp_synth.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#ifdef PIKSI_ALLOC_COUNTER
+// libpiksi already counts every heap allocation.
+static unsigned long long allocations() { return piksi::total_allocations(); }
+#else
+// Counts every heap allocation so each stage can report allocations/message.
+static std::atomic<unsigned long long> g_allocs{0};
+static unsigned long long allocations() { return g_allocs.load(std::memory_order_relaxed); }
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(std::size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+struct StageResult {
+    std::string name;
+    unsigned long long messages;
+    double seconds;
+    unsigned long long allocs;
+};
+
+class Stage {
+public:
+    explicit Stage(const std::string& name) : name_(name) {
+        allocs_ = allocations();
+        start_ = std::chrono::steady_clock::now();
+    }
+    StageResult stop(unsigned long long messages) {
+        auto end = std::chrono::steady_clock::now();
+        std::chrono::duration<double> dt = end - start_;
+        return {name_, messages, dt.count(), allocations() - allocs_};
+    }
+
+private:
+    std::string name_;
+    unsigned long long allocs_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// 10 Hz RTK solutions with a heartbeat every second.
+std::vector<u8> synthesize(unsigned long epochs) {
+    std::vector<u8> out;
+    piksi::SbpSynth synth;
+    for (unsigned long i = 0; i < epochs; ++i) {
+        if (i % 10 == 0) {
+            synth.heartbeat(out);
+        }
+        synth.epoch(out, 2300, 100000000 + static_cast<u32>(i) * 100);
+    }
+    return out;
+}
+
+unsigned long long count_frames(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<u8> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    unsigned long long frames = 0;
+    size_t i = 0;
+    while (i + 6 <= bytes.size()) {
+        if (bytes[i] != SBP_PREAMBLE) {
+            ++i;
+            continue;
+        }
+        i += 8 + bytes[i + 5];
+        ++frames;
+    }
+    return frames;
+}
+
+std::string temp_path(const char* suffix) {
+    std::string path = std::string("/tmp/piksi_bench_XXXXXX") + suffix;
+    std::vector<char> buf(path.begin(), path.end());
+    buf.push_back('\0');
+    int fd = mkstemps(buf.data(), static_cast<int>(std::strlen(suffix)));
+    if (fd < 0) {
+        std::cerr << "Bench: Cannot create a temporary file!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    ::close(fd);
+    return buf.data();
+}
+
+// Largest disagreement, in metres, a batch kernel may have with the scalar reference.
+const double kGeodesyTolerance = 1e-6;
+// Metres per degree of latitude, near enough to report angular errors as distances.
+const double kMetresPerDegree = 111320.0;
+
+struct Points {
+    std::vector<double> a, b, c;
+    explicit Points(size_t n) : a(n), b(n), c(n) {}
+};
+
+double max_distance(const Points& p, const Points& q) {
+    double worst = 0.0;
+    for (size_t i = 0; i < p.a.size(); ++i) {
+        worst = std::max(worst, std::hypot(p.a[i] - q.a[i], p.b[i] - q.b[i], p.c[i] - q.c[i]));
+    }
+    return worst;
+}
+
+// Times the geodesy kernels on n points and returns the worst error found
+// against the scalar reference, in metres.
+double geodesy_stages(unsigned long n, std::vector<StageResult>& results) {
+    Points llh(n), ecef(n), ref(n), out(n), enu(n);
+    unsigned long long state = 0x2545F4914F6CDD1DULL; // fixed seed: the same points every run
+    auto uniform = [&state](double lo, double hi) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return lo + (hi - lo) * static_cast<double>(state >> 11) / 9007199254740992.0;
+    };
+    for (unsigned long i = 0; i < n; ++i) {
+        // Mostly near the surface; a quarter in orbit, an eighth deep below, every sixteenth on a pole.
+        llh.a[i] = (i % 16 == 0) ? ((i % 32) ? 90.0 : -90.0) : uniform(-90.0, 90.0);
+        llh.b[i] = uniform(-180.0, 180.0);
+        llh.c[i] = (i % 4 == 1) ? uniform(50000.0, 45000000.0)
+                   : (i % 8 == 2) ? uniform(-1000000.0, -1000.0) : uniform(-1000.0, 50000.0);
+    }
+    piksi::LocalFrame frame = piksi::LocalFrame::at(38.9, -77.0, 10.0);
+    double worst = 0.0;
+
+    {
+        Stage stage("llh->ecef (scalar ref)");
+        for (unsigned long i = 0; i < n; ++i) {
+            double p[3];
+            piksi::llh_to_ecef(llh.a[i], llh.b[i], llh.c[i], p);
+            ref.a[i] = p[0], ref.b[i] = p[1], ref.c[i] = p[2];
+        }
+        results.push_back(stage.stop(n));
+    }
+    {
+        Stage stage("llh->ecef (batch)");
+        piksi::llh_to_ecef(llh.a.data(), llh.b.data(), llh.c.data(), n, ecef.a.data(), ecef.b.data(), ecef.c.data());
+        results.push_back(stage.stop(n));
+        // A loop over the scalar form, so there is nothing to compare; the
+        // ecef->llh round trip below covers it.
+    }
+
+    {
+        Stage stage("ecef->llh (scalar ref)");
+        for (unsigned long i = 0; i < n; ++i) {
+            double p[3] = {ecef.a[i], ecef.b[i], ecef.c[i]};
+            piksi::ecef_to_llh(p, &ref.a[i], &ref.b[i], &ref.c[i]);
+        }
+        results.push_back(stage.stop(n));
+    }
+    {
+        Stage stage("ecef->llh (batch)");
+        piksi::ecef_to_llh(ecef.a.data(), ecef.b.data(), ecef.c.data(), n, out.a.data(), out.b.data(), out.c.data());
+        results.push_back(stage.stop(n));
+        for (unsigned long i = 0; i < n; ++i) {
+            // Angles scaled by the distance from the centre, so orbit heights are not flattered.
+            double scale = std::hypot(ecef.a[i], ecef.b[i], ecef.c[i]) / piksi::kWgs84A;
+            double dlon = std::remainder(out.b[i] - ref.b[i], 360.0) * std::cos(ref.a[i] * M_PI / 180.0);
+            double horizontal = std::hypot(out.a[i] - ref.a[i], dlon) * kMetresPerDegree * scale;
+            worst = std::max(worst, std::hypot(horizontal, out.c[i] - ref.c[i]));
+        }
+        // Round trip back to the ECEF the points started from.
+        piksi::llh_to_ecef(out.a.data(), out.b.data(), out.c.data(), n, enu.a.data(), enu.b.data(), enu.c.data());
+        worst = std::max(worst, max_distance(enu, ecef));
+    }
+
+    {
+        Stage stage("ecef->enu (scalar ref)");
+        for (unsigned long i = 0; i < n; ++i) {
+            double p[3] = {ecef.a[i], ecef.b[i], ecef.c[i]}, q[3];
+            frame.ecef_to_enu(p, q);
+            ref.a[i] = q[0], ref.b[i] = q[1], ref.c[i] = q[2];
+        }
+        results.push_back(stage.stop(n));
+    }
+    const char* best = piksi::set_geodesy_simd(true);
+    std::vector<const char*> kernels{"scalar"};
+    if (std::string(best) != "scalar") {
+        kernels.push_back(best);
+    }
+    for (const char* kernel : kernels) {
+        piksi::set_geodesy_simd(std::string(kernel) != "scalar");
+        {
+            Stage stage(std::string("ecef->enu (batch ") + kernel + ")");
+            frame.ecef_to_enu(ecef.a.data(), ecef.b.data(), ecef.c.data(), n, enu.a.data(), enu.b.data(),
+                              enu.c.data());
+            results.push_back(stage.stop(n));
+            worst = std::max(worst, max_distance(enu, ref));
+        }
+        {
+            Stage stage(std::string("enu->ecef (batch ") + kernel + ")");
+            frame.enu_to_ecef(enu.a.data(), enu.b.data(), enu.c.data(), n, out.a.data(), out.b.data(),
+                              out.c.data());
+            results.push_back(stage.stop(n));
+            worst = std::max(worst, max_distance(out, ecef));
+        }
+    }
+    piksi::set_geodesy_simd(true);
+    return worst;
+}
+
+void print_results(const std::vector<StageResult>& results) {
+    std::cout << "\n" << std::left << std::setw(24) << "stage"
+              << std::right << std::setw(12) << "messages"
+              << std::setw(14) << "msgs/s"
+              << std::setw(12) << "ns/msg"
+              << std::setw(14) << "allocs/msg" << std::endl;
+    for (const StageResult& r : results) {
+        double n = r.messages ? static_cast<double>(r.messages) : 1.0;
+        std::cout << std::left << std::setw(24) << r.name
+                  << std::right << std::setw(12) << r.messages
+                  << std::setw(14) << std::fixed << std::setprecision(0) << r.messages / r.seconds
+                  << std::setw(12) << std::setprecision(1) << r.seconds * 1e9 / n
+                  << std::setw(14) << std::setprecision(2) << r.allocs / n << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string recording;
+    unsigned long epochs = 100000;
+    unsigned long iterations = 100000;
+    bool publish = false;
+    bool capture = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--epochs" && i + 1 < argc) {
+            epochs = std::stoul(argv[++i]);
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::stoul(argv[++i]);
+        } else if (arg == "--publish") {
+            publish = true;
+        } else if (arg == "--capture") {
+            capture = true;
+        } else if (!arg.empty() && arg[0] != '-') {
+            recording = arg;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [recording.sbp] [--epochs N] [--iterations N] [--publish] [--capture]" << std::endl;
+            return 1;
+        }
+    }
+
+    bool synthetic = recording.empty();
+    if (synthetic) {
+        recording = temp_path(".sbp");
+        std::vector<u8> stream = synthesize(epochs);
+        std::ofstream(recording, std::ios::binary).write(reinterpret_cast<const char*>(stream.data()), stream.size());
+        std::cout << "Bench: Synthesized " << epochs << " epochs (" << stream.size() << " bytes)" << std::endl;
+    }
+    unsigned long long frames = count_frames(recording);
+
+    char capture_template[] = "/tmp/piksi_bench_capture_XXXXXX";
+    std::string capture_dir = capture ? mkdtemp(capture_template) : "/tmp";
+    std::string config_path = temp_path(".cfg");
+    std::ofstream(config_path) << "[Piksi Multi GPS]\n"
+                               << "replay_file=" << recording << "\n"
+                               << "replay_realtime=false\n"
+                               << "log_to_csv=false\n"
+                               << "zenoh_enabled=" << (publish ? "true" : "false") << "\n"
+                               << "capture_raw=" << (capture ? "true" : "false") << "\n"
+                               << "capture_dir=" << capture_dir << "\n";
+
+    std::vector<StageResult> results;
+    piksi::PiksiData data;
+    {
+        piksi::PiksiMultiGPS gps(config_path);
+        gps.open();
+        std::string name = "decode";
+        name += publish ? "+publish" : "";
+        name += capture ? "+capture" : "";
+        Stage stage(name);
+        gps.init_loop();
+        while (!gps.finished()) {
+            gps.loop();
+        }
+        results.push_back(stage.stop(frames));
+        data = gps.get_data();
+    }
+
+    size_t json_bytes = 0;
+    {
+        Stage stage("json (pos_llh payload)");
+        for (unsigned long i = 0; i < iterations; ++i) {
+            json_bytes += piksi::to_json(data, 0).size();
+        }
+        results.push_back(stage.stop(iterations));
+    }
+
+    size_t binary_bytes = 0;
+    {
+        u8 buffer[piksi::kBinarySize];
+        Stage stage("binary payload");
+        for (unsigned long i = 0; i < iterations; ++i) {
+            binary_bytes += piksi::encode_binary(data, static_cast<u32>(i), buffer);
+        }
+        results.push_back(stage.stop(iterations));
+    }
+
+    {
+        std::string batch;
+        batch.reserve(1024);
+        Stage stage("csv row");
+        for (unsigned long i = 0; i < iterations; ++i) {
+            batch.clear();
+            piksi::append_csv_row(batch, data);
+        }
+        results.push_back(stage.stop(iterations));
+    }
+
+    {
+        piksi::LoggerOptions options;
+        options.rotation.directory = "/tmp";
+        options.rotation.suffix = "_piksi_bench.csv";
+        options.queue_capacity = iterations;
+        piksi::Logger logger(options);
+        logger.start();
+        Stage stage("log push (async csv)");
+        for (unsigned long i = 0; i < iterations; ++i) {
+            logger.push(data);
+        }
+        results.push_back(stage.stop(iterations));
+        logger.stop();
+    }
+
+    double geodesy_error = geodesy_stages(iterations, results);
+
+    print_results(results);
+    unsigned long n = iterations ? iterations : 1;
+    std::cout << "(payload bytes/msg: json " << json_bytes / n << ", binary " << binary_bytes / n << ")" << std::endl;
+    std::cout << "(geodesy: " << piksi::geodesy_simd() << " kernels, max error vs scalar reference "
+              << std::scientific << std::setprecision(2) << geodesy_error << " m)" << std::endl;
+
+    std::remove(config_path.c_str());
+    if (capture) {
+        std::filesystem::remove_all(capture_dir);
+    }
+    if (synthetic) {
+        std::remove(recording.c_str());
+    }
+    if (!(geodesy_error <= kGeodesyTolerance)) {
+        std::cerr << "Bench: Geodesy batch kernels disagree with the scalar reference!" << std::endl;
+        return 1;
+    }
+    return 0;
+}
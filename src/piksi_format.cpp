@@ -0,0 +1,499 @@
+#include "piksi_format.hpp"
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "encode_binary assumes a little-endian host"
+#endif
+
+namespace piksi {
+
+std::string to_json(const PiksiData& data, u32 seq) {
+    std::ostringstream json;
+    json << std::setprecision(15) << std::boolalpha;
+    json << "{"
+         << "\"seq\":" << seq << ","
+         << "\"tow\":" << data.tow << ","
+         << "\"gps_week\":" << data.gps_week << ","
+         << "\"host_mono_ns\":" << data.host_mono_ns << ","
+         << "\"host_real_ns\":" << data.host_real_ns << ","
+         << "\"utc_timestamp\":" << data.utc_timestamp << ","
+         << "\"utc\":" << data.utc << ","
+         << "\"hr\":" << static_cast<int>(data.hr) << ","
+         << "\"min\":" << static_cast<int>(data.min) << ","
+         << "\"sec\":" << static_cast<int>(data.sec) << ","
+         << "\"ms\":" << data.ms << ","
+         << "\"frequency\":" << data.frequency << ","
+         << "\"rtk_solution\":" << data.rtk_solution << ","
+         << "\"status\":" << data.status << ","
+         << "\"lat\":" << data.lat << ","
+         << "\"lon\":" << data.lon << ","
+         << "\"h\":" << data.h << ","
+         << "\"S_llh_h\":" << data.S_llh_h << ","
+         << "\"S_llh_v\":" << data.S_llh_v << ","
+         << "\"ecef_x\":" << data.ecef_x << ","
+         << "\"ecef_y\":" << data.ecef_y << ","
+         << "\"ecef_z\":" << data.ecef_z << ","
+         << "\"S_ecef\":" << data.S_ecef << ","
+         << "\"n\":" << data.n << ","
+         << "\"e\":" << data.e << ","
+         << "\"d\":" << data.d << ","
+         << "\"S_rtk_x_h\":" << data.S_rtk_x_h << ","
+         << "\"S_rtk_x_v\":" << data.S_rtk_x_v << ","
+         << "\"v_n\":" << data.v_n << ","
+         << "\"v_e\":" << data.v_e << ","
+         << "\"v_d\":" << data.v_d << ","
+         << "\"S_rtk_v_h\":" << data.S_rtk_v_h << ","
+         << "\"S_rtk_v_v\":" << data.S_rtk_v_v << ","
+         << "\"sats\":" << data.sats << ","
+         << "\"local_e\":" << data.local_e << ","
+         << "\"local_n\":" << data.local_n << ","
+         << "\"local_u\":" << data.local_u
+         << "}";
+    return json.str();
+}
+
+template <typename T>
+static inline void put(u8*& p, T value) {
+    memcpy(p, &value, sizeof(T));
+    p += sizeof(T);
+}
+
+size_t encode_binary(const PiksiData& data, u32 seq, u8* buf) {
+    u8* p = buf;
+    put<u8>(p, 'P');
+    put<u8>(p, 'K');
+    put<u8>(p, kBinaryVersion);
+    put<u8>(p, data.rtk_solution ? 0x01 : 0x00);
+    put<u32>(p, seq);
+    put<double>(p, data.utc_timestamp);
+    put<float>(p, data.utc);
+    put<u8>(p, data.hr);
+    put<u8>(p, data.min);
+    put<u8>(p, data.sec);
+    put<u8>(p, data.epoch_parts);
+    put<double>(p, data.ms);
+    put<double>(p, data.frequency);
+    put<s32>(p, data.status);
+    put<s32>(p, data.sats);
+    put<double>(p, data.lat);
+    put<double>(p, data.lon);
+    put<double>(p, data.h);
+    put<float>(p, data.S_llh_h);
+    put<float>(p, data.S_llh_v);
+    put<double>(p, data.ecef_x);
+    put<double>(p, data.ecef_y);
+    put<double>(p, data.ecef_z);
+    put<float>(p, data.S_ecef);
+    put<double>(p, data.n);
+    put<double>(p, data.e);
+    put<double>(p, data.d);
+    put<float>(p, data.S_rtk_x_h);
+    put<float>(p, data.S_rtk_x_v);
+    put<double>(p, data.v_n);
+    put<double>(p, data.v_e);
+    put<double>(p, data.v_d);
+    put<float>(p, data.S_rtk_v_h);
+    put<float>(p, data.S_rtk_v_v);
+    put<u32>(p, data.tow);
+    put<s64>(p, data.host_mono_ns);
+    put<s64>(p, data.host_real_ns);
+    put<u16>(p, data.gps_week);
+    put<u16>(p, 0);
+    put<double>(p, data.local_e);
+    put<double>(p, data.local_n);
+    put<double>(p, data.local_u);
+    return static_cast<size_t>(p - buf);
+}
+
+template <typename T>
+static inline T get(const u8*& p) {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return value;
+}
+
+bool decode_binary(const u8* buf, size_t len, PiksiData* data, u32* seq) {
+    // Encoded size of each version; later versions only append fields.
+    static const size_t kVersionSize[] = {0, 172, 176, 196, kBinarySize};
+    if (len < 4 || buf[0] != 'P' || buf[1] != 'K' || buf[2] == 0 || buf[2] > kBinaryVersion ||
+        len < kVersionSize[buf[2]]) {
+        return false;
+    }
+    u8 version = buf[2];
+    const u8* p = buf + 3;
+    data->rtk_solution = (get<u8>(p) & 0x01) != 0;
+    *seq = get<u32>(p);
+    data->utc_timestamp = get<double>(p);
+    data->utc = get<float>(p);
+    data->hr = get<u8>(p);
+    data->min = get<u8>(p);
+    data->sec = get<u8>(p);
+    u8 parts = get<u8>(p);
+    if (version >= 2) {
+        data->epoch_parts = parts;
+    }
+    data->ms = get<double>(p);
+    data->frequency = get<double>(p);
+    data->status = get<s32>(p);
+    data->sats = get<s32>(p);
+    data->lat = get<double>(p);
+    data->lon = get<double>(p);
+    data->h = get<double>(p);
+    data->S_llh_h = get<float>(p);
+    data->S_llh_v = get<float>(p);
+    data->ecef_x = get<double>(p);
+    data->ecef_y = get<double>(p);
+    data->ecef_z = get<double>(p);
+    data->S_ecef = get<float>(p);
+    data->n = get<double>(p);
+    data->e = get<double>(p);
+    data->d = get<double>(p);
+    data->S_rtk_x_h = get<float>(p);
+    data->S_rtk_x_v = get<float>(p);
+    data->v_n = get<double>(p);
+    data->v_e = get<double>(p);
+    data->v_d = get<double>(p);
+    data->S_rtk_v_h = get<float>(p);
+    data->S_rtk_v_v = get<float>(p);
+    if (version >= 2) {
+        data->tow = get<u32>(p);
+    }
+    if (version >= 3) {
+        data->host_mono_ns = get<s64>(p);
+        data->host_real_ns = get<s64>(p);
+        data->gps_week = get<u16>(p);
+    }
+    if (version >= 4) {
+        p += 2;
+        data->local_e = get<double>(p);
+        data->local_n = get<double>(p);
+        data->local_u = get<double>(p);
+    }
+    return true;
+}
+
+namespace {
+
+enum class FieldType { kF64, kF32, kU8, kU16, kU32, kS32, kS64, kBool };
+
+struct JsonField {
+    const char* name;
+    FieldType type;
+    size_t offset;
+};
+
+#define PIKSI_FIELD(name, type) {#name, FieldType::type, offsetof(PiksiData, name)}
+const JsonField kJsonFields[] = {
+    PIKSI_FIELD(tow, kU32), PIKSI_FIELD(gps_week, kU16), PIKSI_FIELD(host_mono_ns, kS64),
+    PIKSI_FIELD(host_real_ns, kS64), PIKSI_FIELD(utc_timestamp, kF64), PIKSI_FIELD(utc, kF32),
+    PIKSI_FIELD(hr, kU8), PIKSI_FIELD(min, kU8), PIKSI_FIELD(sec, kU8), PIKSI_FIELD(ms, kF64),
+    PIKSI_FIELD(frequency, kF64), PIKSI_FIELD(rtk_solution, kBool), PIKSI_FIELD(status, kS32),
+    PIKSI_FIELD(lat, kF64), PIKSI_FIELD(lon, kF64), PIKSI_FIELD(h, kF64),
+    PIKSI_FIELD(S_llh_h, kF32), PIKSI_FIELD(S_llh_v, kF32),
+    PIKSI_FIELD(ecef_x, kF64), PIKSI_FIELD(ecef_y, kF64), PIKSI_FIELD(ecef_z, kF64), PIKSI_FIELD(S_ecef, kF32),
+    PIKSI_FIELD(n, kF64), PIKSI_FIELD(e, kF64), PIKSI_FIELD(d, kF64),
+    PIKSI_FIELD(S_rtk_x_h, kF32), PIKSI_FIELD(S_rtk_x_v, kF32),
+    PIKSI_FIELD(v_n, kF64), PIKSI_FIELD(v_e, kF64), PIKSI_FIELD(v_d, kF64),
+    PIKSI_FIELD(S_rtk_v_h, kF32), PIKSI_FIELD(S_rtk_v_v, kF32), PIKSI_FIELD(sats, kS32),
+    PIKSI_FIELD(local_e, kF64), PIKSI_FIELD(local_n, kF64), PIKSI_FIELD(local_u, kF64),
+};
+#undef PIKSI_FIELD
+
+void set_field(PiksiData* data, const JsonField& field, double value) {
+    u8* p = reinterpret_cast<u8*>(data) + field.offset;
+    switch (field.type) {
+    case FieldType::kF64: { double v = value; memcpy(p, &v, sizeof(v)); break; }
+    case FieldType::kF32: { float v = static_cast<float>(value); memcpy(p, &v, sizeof(v)); break; }
+    case FieldType::kU8: { u8 v = static_cast<u8>(value); memcpy(p, &v, sizeof(v)); break; }
+    case FieldType::kU16: { u16 v = static_cast<u16>(value); memcpy(p, &v, sizeof(v)); break; }
+    case FieldType::kU32: { u32 v = static_cast<u32>(value); memcpy(p, &v, sizeof(v)); break; }
+    case FieldType::kS32: { s32 v = static_cast<s32>(value); memcpy(p, &v, sizeof(v)); break; }
+    case FieldType::kS64: { s64 v = static_cast<s64>(value); memcpy(p, &v, sizeof(v)); break; }
+    case FieldType::kBool: { bool v = value != 0.0; memcpy(p, &v, sizeof(v)); break; }
+    }
+}
+
+} // namespace
+
+// Only the flat object to_json() writes: string keys, number or boolean values.
+bool decode_json(const char* buf, size_t len, PiksiData* data, u32* seq) {
+    std::string text(buf, len); // NUL-terminated for strtod/strtoll
+    const char* p = text.c_str();
+    const char* end = p + text.size();
+    auto skip_space = [&] { while (p < end && isspace(static_cast<unsigned char>(*p))) ++p; };
+
+    skip_space();
+    if (p == end || *p++ != '{') {
+        return false;
+    }
+    bool has_seq = false;
+    for (;;) {
+        skip_space();
+        if (p < end && *p == '}') {
+            return has_seq;
+        }
+        if (p == end || *p++ != '"') {
+            return false;
+        }
+        const char* key = p;
+        while (p < end && *p != '"') ++p;
+        if (p == end) {
+            return false;
+        }
+        std::string name(key, p++);
+        skip_space();
+        if (p == end || *p++ != ':') {
+            return false;
+        }
+        skip_space();
+        double value = 0.0;
+        s64 integer = 0;
+        bool is_integer = false;
+        if (strncmp(p, "true", 4) == 0 || strncmp(p, "false", 5) == 0) {
+            value = (*p == 't') ? 1.0 : 0.0;
+            p += (*p == 't') ? 4 : 5;
+        } else {
+            char* number_end = nullptr;
+            value = strtod(p, &number_end);
+            if (number_end == p) {
+                return false;
+            }
+            // Nanosecond stamps do not survive a round trip through a double.
+            char* integer_end = nullptr;
+            integer = strtoll(p, &integer_end, 10);
+            is_integer = (integer_end == number_end);
+            p = number_end;
+        }
+
+        if (name == "seq") {
+            *seq = static_cast<u32>(integer);
+            has_seq = is_integer;
+        } else {
+            for (const JsonField& field : kJsonFields) {
+                if (name != field.name) {
+                    continue;
+                }
+                if (field.type == FieldType::kS64 && is_integer) {
+                    memcpy(reinterpret_cast<u8*>(data) + field.offset, &integer, sizeof(integer));
+                } else {
+                    set_field(data, field, value);
+                }
+                break;
+            }
+        }
+        skip_space();
+        if (p < end && *p == ',') {
+            ++p;
+        }
+    }
+}
+
+bool decode_solution(const u8* buf, size_t len, PiksiData* data, u32* seq) {
+    if (len >= 2 && buf[0] == 'P' && buf[1] == 'K') {
+        return decode_binary(buf, len, data, seq);
+    }
+    return decode_json(reinterpret_cast<const char*>(buf), len, data, seq);
+}
+
+const char* topic_name(Topic topic) {
+    switch (topic) {
+    case Topic::kFull:
+        return "";
+    case Topic::kLlh:
+        return "llh";
+    case Topic::kVel:
+        return "vel";
+    case Topic::kBaseline:
+        return "baseline";
+    case Topic::kTime:
+        return "time";
+    }
+    return "";
+}
+
+std::string topic_json(Topic topic, const PiksiData& data, u32 seq) {
+    if (topic == Topic::kFull) {
+        return to_json(data, seq);
+    }
+    std::ostringstream json;
+    json << std::setprecision(15) << std::boolalpha;
+    json << "{"
+         << "\"seq\":" << seq << ","
+         << "\"tow\":" << data.tow << ","
+         << "\"host_mono_ns\":" << data.host_mono_ns << ","
+         << "\"rtk_solution\":" << data.rtk_solution << ","
+         << "\"status\":" << data.status << ","
+         << "\"sats\":" << data.sats << ",";
+    switch (topic) {
+    case Topic::kLlh:
+        json << "\"lat\":" << data.lat << ","
+             << "\"lon\":" << data.lon << ","
+             << "\"h\":" << data.h << ","
+             << "\"S_llh_h\":" << data.S_llh_h << ","
+             << "\"S_llh_v\":" << data.S_llh_v;
+        break;
+    case Topic::kVel:
+        json << "\"v_n\":" << data.v_n << ","
+             << "\"v_e\":" << data.v_e << ","
+             << "\"v_d\":" << data.v_d << ","
+             << "\"S_rtk_v_h\":" << data.S_rtk_v_h << ","
+             << "\"S_rtk_v_v\":" << data.S_rtk_v_v;
+        break;
+    case Topic::kBaseline:
+        json << "\"n\":" << data.n << ","
+             << "\"e\":" << data.e << ","
+             << "\"d\":" << data.d << ","
+             << "\"S_rtk_x_h\":" << data.S_rtk_x_h << ","
+             << "\"S_rtk_x_v\":" << data.S_rtk_x_v;
+        break;
+    case Topic::kFull:
+        break;
+    case Topic::kTime:
+        json << "\"utc_timestamp\":" << data.utc_timestamp << ","
+             << "\"ms\":" << data.ms << ","
+             << "\"host_real_ns\":" << data.host_real_ns << ","
+             << "\"gps_week\":" << data.gps_week << ","
+             << "\"hr\":" << static_cast<int>(data.hr) << ","
+             << "\"min\":" << static_cast<int>(data.min) << ","
+             << "\"sec\":" << static_cast<int>(data.sec);
+        break;
+    }
+    json << "}";
+    return json.str();
+}
+
+size_t encode_topic(Topic topic, const PiksiData& data, u32 seq, u8* buf) {
+    if (topic == Topic::kFull) {
+        return encode_binary(data, seq, buf);
+    }
+    u8* p = buf;
+    put<u8>(p, 'P');
+    put<u8>(p, 'T');
+    put<u8>(p, kTopicVersion);
+    put<u8>(p, static_cast<u8>(topic));
+    put<u32>(p, seq);
+    put<u32>(p, data.tow);
+    put<u8>(p, static_cast<u8>(data.status));
+    put<u8>(p, static_cast<u8>(data.sats));
+    put<u8>(p, data.rtk_solution ? 0x01 : 0x00);
+    put<u8>(p, 0);
+    put<s64>(p, data.host_mono_ns);
+    switch (topic) {
+    case Topic::kLlh:
+        put<double>(p, data.lat);
+        put<double>(p, data.lon);
+        put<double>(p, data.h);
+        put<float>(p, data.S_llh_h);
+        put<float>(p, data.S_llh_v);
+        break;
+    case Topic::kVel:
+        put<double>(p, data.v_n);
+        put<double>(p, data.v_e);
+        put<double>(p, data.v_d);
+        put<float>(p, data.S_rtk_v_h);
+        put<float>(p, data.S_rtk_v_v);
+        break;
+    case Topic::kBaseline:
+        put<double>(p, data.n);
+        put<double>(p, data.e);
+        put<double>(p, data.d);
+        put<float>(p, data.S_rtk_x_h);
+        put<float>(p, data.S_rtk_x_v);
+        break;
+    case Topic::kFull:
+        break;
+    case Topic::kTime:
+        put<double>(p, data.utc_timestamp);
+        put<double>(p, data.ms);
+        put<s64>(p, data.host_real_ns);
+        put<u16>(p, data.gps_week);
+        put<u8>(p, data.hr);
+        put<u8>(p, data.min);
+        put<u8>(p, data.sec);
+        put<u8>(p, 0);
+        put<u16>(p, 0);
+        break;
+    }
+    return static_cast<size_t>(p - buf);
+}
+
+size_t encode_imu_header(u8 count, u32 seq, const ImuInfo& info, u8* buf) {
+    u8* p = buf;
+    put<u8>(p, 'P');
+    put<u8>(p, 'I');
+    put<u8>(p, kImuBatchVersion);
+    put<u8>(p, count);
+    put<u32>(p, seq);
+    put<u8>(p, info.imu_type);
+    put<u8>(p, info.imu_conf);
+    put<u16>(p, 0);
+    put<float>(p, info.temperature);
+    return static_cast<size_t>(p - buf);
+}
+
+size_t encode_imu_sample(const ImuSample& sample, u8* buf) {
+    u8* p = buf;
+    put<s64>(p, sample.host_mono_ns);
+    put<s64>(p, sample.host_real_ns);
+    put<u32>(p, sample.tow);
+    put<u8>(p, sample.tow_f);
+    put<u8>(p, sample.time_status);
+    put<u16>(p, 0);
+    for (float a : sample.acc) {
+        put<float>(p, a);
+    }
+    for (float g : sample.gyr) {
+        put<float>(p, g);
+    }
+    return static_cast<size_t>(p - buf);
+}
+
+static const char kCsvHeader[] =
+    "UTC_timestamp,UTC,HR,MIN,SEC,MS,Frequency,RTK_solution,Status,Lat,Lon,Height,S_llh_h,S_llh_v,ECEF_x,ECEF_y,ECEF_z,S_ecef,Baseline_n,Baseline_e,Baseline_d,S_rtk_x_h,S_rtk_x_v,Vel_n,Vel_e,Vel_d,S_rtk_v_h,S_rtk_v_v,Sats,GPS_week,Host_mono_ns,Host_real_ns,Local_e,Local_n,Local_u\n";
+
+void append_csv_header(std::string& out) {
+    out.append(kCsvHeader);
+}
+
+// %.15g matches the std::setprecision(15) stream formatting used originally.
+void append_csv_row(std::string& out, const PiksiData& data) {
+    char row[1024];
+    int n = snprintf(row, sizeof(row),
+                     "%.15g,%.15g,%d,%d,%d,%.15g,%.15g,%d,%d,"
+                     "%.15g,%.15g,%.15g,%.15g,%.15g,"
+                     "%.15g,%.15g,%.15g,%.15g,"
+                     "%.15g,%.15g,%.15g,%.15g,%.15g,"
+                     "%.15g,%.15g,%.15g,%.15g,%.15g,%d,%u,%lld,%lld,%.15g,%.15g,%.15g\n",
+                     data.utc_timestamp, data.utc,
+                     static_cast<int>(data.hr), static_cast<int>(data.min), static_cast<int>(data.sec),
+                     data.ms, data.frequency, static_cast<int>(data.rtk_solution), data.status,
+                     data.lat, data.lon, data.h, data.S_llh_h, data.S_llh_v,
+                     data.ecef_x, data.ecef_y, data.ecef_z, data.S_ecef,
+                     data.n, data.e, data.d, data.S_rtk_x_h, data.S_rtk_x_v,
+                     data.v_n, data.v_e, data.v_d, data.S_rtk_v_h, data.S_rtk_v_v, data.sats,
+                     static_cast<unsigned>(data.gps_week), static_cast<long long>(data.host_mono_ns),
+                     static_cast<long long>(data.host_real_ns), data.local_e, data.local_n, data.local_u);
+    if (n > 0) {
+        out.append(row, std::min(static_cast<size_t>(n), sizeof(row) - 1));
+    }
+}
+
+void write_csv_header(std::ostream& os) {
+    os << kCsvHeader;
+}
+
+void write_csv_row(std::ostream& os, const PiksiData& data) {
+    std::string row;
+    append_csv_row(row, data);
+    os << row;
+}
+
+} // namespace piksi
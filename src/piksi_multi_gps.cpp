@@ -2,55 +2,138 @@
 #include <libsbp/legacy/api.h>
 #include <libsbp/legacy/compat.h>
 #include <libsbp/legacy/cpp/payload_handler.h>
+#include <algorithm>
 #include <thread>
 #include <iostream>
-#include <ctime>
-#include <cstdlib> // for setenv
+#include <cstdlib>
 #include <iomanip>
 #include <sstream>
 #include <fstream>
 #include <cstring>
+#include <cstdio>
+#include <cmath>
 #include <zenoh.hxx>
 
 using namespace zenoh;
 
 namespace piksi {
 
-static struct sp_port *piksi_port;
-int PiksiMultiGPS::loop_count_ = 0;
-bool PiksiMultiGPS::flag_start_ = false;
+const char* const PiksiMultiGPS::kDefaultSection = "Piksi Multi GPS";
 
-static sbp_msg_callbacks_node_t heartbeat_node_0;
-static sbp_msg_callbacks_node_t gps_time_node;
-static sbp_msg_callbacks_node_t pos_llh_node;
-static sbp_msg_callbacks_node_t pos_ecef_node;
-static sbp_msg_callbacks_node_t vel_ned_node;
-static sbp_msg_callbacks_node_t baseline_node;
-static sbp_msg_callbacks_node_t heartbeat_node;
+std::shared_ptr<Session> PiksiMultiGPS::open_session(bool shm) {
+    // Initialize Zenoh session for UDP publishing
+    Config zenoh_config = Config::create_default();
+    zenoh_config.insert_json5("mode", "\"peer\"");
+    zenoh_config.insert_json5("listen/endpoints", "[\"udp/0.0.0.0:7447\"]");
+    if (shm) {
+        zenoh_config.insert_json5("transport/shared_memory/enabled", "true");
+    }
+    return std::make_shared<Session>(Session::open(std::move(zenoh_config)));
+}
 
-PiksiMultiGPS::PiksiMultiGPS(const std::string& config_file_path)
-    : serial_port_name_(nullptr) {
+PiksiMultiGPS::PiksiMultiGPS(const std::string& config_file_path, const std::string& section,
+                             std::shared_ptr<Session> session, bool zenoh)
+    : section_(section), session_(std::move(session)) {
     // Set default values
     port_ = "/dev/cu.usbserial-AL00KUE3";
     baud_rate_ = 115200;
+    // Extra receivers ("[Piksi Multi GPS rover]") publish under their own name by default
+    name_ = (section_.size() > std::strlen(kDefaultSection)) ? section_.substr(std::strlen(kDefaultSection) + 1) : "";
+    zenoh_key_ = name_.empty() ? "fdcl/piksi" : "fdcl/piksi/" + name_;
+    settings_.push_back({"solution", "soln_freq", "10"});
 
     read_config(config_file_path);
+    config_baud_rate_ = baud_rate_;
+
+    // piksi_port_read() looks at s_ before setup_parsers() registers the callbacks
+    sbp_state_init(&s_);
+    sbp_state_set_io_context(&s_, this);
+
+    assembler_.configure(epoch_parts_, std::chrono::milliseconds(epoch_timeout_ms_));
+    if (!replay_file_.empty()) {
+        link_options_.reconnect = false; // a recording ends, it does not drop out
+        link_options_.timeout_ms = 0;
+    }
+    link_options_.backoff_min_ms = std::max(1, link_options_.backoff_min_ms);
+    link_options_.backoff_max_ms = std::max(link_options_.backoff_min_ms, link_options_.backoff_max_ms);
+    link_.configure(link_options_);
 
     data_.rtk_solution = false;
     data_.frequency = 0.0;
+    data_.tow = 0;
+    data_.epoch_parts = 0;
+    data_.gps_week = 0;
+    data_.host_mono_ns = 0;
+    data_.host_real_ns = 0;
     data_.utc_timestamp = -1.0;
-    last_update_ = std::chrono::high_resolution_clock::time_point{};
+    data_.local_e = data_.local_n = data_.local_u = 0.0;
+    log_options_.latency = &metrics_.histogram(Stage::kLog);
+    if (stats_key_.empty()) {
+        stats_key_ = zenoh_key_ + "/stats";
+    }
+    if (imu_key_.empty()) {
+        imu_key_ = zenoh_key_ + "/imu";
+    }
+    imu_batch_ = std::max(1, std::min(imu_batch_, static_cast<int>(kMaxImuBatch)));
+    if (history_size_ > 0) {
+        history_ = std::make_unique<SolutionHistory>(static_cast<size_t>(history_size_), history_max_gap_ms_);
+    }
+    if (predict_enabled_) {
+        predictor_options_.local_origin = local_origin_;
+        predictor_ = std::make_unique<StatePredictor>(predictor_options_);
+        if (predict_key_.empty()) {
+            predict_key_ = zenoh_key_ + "/predicted";
+        }
+    }
 
-    // Initialize Zenoh session for UDP publishing
-    Config zenoh_config = Config::create_default();
-    zenoh_config.insert_json5("mode", "\"peer\"");
-    zenoh_config.insert_json5("listen/endpoints", "[\"udp/0.0.0.0:7447\"]");
-    session_ = Session::open(std::move(zenoh_config));
-    pub_ = session_->declare_publisher("fdcl/piksi");
-    std::cout << "Zenoh: Initialized publisher on key 'fdcl/piksi' via UDP." << std::endl;
+    if (!zenoh) {
+        session_.reset();
+        std::cout << "Zenoh: Publishing disabled by the application." << std::endl;
+        return;
+    }
+    if (!zenoh_enabled_) {
+        std::cout << "Zenoh: Publishing disabled in config." << std::endl;
+        return;
+    }
+
+    if (!session_) {
+        session_ = open_session(publisher_options_.shm);
+    }
+    publisher_options_.key = zenoh_key_;
+    publisher_ = std::make_unique<SolutionPublisher>(session_, publisher_options_, snapshot_, metrics_);
+    if (stats_period_ms_ > 0) {
+        stats_pub_ = session_->declare_publisher(KeyExpr(stats_key_));
+        std::cout << "Zenoh: Publishing pipeline stats on '" << stats_key_ << "' every "
+                  << stats_period_ms_ << " ms." << std::endl;
+    }
+    if (imu_enabled_) {
+        imu_pub_ = session_->declare_publisher(KeyExpr(imu_key_));
+        std::cout << "Zenoh: Publishing IMU batches of " << imu_batch_ << " samples on '" << imu_key_ << "'." << std::endl;
+    }
+    if (predictor_ && predict_hz_ > 0.0) {
+        prediction_publisher_ = std::make_unique<PredictionPublisher>(session_, predict_key_, publisher_options_.binary,
+                                                                      predict_hz_, *predictor_);
+    }
+    if (!corrections_options_.key.empty()) {
+        if (!replay_file_.empty()) {
+            std::cout << "Zenoh: Replaying a recording; corrections on '" << corrections_options_.key
+                      << "' are not forwarded." << std::endl;
+            return;
+        }
+        corrections_options_.latency = &metrics_.histogram(Stage::kCorrection);
+        corrections_ = std::make_unique<CorrectionForwarder>(corrections_options_);
+        CorrectionForwarder* forwarder = corrections_.get();
+        corrections_sub_.emplace(session_->declare_subscriber(
+            KeyExpr(corrections_options_.key),
+            [forwarder](const Sample& sample) { forwarder->push(sample.get_payload().as_vector()); },
+            closures::none));
+        std::cout << "Zenoh: Forwarding corrections from '" << corrections_options_.key << "' to the receiver."
+                  << std::endl;
+    }
 }
 
 PiksiMultiGPS::~PiksiMultiGPS() {
+    stop();
     close();
 }
 
@@ -71,7 +154,7 @@ void PiksiMultiGPS::read_config(const std::string& config_file_path) {
         // Check for section header
         if (line.length() > 0 && line.front() == '[' && line.back() == ']') {
             std::string section = line.substr(1, line.length() - 2);
-            in_piksi_section = (section == "Piksi Multi GPS");
+            in_piksi_section = (section == section_);
             continue;
         }
 
@@ -100,6 +183,180 @@ void PiksiMultiGPS::read_config(const std::string& config_file_path) {
                     }
                 } else if (key == "log_to_csv") {
                     log_to_csv_ = (value == "true");
+                } else if (key == "zenoh_key") {
+                    zenoh_key_ = value;
+                } else if (key == "zenoh_enabled") {
+                    zenoh_enabled_ = (value == "true");
+                } else if (key == "payload_format") {
+                    if (value == "binary" || value == "json") {
+                        publisher_options_.binary = (value == "binary");
+                    } else {
+                        std::cerr << "GPS: Warning - Unknown payload_format in config. Using json." << std::endl;
+                    }
+                } else if (key.compare(0, 6, "topic_") == 0 && key.size() > 9 &&
+                           key.compare(key.size() - 3, 3, "_hz") == 0) {
+                    set_topic_rate(key, value);
+                } else if (key == "shm_enabled") {
+                    publisher_options_.shm = (value == "true");
+                } else if (key == "reader_thread") {
+                    reader_thread_ = (value == "true");
+                } else if (key == "rt_cpus") {
+                    if (!value.empty() && !parse_cpu_list(value, &realtime_.cpus)) {
+                        std::cerr << "GPS: Warning - Invalid rt_cpus in config. Expected a list like 2,3 or 0-3." << std::endl;
+                    }
+                } else if (key == "rt_priority") {
+                    parse_int(key, value, realtime_.priority);
+                } else if (key == "rt_mlockall") {
+                    realtime_.lock_memory = (value == "true");
+                } else if (key == "epoch_messages") {
+                    u8 parts = parse_epoch_parts(value);
+                    if (parts != 0) {
+                        epoch_parts_ = parts;
+                    } else {
+                        std::cerr << "GPS: Warning - Invalid epoch_messages in config. Using default." << std::endl;
+                    }
+                } else if (key == "epoch_timeout_ms") {
+                    parse_int(key, value, epoch_timeout_ms_);
+                } else if (key == "log_format") {
+                    if (!parse_log_format(value, &log_options_.format)) {
+                        std::cerr << "GPS: Warning - Unknown log_format in config. Using csv." << std::endl;
+                    }
+                } else if (key == "log_dir") {
+                    log_options_.rotation.directory = value;
+                } else if (key == "log_rotate_mb") {
+                    int mb = 0;
+                    if (parse_int(key, value, mb)) {
+                        log_options_.rotation.rotate_bytes = static_cast<uint64_t>(mb) * 1024 * 1024;
+                    }
+                } else if (key == "log_rotate_min") {
+                    int minutes = 0;
+                    if (parse_int(key, value, minutes)) {
+                        log_options_.rotation.rotate_seconds = minutes * 60;
+                    }
+                } else if (key == "log_fsync") {
+                    if (!parse_fsync_policy(value, &log_options_.rotation.fsync)) {
+                        std::cerr << "GPS: Warning - Unknown log_fsync in config. Using none." << std::endl;
+                    }
+                } else if (key == "log_fsync_period_ms") {
+                    parse_int(key, value, log_options_.rotation.fsync_period_ms);
+                } else if (key == "log_queue") {
+                    int records = 0;
+                    if (parse_int(key, value, records) && records > 0) {
+                        log_options_.queue_capacity = static_cast<size_t>(records);
+                    }
+                } else if (key == "log_batch_ms") {
+                    parse_int(key, value, log_options_.batch_ms);
+                } else if (key == "log_block_ms") {
+                    parse_int(key, value, log_options_.block_ms);
+                } else if (key == "capture_raw") {
+                    capture_raw_ = (value == "true");
+                } else if (key == "capture_dir") {
+                    capture_options_.rotation.directory = value;
+                    capture_dir_set_ = true;
+                } else if (key == "capture_rotate_mb") {
+                    int mb = 0;
+                    if (parse_int(key, value, mb)) {
+                        capture_options_.rotation.rotate_bytes = static_cast<uint64_t>(mb) * 1024 * 1024;
+                    }
+                } else if (key == "capture_rotate_min") {
+                    int minutes = 0;
+                    if (parse_int(key, value, minutes)) {
+                        capture_options_.rotation.rotate_seconds = minutes * 60;
+                    }
+                } else if (key == "console_hz") {
+                    parse_int(key, value, console_options_.refresh_hz);
+                } else if (key == "console_in_place") {
+                    console_options_.in_place = (value == "true");
+                } else if (key == "replay_file") {
+                    replay_file_ = value;
+                } else if (key == "replay_realtime") {
+                    replay_realtime_ = (value == "true");
+                } else if (key == "read_timeout_ms") {
+                    parse_int(key, value, read_timeout_ms_);
+                } else if (key == "stats_period_ms") {
+                    parse_int(key, value, stats_period_ms_);
+                } else if (key == "stats_key") {
+                    stats_key_ = value;
+                } else if (key == "corrections_key") {
+                    corrections_options_.key = value;
+                } else if (key == "corrections_queue_kb") {
+                    int kb = 0;
+                    if (parse_int(key, value, kb) && kb > 0) {
+                        corrections_options_.queue_bytes = static_cast<size_t>(kb) * 1024;
+                    }
+                } else if (key == "corrections_max_age_ms") {
+                    parse_int(key, value, corrections_options_.max_age_ms);
+                } else if (key == "predict_enabled") {
+                    predict_enabled_ = (value == "true");
+                } else if (key == "predict_hz") {
+                    parse_double(key, value, predict_hz_);
+                } else if (key == "predict_key") {
+                    predict_key_ = value;
+                } else if (key == "predict_accel_noise") {
+                    double noise = 0.0;
+                    if (parse_double(key, value, noise) && noise > 0.0) {
+                        predictor_options_.accel_noise = noise;
+                    }
+                } else if (key == "predict_latency_ms") {
+                    parse_int(key, value, predictor_options_.latency_ms);
+                } else if (key == "predict_max_ms") {
+                    int ms = 0;
+                    if (parse_int(key, value, ms) && ms > 0) {
+                        predictor_options_.max_horizon_ms = ms;
+                    }
+                } else if (key == "local_origin") {
+                    double lat = 0.0, lon = 0.0, h = 0.0;
+                    char extra = 0;
+                    if (value.empty()) {
+                        local_origin_.reset();
+                    } else if (std::sscanf(value.c_str(), "%lf , %lf , %lf %c", &lat, &lon, &h, &extra) == 3 &&
+                               std::fabs(lat) <= 90.0 && std::fabs(lon) <= 180.0) {
+                        local_origin_ = LocalFrame::at(lat, lon, h);
+                    } else {
+                        std::cerr << "GPS: Warning - Invalid local_origin in config. Expected lat,lon,height." << std::endl;
+                    }
+                } else if (key == "history_size") {
+                    parse_int(key, value, history_size_);
+                } else if (key == "history_max_gap_ms") {
+                    parse_int(key, value, history_max_gap_ms_);
+                } else if (key == "solution_rate_hz") {
+                    set_setting({"solution", "soln_freq", value});
+                } else if (key.compare(0, 8, "setting.") == 0) {
+                    Setting setting;
+                    if (parse_setting_key(key.substr(8), &setting)) {
+                        setting.value = value;
+                        set_setting(setting);
+                    } else {
+                        std::cerr << "GPS: Warning - Invalid " << key << " in config. Expected setting.<section>.<name>." << std::endl;
+                    }
+                } else if (key == "target_baud_rate") {
+                    parse_int(key, value, target_baud_rate_);
+                } else if (key == "receiver_uart") {
+                    receiver_uart_ = value;
+                } else if (key == "settings_timeout_ms") {
+                    parse_int(key, value, settings_timeout_ms_);
+                } else if (key == "settings_retries") {
+                    parse_int(key, value, settings_retries_);
+                } else if (key == "settings_save") {
+                    settings_save_ = (value == "true");
+                } else if (key == "imu_enabled") {
+                    imu_enabled_ = (value == "true");
+                } else if (key == "imu_key") {
+                    imu_key_ = value;
+                } else if (key == "imu_batch") {
+                    parse_int(key, value, imu_batch_);
+                } else if (key == "imu_batch_ms") {
+                    parse_int(key, value, imu_batch_ms_);
+                } else if (key == "heartbeat_timeout_ms") {
+                    parse_int(key, value, heartbeat_timeout_ms_);
+                } else if (key == "reconnect") {
+                    link_options_.reconnect = (value == "true");
+                } else if (key == "link_timeout_ms") {
+                    parse_int(key, value, link_options_.timeout_ms);
+                } else if (key == "reconnect_min_ms") {
+                    parse_int(key, value, link_options_.backoff_min_ms);
+                } else if (key == "reconnect_max_ms") {
+                    parse_int(key, value, link_options_.backoff_max_ms);
                 }
             }
         }
@@ -107,168 +364,665 @@ void PiksiMultiGPS::read_config(const std::string& config_file_path) {
     config_file.close();
 }
 
-void PiksiMultiGPS::open() {
-    serial_port_name_ = port_.c_str();
-    std::cout << "GPS: Attempting to open " << serial_port_name_ << " with baud rate " << baud_rate_ << " .." << std::endl;
-
-    if (!serial_port_name_) {
-        std::cerr << "GPS: Check the serial port path of the Piksi!" << std::endl;
-        exit(EXIT_FAILURE);
+// topic_<name>_hz: < 0 disables the topic, 0 publishes every solution.
+void PiksiMultiGPS::set_topic_rate(const std::string& key, const std::string& value) {
+    std::string name = key.substr(6, key.size() - 9);
+    for (size_t i = 0; i < kTopicCount; ++i) {
+        Topic topic = static_cast<Topic>(i);
+        if (name == (topic == Topic::kFull ? "full" : topic_name(topic))) {
+            try {
+                publisher_options_.rate_hz[i] = std::stod(value);
+            } catch (const std::exception& e) {
+                std::cerr << "GPS: Warning - Invalid " << key << " in config. Using default." << std::endl;
+            }
+            return;
+        }
     }
+    std::cerr << "GPS: Warning - Unknown topic in " << key << ". Expected full, llh, vel, baseline or time." << std::endl;
+}
 
-    int result = sp_get_port_by_name(serial_port_name_, &piksi_port);
-    if (result != SP_OK) {
-        std::cerr << "GPS: Cannot find provided serial port!" << std::endl;
-        exit(EXIT_FAILURE);
+bool PiksiMultiGPS::parse_int(const std::string& key, const std::string& value, int& out) {
+    try {
+        out = std::stoi(value);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "GPS: Warning - Invalid " << key << " in config. Using default." << std::endl;
+        return false;
     }
+}
 
-    result = sp_open(piksi_port, SP_MODE_READ_WRITE);
-    if (result != SP_OK) {
-        std::cerr << "GPS: Cannot open " << serial_port_name_ << " for reading/writing!" << std::endl;
-        exit(EXIT_FAILURE);
+bool PiksiMultiGPS::parse_double(const std::string& key, const std::string& value, double& out) {
+    try {
+        out = std::stod(value);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "GPS: Warning - Invalid " << key << " in config. Using default." << std::endl;
+        return false;
     }
-    std::cout << "GPS: Port is open" << std::endl;
-
-    setup_port(baud_rate_);
 }
 
-void PiksiMultiGPS::configure() {
-    std::cout << "GPS: Configuring solution frequency to 10 Hz..." << std::endl;
-
-    char setting[] = "solution\0soln_freq\0";
-    char value_str[] = "10\0";
+bool PiksiMultiGPS::open() {
+    if (!replay_file_.empty()) {
+        transport_ = std::make_unique<ReplayTransport>(replay_file_, replay_realtime_);
+    } else {
+        // Reads return at least this often so partial epochs still expire on time.
+        int timeout_ms = std::max(1, std::min(read_timeout_ms_, epoch_timeout_ms_));
+        transport_ = std::make_unique<SerialTransport>(port_, baud_rate_, timeout_ms);
+    }
 
-    u8 payload[sizeof(setting) + sizeof(value_str)];
-    memcpy(payload, setting, sizeof(setting));
-    memcpy(payload + sizeof(setting), value_str, sizeof(value_str));
-    u8 len = sizeof(setting) + sizeof(value_str);
+    if (!transport_->open()) {
+        if (!link_options_.reconnect) {
+            return false;
+        }
+        std::cerr << "GPS: " << port_ << " is not available yet; retrying." << std::endl;
+        transport_->set_quiet(true);
+        link_.unavailable(clock_ns(CLOCK_MONOTONIC));
+    }
 
-    s8 ret = sbp_send_message(&s_, SBP_MSG_SETTINGS_WRITE, 0, len, payload, &piksi_port_write);
-    if (ret != SBP_OK) {
-        std::cerr << "GPS: Failed to send settings write message: " << static_cast<int>(ret) << std::endl;
-    } else {
-        std::cout << "GPS: Configuration sent successfully." << std::endl;
+    if (log_to_csv_ && !logger_) {
+        log_options_.rotation.suffix = (name_.empty() ? "_gps_data" : "_gps_data_" + name_) +
+                                       log_extension(log_options_.format);
+        logger_ = std::make_unique<Logger>(log_options_);
+        logger_->start();
     }
+    if (capture_raw_ && !capture_) {
+        if (!capture_dir_set_) {
+            capture_options_.rotation.directory = log_options_.rotation.directory;
+        }
+        capture_options_.rotation.suffix = name_.empty() ? "_raw.sbp" : "_raw_" + name_ + ".sbp";
+        capture_options_.rotation.fsync = log_options_.rotation.fsync;
+        capture_options_.rotation.fsync_period_ms = log_options_.rotation.fsync_period_ms;
+        capture_ = std::make_unique<RawCapture>(capture_options_);
+        capture_->start();
+    }
+    if (publisher_) {
+        publisher_->start();
+    }
+    if (corrections_) {
+        corrections_->start(*transport_);
+    }
+    if (prediction_publisher_) {
+        prediction_publisher_->start();
+    }
+    return true;
 }
 
-void PiksiMultiGPS::setup_port(int baud) {
-    std::cout << "GPS: Attempting to configure the serial port..." << std::endl;
-    int result;
+void PiksiMultiGPS::set_setting(const Setting& setting) {
+    for (Setting& existing : settings_) {
+        if (existing.section == setting.section && existing.name == setting.name) {
+            existing.value = setting.value;
+            return;
+        }
+    }
+    settings_.push_back(setting);
+}
 
-    result = sp_set_baudrate(piksi_port, baud);
-    if (result != SP_OK) {
-        std::cerr << "GPS: Cannot set port baud rate!" << std::endl;
-        exit(EXIT_FAILURE);
+bool PiksiMultiGPS::configure() {
+    if (!replay_file_.empty()) {
+        std::cout << "GPS: Replaying a recording; receiver settings are not applied." << std::endl;
+        return true;
     }
 
-    result = sp_set_flowcontrol(piksi_port, SP_FLOWCONTROL_NONE);
-    if (result != SP_OK) {
-        std::cerr << "GPS: Cannot set flow control!" << std::endl;
-        exit(EXIT_FAILURE);
+    if (link_.state() == LinkState::kDown) {
+        std::cerr << "GPS: Warning - Receiver not connected; settings will be applied once it is." << std::endl;
+        needs_configure_ = true;
+        return false;
     }
+    needs_configure_ = false;
 
-    result = sp_set_bits(piksi_port, 8);
-    if (result != SP_OK) {
-        std::cerr << "GPS: Cannot set data bits!" << std::endl;
-        exit(EXIT_FAILURE);
+    // Responses arrive through the normal read path, so decoding, capture and
+    // the watchdog carry on while the exchange waits for them.
+    setup_parsers();
+    SettingsManager settings(*transport_, settings_timeout_ms_, settings_retries_, [this] { return settings_step(); });
+    settings_session_ = &settings;
+    bool ok = true;
+    if (target_baud_rate_ > 0 && target_baud_rate_ != baud_rate_) {
+        if (settings.switch_baud(receiver_uart_, baud_rate_, target_baud_rate_)) {
+            baud_rate_ = target_baud_rate_;
+        } else {
+            ok = false;
+        }
+        if (settings.rates_unknown()) {
+            // Nothing more can be said to the receiver. Without reconnect this
+            // ends acquisition; with it, the watchdog tries both rates.
+            settings_session_ = nullptr;
+            drop_link("baud rate mismatch", false);
+            return false;
+        }
     }
 
-    result = sp_set_parity(piksi_port, SP_PARITY_NONE);
-    if (result != SP_OK) {
-        std::cerr << "GPS: Cannot set parity!" << std::endl;
-        exit(EXIT_FAILURE);
+    std::cout << "GPS: Writing " << settings_.size() << " receiver setting(s)..." << std::endl;
+    if (!settings.write_all(settings_)) {
+        ok = false;
+    }
+    if (ok && settings_save_) {
+        ok = settings.save();
     }
+    settings_session_ = nullptr;
+    if (!ok) {
+        std::cerr << "GPS: Warning - Some receiver settings were not applied." << std::endl;
+    }
+    return ok;
+}
 
-    result = sp_set_stopbits(piksi_port, 1);
-    if (result != SP_OK) {
-        std::cerr << "GPS: Cannot set stop bits!" << std::endl;
-        exit(EXIT_FAILURE);
+// One step of the normal read path while configure() waits for the
+// receiver; false once the link is gone.
+bool PiksiMultiGPS::settings_step() {
+    if (!flag_start_) {
+        // Before the first heartbeat only s0_ runs, as in init_loop(), which
+        // also starts the watchdog.
+        if (sbp_process(&s0_, &piksi_port_read) == SBP_READ_ERROR) {
+            metrics_.count_read_error();
+            drop_link("read error", false);
+        }
+        if (capture_) {
+            capture_->flush_if_due(clock_ns(CLOCK_MONOTONIC));
+        }
+    } else {
+        decode_step();
+        s64 now = clock_ns(CLOCK_MONOTONIC);
+        service(now);
+        if (stats_pub_ && now >= next_stats_ns_) {
+            publish_stats();
+        }
     }
-    std::cout << "GPS: Configuring serial port completed." << std::endl;
+    return link_.state() != LinkState::kDown && !link_failed_;
 }
 
-void PiksiMultiGPS::init_loop() {
+// Registers the message callbacks once; configure() may need them before init_loop().
+void PiksiMultiGPS::setup_parsers() {
+    if (parsers_ready_) {
+        return;
+    }
+    parsers_ready_ = true;
+
     sbp_state_init(&s0_);
-    sbp_register_callback(&s0_, SBP_MSG_HEARTBEAT, &heartbeat_callback_0, NULL, &heartbeat_node_0);
+    sbp_state_set_io_context(&s0_, this);
+    sbp_register_callback(&s0_, SBP_MSG_HEARTBEAT, &heartbeat_callback_0, this, &heartbeat_node_0_);
+    sbp_register_callback(&s0_, SBP_MSG_SETTINGS_WRITE_RESP, &settings_write_resp_callback, this,
+                          &settings_write_node_0_);
+    sbp_register_callback(&s0_, SBP_MSG_SETTINGS_READ_RESP, &settings_read_resp_callback, this,
+                          &settings_read_node_0_);
 
     sbp_state_init(&s_);
     sbp_state_set_io_context(&s_, this);
-    sbp_register_callback(&s_, SBP_MSG_UTC_TIME, &gps_time_callback, this, &gps_time_node);
-    sbp_register_callback(&s_, SBP_MSG_POS_ECEF, &pos_ecef_callback, this, &pos_ecef_node);
-    sbp_register_callback(&s_, SBP_MSG_POS_LLH, &pos_llh_callback, this, &pos_llh_node);
-    sbp_register_callback(&s_, SBP_MSG_VEL_NED, &vel_ned_callback, this, &vel_ned_node);
-    sbp_register_callback(&s_, SBP_MSG_BASELINE_NED, &baseline_callback, this, &baseline_node);
-    sbp_register_callback(&s_, SBP_MSG_HEARTBEAT, &heartbeat_callback, this, &heartbeat_node);
+    sbp_register_callback(&s_, SBP_MSG_UTC_TIME, &gps_time_callback, this, &gps_time_node_);
+    sbp_register_callback(&s_, SBP_MSG_GPS_TIME, &gps_week_callback, this, &gps_week_node_);
+    sbp_register_callback(&s_, SBP_MSG_POS_ECEF, &pos_ecef_callback, this, &pos_ecef_node_);
+    sbp_register_callback(&s_, SBP_MSG_POS_LLH, &pos_llh_callback, this, &pos_llh_node_);
+    sbp_register_callback(&s_, SBP_MSG_VEL_NED, &vel_ned_callback, this, &vel_ned_node_);
+    sbp_register_callback(&s_, SBP_MSG_BASELINE_NED, &baseline_callback, this, &baseline_node_);
+    sbp_register_callback(&s_, SBP_MSG_HEARTBEAT, &heartbeat_callback, this, &heartbeat_node_);
+    sbp_register_callback(&s_, SBP_MSG_SETTINGS_WRITE_RESP, &settings_write_resp_callback, this, &settings_write_node_);
+    sbp_register_callback(&s_, SBP_MSG_SETTINGS_READ_RESP, &settings_read_resp_callback, this, &settings_read_node_);
+    if (imu_enabled_) {
+        sbp_register_callback(&s_, SBP_MSG_IMU_RAW, &imu_raw_callback, this, &imu_raw_node_);
+        sbp_register_callback(&s_, SBP_MSG_IMU_AUX, &imu_aux_callback, this, &imu_aux_node_);
+    }
+    if (corrections_) {
+        sbp_register_callback(&s_, SBP_MSG_AGE_CORRECTIONS, &age_corrections_callback, this, &age_corrections_node_);
+    }
+}
+
+bool PiksiMultiGPS::init_loop() {
+    // init_loop() and loop() run on the acquisition thread in both modes.
+    if (realtime_.enabled()) {
+        apply_realtime(realtime_);
+    }
+    setup_parsers();
 
     std::cout << "\nGPS: Waiting for the first heartbeat..." << std::endl;
-    while (!flag_start_) {
-        sbp_process(&s0_, &piksi_port_read);
+    // With reconnect, a missing or silent receiver is handled like a lost one:
+    // the link watchdog reopens the port and startup keeps waiting. The hard
+    // deadline is for replay and reconnect=false.
+    bool deadline_applies = heartbeat_timeout_ms_ > 0 && !link_options_.reconnect;
+    if (link_options_.reconnect && link_.state() == LinkState::kUp) {
+        link_.reopened(clock_ns(CLOCK_MONOTONIC)); // open but nothing heard yet: the watchdog starts now
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(heartbeat_timeout_ms_);
+    while (!flag_start_ && !finished() && !stop_requested_) {
+        // Returns after every byte or read timeout, so the checks below run even on a silent port.
+        if (ensure_link() && sbp_process(&s0_, &piksi_port_read) == SBP_READ_ERROR) {
+            metrics_.count_read_error();
+            drop_link("read error", false);
+        }
+        s64 now = clock_ns(CLOCK_MONOTONIC);
+        if (capture_) {
+            capture_->flush_if_due(now);
+        }
+        if (link_options_.reconnect && link_.timed_out(now)) {
+            drop_link("no heartbeat", true);
+        }
+        if (deadline_applies && std::chrono::steady_clock::now() > deadline) {
+            std::cerr << "GPS: No heartbeat within " << heartbeat_timeout_ms_ << " ms!" << std::endl;
+            return false;
+        }
+    }
+    if (!flag_start_) {
+        return false;
     }
     std::cout << "GPS: Starting the main loop..." << std::endl;
+    return true;
 }
 
 void PiksiMultiGPS::loop() {
-    int ret;
-    do {
-        ret = sbp_process(&s_, &piksi_port_read);
-        if (ret < 0) {
-            std::cout << "GPS: sbp_process error: " << ret << std::endl;
+    bool up = ensure_link(); // reopening allocates; everything after it must not
+    if (up && needs_configure_ && heartbeat_seen_) {
+        reapply_settings();
+    }
+#ifdef PIKSI_ALLOC_COUNTER
+    u64 allocs = thread_allocations();
+#endif
+    int ret = up ? 1 : 0;
+    while (ret > 0) {
+        ret = decode_step();
+    }
+
+    s64 now = clock_ns(CLOCK_MONOTONIC);
+    service(now);
+#ifdef PIKSI_ALLOC_COUNTER
+    check_allocations(allocs);
+#endif
+    // Stats reports are formatted into a new string; they are the one
+    // allocation loop() is allowed.
+    if (stats_pub_ && now >= next_stats_ns_) {
+        publish_stats();
+    }
+}
+
+// Decodes the next frame through s_; sbp_process()'s result.
+int PiksiMultiGPS::decode_step() {
+    int ret = sbp_process(&s_, &piksi_port_read);
+    if (ret > 0) {
+        link_.frame(frame_rx_.mono_ns);
+        metrics_.count_message(s_.msg_type);
+        metrics_.record(Stage::kDecode, clock_ns(CLOCK_MONOTONIC) - frame_rx_.mono_ns);
+    } else if (ret == SBP_CRC_ERROR) {
+        metrics_.count_crc_error();
+    } else if (ret == SBP_READ_ERROR) {
+        metrics_.count_read_error();
+        drop_link("read error", false);
+    } else if (ret < 0) {
+        std::cout << "GPS: sbp_process error: " << ret << std::endl;
+    }
+    if (assembler_.expired(EpochAssembler::Clock::now())) {
+        emit_epoch();
+    }
+    return ret;
+}
+
+// The watchdog and the time-driven flushes, run between reads.
+void PiksiMultiGPS::service(s64 now) {
+    if (link_.timed_out(now)) {
+        drop_link("no heartbeat", true);
+    }
+    if (capture_) {
+        capture_->flush_if_due(now); // the bytes before a dropout must not wait for the link
+    }
+    if (imu_ring_.size() > 0 && now - imu_oldest_ns_ >= imu_batch_ms_ * 1000000LL) {
+        publish_imu(); // a partial batch that has waited long enough
+    }
+}
+
+// Reopens a lost port once its backoff has passed; false while the link is down.
+bool PiksiMultiGPS::ensure_link() {
+    if (link_.state() != LinkState::kDown) {
+        return true;
+    }
+    s64 now = clock_ns(CLOCK_MONOTONIC);
+    if (now < link_.next_attempt_ns()) {
+        // Sleep at most one read timeout, as a read would, so stop() is still noticed.
+        s64 wait = std::min<s64>(link_.next_attempt_ns() - now, std::max(1, read_timeout_ms_) * 1000000LL);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+        return false;
+    }
+    if (!transport_->open()) {
+        link_.open_failed(now);
+        return false;
+    }
+    transport_->set_quiet(false);
+    reset_parser();
+    heartbeat_seen_ = false;
+    link_.reopened(clock_ns(CLOCK_MONOTONIC));
+    std::cout << "GPS: Opened " << port_ << "; resynchronising." << std::endl;
+    return true;
+}
+
+// Closes the port after a read error, hangup or missed heartbeats. Without
+// reconnect, acquisition ends instead.
+void PiksiMultiGPS::drop_link(const char* reason, bool heartbeat_timeout) {
+    if (!link_options_.reconnect) {
+        std::cerr << "GPS: Link lost (" << reason << ") and reconnect is disabled." << std::endl;
+        link_failed_ = true;
+        return;
+    }
+    std::cerr << "GPS: Link lost (" << reason << "); reopening " << port_ << "." << std::endl;
+    bool heard = link_.state() == LinkState::kUp; // any frame since the port was opened
+    link_.lost(transport_->rx_time().mono_ns, clock_ns(CLOCK_MONOTONIC), heartbeat_timeout);
+    transport_->set_quiet(true); // reopen attempts are silent until one succeeds
+    transport_->close();
+    // The receiver may have rebooted with its defaults: baud_rate and the
+    // unsaved settings. Re-apply them, and when not a single frame arrived at
+    // one rate, reopen at the other.
+    needs_configure_ = true;
+    if (!heard && heartbeat_timeout && target_baud_rate_ > 0 && target_baud_rate_ != config_baud_rate_) {
+        int tried = baud_rate_;
+        baud_rate_ = baud_rate_ == target_baud_rate_ ? config_baud_rate_ : target_baud_rate_;
+        transport_->set_baud(baud_rate_);
+        std::cerr << "GPS: Nothing received at " << tried << " baud; trying " << baud_rate_ << "." << std::endl;
+    }
+    if (assembler_.is_open()) {
+        emit_epoch(); // whatever arrived before the drop goes out as a partial epoch
+    }
+    reset_parser();
+}
+
+// Runs configure() again once a reopened receiver is heard from.
+void PiksiMultiGPS::reapply_settings() {
+    std::cout << "GPS: Receiver answering on " << port_ << "; re-applying settings." << std::endl;
+    configure();
+}
+
+// Discards a half-read frame: parsing restarts at the next preamble.
+void PiksiMultiGPS::reset_parser() {
+    s_.state = sbp_state_t::WAITING;
+    s_.n_read = 0;
+    s0_.state = sbp_state_t::WAITING;
+    s0_.n_read = 0;
+}
+
+#ifdef PIKSI_ALLOC_COUNTER
+// Everything is sized by the first solutions; after that, reading, decoding
+// and handing a solution on must not touch the heap.
+void PiksiMultiGPS::check_allocations(u64 before) {
+    static const u64 kWarmupSolutions = 10;
+    u64 allocs = thread_allocations() - before;
+    if (allocs == 0 || snapshot_.version() <= kWarmupSolutions) {
+        return;
+    }
+    metrics_.count_hot_path_allocs(allocs);
+    if (!hot_path_alloc_reported_) {
+        hot_path_alloc_reported_ = true;
+        std::cerr << "GPS: Warning - " << allocs << " heap allocation(s) in the acquisition loop after warm-up"
+                  << " (solution " << snapshot_.version() << "); see hot_path_allocs in the stats." << std::endl;
+    }
+}
+#endif
+
+void PiksiMultiGPS::start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    stop_requested_ = false;
+    reader_ = std::thread([this]() {
+        if (init_loop()) {
+            while (running_ && !finished()) {
+                loop();
+            }
         }
-    } while (ret > 0);
+        running_ = false;
+        snapshot_.notify_all();
+    });
+}
+
+void PiksiMultiGPS::stop() {
+    stop_requested_ = true;
+    running_ = false;
+    if (reader_.joinable()) {
+        // The reader leaves its loop once the current read returns (at most one read timeout).
+        reader_.join();
+    }
 }
 
 void PiksiMultiGPS::close() {
-    if (piksi_port) {
-        int result = sp_close(piksi_port);
-        if (result != SP_OK) {
-            std::cerr << "GPS: Cannot close " << serial_port_name_ << " properly!" << std::endl;
-        } else {
-            std::cout << "GPS: Serial at " << serial_port_name_ << " port closed." << std::endl;
-        }
-        sp_free_port(piksi_port);
-        piksi_port = nullptr;
+    if (imu_pub_ && imu_ring_.size() > 0) {
+        publish_imu();
+    }
+    if (publisher_) {
+        publisher_->stop();
+    }
+    if (prediction_publisher_) {
+        prediction_publisher_->stop();
+    }
+    if (corrections_) {
+        corrections_->stop();
+    }
+    if (transport_) {
+        transport_->close();
+    }
+    if (logger_) {
+        logger_->stop();
+    }
+    if (capture_) {
+        capture_->stop();
     }
 }
 
+// Every byte from the receiver comes through here, the settings exchange's
+// included, so the raw capture has no gaps.
 s32 PiksiMultiGPS::piksi_port_read(u8 *buff, u32 n, void *context) {
-    (void)context;
-    s32 result;
-    result = sp_blocking_read(piksi_port, buff, n, 0);
-    if (result < 0) {
-        return SBP_READ_ERROR;
+    PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    // s_ is WAITING for a preamble (s0_ reads through here too until the first heartbeat)
+    bool hunting = gps->flag_start_ && gps->s_.state == 0;
+    s32 ret = gps->transport_->read(buff, n);
+    if (ret > 0 && gps->capture_) {
+        gps->capture_->append(buff, static_cast<size_t>(ret), gps->transport_->rx_time());
     }
-    return static_cast<s32>(result);
+    if (hunting && ret > 0) {
+        if (buff[0] == SBP_PREAMBLE) {
+            gps->frame_rx_ = gps->transport_->rx_time();
+        } else {
+            gps->metrics_.count_framing(static_cast<u32>(ret));
+        }
+    }
+    return ret;
 }
 
 s32 PiksiMultiGPS::piksi_port_write(u8 *buff, u32 n, void *context) {
-    (void)context;
-    s32 result = sp_blocking_write(piksi_port, buff, n, 1000);
-    if (result < 0) {
-        return SBP_WRITE_ERROR;
+    PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    return gps->transport_->write(buff, n);
+}
+
+void PiksiMultiGPS::settings_write_resp_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
+    (void)sender_id;
+    PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    if (gps->settings_session_) {
+        gps->settings_session_->on_write_resp(len, msg);
+    }
+}
+
+void PiksiMultiGPS::settings_read_resp_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
+    (void)sender_id;
+    PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    if (gps->settings_session_) {
+        gps->settings_session_->on_read_resp(len, msg);
+    }
+}
+
+// Opens the epoch a message belongs to, emitting the previous one if it is
+// still incomplete. False if the message is too late to be included.
+bool PiksiMultiGPS::begin_part(u32 tow, u8 part) {
+    switch (assembler_.classify(tow, part)) {
+    case EpochAssembler::kLate:
+        return false;
+    case EpochAssembler::kNewer:
+        if (assembler_.is_open()) {
+            emit_epoch();
+        }
+        assembler_.open_epoch(tow, EpochAssembler::Clock::now());
+        epoch_rx_ = frame_rx_;
+        return true;
+    case EpochAssembler::kCurrent:
+        break;
+    }
+    return true;
+}
+
+void PiksiMultiGPS::end_part(u8 part) {
+    if (assembler_.add(part)) {
+        emit_epoch();
+    }
+}
+
+// Zeroes the fields of the parts that did not arrive for this epoch, so a
+// record never carries an older epoch's values; epoch_parts says which are set.
+static void clear_missing_parts(PiksiData& data) {
+    u8 missing = static_cast<u8>(~data.epoch_parts);
+    if (missing & kPartUtc) {
+        data.hr = data.min = data.sec = 0;
+        data.ms = 0.0;
+        data.utc = 0.0f;
+        data.utc_timestamp = -1.0; // derived from GPS_TIME below when it matches
+    }
+    if (missing & kPartLlh) {
+        data.lat = data.lon = data.h = 0.0;
+        data.S_llh_h = data.S_llh_v = 0.0f;
+        data.sats = 0;
+    }
+    if (missing & kPartEcef) {
+        data.ecef_x = data.ecef_y = data.ecef_z = 0.0;
+        data.S_ecef = 0.0f;
+    }
+    if (missing & kPartVel) {
+        data.v_n = data.v_e = data.v_d = 0.0;
+        data.S_rtk_v_h = data.S_rtk_v_v = 0.0f;
+    }
+    if (missing & kPartBaseline) {
+        data.n = data.e = data.d = 0.0;
+        data.S_rtk_x_h = data.S_rtk_x_v = 0.0f;
+    }
+}
+
+void PiksiMultiGPS::emit_epoch() {
+    data_.tow = assembler_.tow();
+    data_.epoch_parts = assembler_.parts();
+    data_.host_mono_ns = epoch_rx_.mono_ns;
+    data_.host_real_ns = epoch_rx_.real_ns;
+    assembler_.close_epoch();
+    clear_missing_parts(data_);
+
+    if (gps_time_valid_ && gps_time_.tow == data_.tow) {
+        data_.gps_week = gps_time_.wn;
+        if (!utc_valid_ || utc_tow_ != data_.tow) { // no UTC_TIME this epoch: derive it
+            data_.utc_timestamp = gps_to_unix(gps_time_.wn, gps_time_.tow, gps_time_.ns_residual);
+        }
+    }
+
+    if (local_origin_ && (data_.epoch_parts & (kPartLlh | kPartEcef))) {
+        double ecef[3] = {data_.ecef_x, data_.ecef_y, data_.ecef_z};
+        if (data_.epoch_parts & kPartLlh) {
+            llh_to_ecef(data_.lat, data_.lon, data_.h, ecef);
+        }
+        double enu[3];
+        local_origin_->ecef_to_enu(ecef, enu);
+        data_.local_e = enu[0];
+        data_.local_n = enu[1];
+        data_.local_u = enu[2];
+    } else {
+        data_.local_e = data_.local_n = data_.local_u = 0.0;
+    }
+
+    s64 now = clock_ns(CLOCK_MONOTONIC);
+    if (epoch_rx_.mono_ns > 0) {
+        metrics_.record(Stage::kAssemble, now - epoch_rx_.mono_ns);
     }
-    return static_cast<s32>(result);
+
+    // Frequency over the last emit_times_.size() epochs rather than a single interval
+    s64 oldest = emit_times_[emit_count_ >= emit_times_.size() ? emit_count_ % emit_times_.size() : 0];
+    emit_times_[emit_count_ % emit_times_.size()] = now;
+    emit_count_++;
+    size_t intervals = std::min(emit_count_, emit_times_.size()) - 1;
+    if (intervals > 0 && now > oldest) {
+        data_.frequency = intervals * 1e9 / static_cast<double>(now - oldest);
+    }
+
+    publish();
+}
+
+// Hands a completed solution to local consumers, the publisher thread and the logger.
+void PiksiMultiGPS::publish() {
+    snapshot_.store(data_);
+    has_new_data_ = true;
+    if (logger_) {
+        logger_->push(data_);
+    }
+    if (history_) {
+        history_->push(data_);
+    }
+    if (predictor_) {
+        predictor_->update(data_);
+    }
+    for (const SolutionCallback& callback : solution_callbacks_) {
+        callback(data_);
+    }
+}
+
+// Sends up to imu_batch_ queued samples as one payload.
+void PiksiMultiGPS::publish_imu() {
+    u8* buffer = imu_pool_->acquire();
+    std::vector<uint8_t> copy;
+    if (!buffer) {
+        copy.resize(kImuBatchMaxSize); // every pooled buffer is still held by Zenoh
+        buffer = copy.data();
+    }
+    u8 count = 0;
+    size_t len = kImuHeaderSize;
+    ImuSample sample;
+    while (count < imu_batch_ && imu_ring_.pop(sample)) {
+        len += encode_imu_sample(sample, buffer + len);
+        count++;
+    }
+    encode_imu_header(count, imu_seq_++, imu_info_, buffer);
+    imu_oldest_ns_ = clock_ns(CLOCK_MONOTONIC);
+
+    if (!copy.empty()) {
+        copy.resize(len);
+        imu_pub_->put(Bytes(std::move(copy)));
+        return;
+    }
+    imu_pub_->put(Bytes(buffer, len, [pool = imu_pool_](uint8_t* ptr) { pool->release(ptr); }));
+}
+
+void PiksiMultiGPS::publish_stats() {
+    next_stats_ns_ = clock_ns(CLOCK_MONOTONIC) + static_cast<s64>(stats_period_ms_) * 1000000;
+    CorrectionStats corrections = get_correction_stats();
+    stats_pub_->put(metrics_.report(name_, assembler_.stats(), transport_->stats(), get_logger_stats(),
+                                     link_.stats(), corrections_ ? &corrections : nullptr));
 }
 
 void PiksiMultiGPS::heartbeat_callback_0(u16 sender_id, u8 len, u8 msg[], void *context) {
-    (void)sender_id, (void)len, (void)msg, (void)context;
+    (void)sender_id, (void)len, (void)msg;
+    PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
     std::cout << "GPS: first heartbeat detected" << std::endl;
-    flag_start_ = true;
+    gps->flag_start_ = true;
+    gps->heartbeat_seen_ = true;
+    s64 now = clock_ns(CLOCK_MONOTONIC); // frame_rx_ is only tracked once decoding starts
+    gps->link_.heartbeat(now);
+    gps->link_.frame(now);
 }
 
 void PiksiMultiGPS::heartbeat_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
-    (void)sender_id, (void)len, (void)msg, (void)context;
+    (void)sender_id, (void)len, (void)msg;
+    PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    gps->heartbeat_seen_ = true;
+    gps->link_.heartbeat(gps->frame_rx_.mono_ns);
 }
 
 void PiksiMultiGPS::baseline_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
     (void)sender_id, (void)len, (void)context;
     msg_baseline_ned_t baseline = *(msg_baseline_ned_t *)msg;
     PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    if (!gps->begin_part(baseline.tow, kPartBaseline)) {
+        return;
+    }
     gps->data_.n = static_cast<float>(baseline.n) / 1.0e3;
     gps->data_.e = static_cast<float>(baseline.e) / 1.0e3;
     gps->data_.d = static_cast<float>(baseline.d) / 1.0e3;
 
     if (baseline.flags == 0) {
         gps->data_.rtk_solution = false;
+        gps->end_part(kPartBaseline);
         return;
     }
 
@@ -277,12 +1031,16 @@ void PiksiMultiGPS::baseline_callback(u16 sender_id, u8 len, u8 msg[], void *con
     gps->data_.status = static_cast<int>(baseline.flags);
     gps->data_.S_rtk_x_h = static_cast<float>(baseline.h_accuracy) / 1.0e3;
     gps->data_.S_rtk_x_v = static_cast<float>(baseline.v_accuracy) / 1.0e3;
+    gps->end_part(kPartBaseline);
 }
 
 void PiksiMultiGPS::pos_llh_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
     (void)sender_id, (void)len, (void)context;
     msg_pos_llh_t pos_llh = *(msg_pos_llh_t *)msg;
     PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    if (!gps->begin_part(pos_llh.tow, kPartLlh)) {
+        return;
+    }
     gps->data_.lat = pos_llh.lat;
     gps->data_.lon = pos_llh.lon;
     gps->data_.h = pos_llh.height;
@@ -297,85 +1055,49 @@ void PiksiMultiGPS::pos_llh_callback(u16 sender_id, u8 len, u8 msg[], void *cont
         gps->data_.status = static_cast<int>(pos_llh.flags);
     }
 
-    // Calculate frequency based on pos_llh updates (main position message)
-    auto now = std::chrono::high_resolution_clock::now();
-    if (gps->last_update_.time_since_epoch().count() != 0) {
-        std::chrono::duration<double> diff = now - gps->last_update_;
-        double dt = diff.count();
-        if (dt > 0.0) {
-            gps->data_.frequency = 1.0 / dt;
-        }
-    }
-    gps->last_update_ = now;
-    
-    // Set the flag to indicate new data is available
-    gps->has_new_data_ = true;
-
-    // Publish data via Zenoh as JSON
-    std::ostringstream json;
-    json << std::setprecision(15) << std::boolalpha;
-    json << "{"
-         << "\"utc_timestamp\":" << gps->data_.utc_timestamp << ","
-         << "\"utc\":" << gps->data_.utc << ","
-         << "\"hr\":" << static_cast<int>(gps->data_.hr) << ","
-         << "\"min\":" << static_cast<int>(gps->data_.min) << ","
-         << "\"sec\":" << static_cast<int>(gps->data_.sec) << ","
-         << "\"ms\":" << gps->data_.ms << ","
-         << "\"frequency\":" << gps->data_.frequency << ","
-         << "\"rtk_solution\":" << gps->data_.rtk_solution << ","
-         << "\"status\":" << gps->data_.status << ","
-         << "\"lat\":" << gps->data_.lat << ","
-         << "\"lon\":" << gps->data_.lon << ","
-         << "\"h\":" << gps->data_.h << ","
-         << "\"S_llh_h\":" << gps->data_.S_llh_h << ","
-         << "\"S_llh_v\":" << gps->data_.S_llh_v << ","
-         << "\"ecef_x\":" << gps->data_.ecef_x << ","
-         << "\"ecef_y\":" << gps->data_.ecef_y << ","
-         << "\"ecef_z\":" << gps->data_.ecef_z << ","
-         << "\"S_ecef\":" << gps->data_.S_ecef << ","
-         << "\"n\":" << gps->data_.n << ","
-         << "\"e\":" << gps->data_.e << ","
-         << "\"d\":" << gps->data_.d << ","
-         << "\"S_rtk_x_h\":" << gps->data_.S_rtk_x_h << ","
-         << "\"S_rtk_x_v\":" << gps->data_.S_rtk_x_v << ","
-         << "\"v_n\":" << gps->data_.v_n << ","
-         << "\"v_e\":" << gps->data_.v_e << ","
-         << "\"v_d\":" << gps->data_.v_d << ","
-         << "\"S_rtk_v_h\":" << gps->data_.S_rtk_v_h << ","
-         << "\"S_rtk_v_v\":" << gps->data_.S_rtk_v_v << ","
-         << "\"sats\":" << gps->data_.sats
-         << "}";
-    gps->pub_->put(json.str());
+    gps->end_part(kPartLlh);
 }
 
 void PiksiMultiGPS::pos_ecef_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
     (void)sender_id, (void)len, (void)context;
     msg_pos_ecef_t pos_ecef = *(msg_pos_ecef_t *)msg;
     PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    if (!gps->begin_part(pos_ecef.tow, kPartEcef)) {
+        return;
+    }
     gps->data_.ecef_x = pos_ecef.x;
     gps->data_.ecef_y = pos_ecef.y;
     gps->data_.ecef_z = pos_ecef.z;
     gps->data_.S_ecef = static_cast<float>(pos_ecef.accuracy) / 1.0e3;
+    gps->end_part(kPartEcef);
 }
 
 void PiksiMultiGPS::vel_ned_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
     (void)sender_id, (void)len, (void)context;
     msg_vel_ned_t vel_ned = *(msg_vel_ned_t *)msg;
     PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    if (!gps->begin_part(vel_ned.tow, kPartVel)) {
+        return;
+    }
     gps->data_.v_n = static_cast<float>(vel_ned.n) / 1.0e3;
     gps->data_.v_e = static_cast<float>(vel_ned.e) / 1.0e3;
     gps->data_.v_d = static_cast<float>(vel_ned.d) / 1.0e3;
     gps->data_.S_rtk_v_h = static_cast<float>(vel_ned.h_accuracy) / 1.0e3;
     gps->data_.S_rtk_v_v = static_cast<float>(vel_ned.v_accuracy) / 1.0e3;
+    gps->end_part(kPartVel);
 }
 
 void PiksiMultiGPS::gps_time_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
     (void)sender_id, (void)len, (void)context;
     msg_utc_time_t gps_time = *(msg_utc_time_t *)msg;
     PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    if (!gps->begin_part(gps_time.tow, kPartUtc)) {
+        return;
+    }
 
     if ((gps_time.flags & 0x08) == 0) { // UTC invalid
-        return; // Don't update if invalid
+        gps->end_part(kPartUtc); // Don't update if invalid
+        return;
     }
 
     gps->data_.hr = gps_time.hours;
@@ -385,23 +1107,66 @@ void PiksiMultiGPS::gps_time_callback(u16 sender_id, u8 len, u8 msg[], void *con
     gps->data_.utc = gps->data_.hr + gps->data_.min / 60.0 + (gps->data_.sec + gps->data_.ms / 1000.0) / 3600.0;
 
     // Calculate UNIX timestamp from UTC for latency
-    setenv("TZ", "UTC", 1);
-    tzset();
-
-    std::tm time_in = {};
-    time_in.tm_year = gps_time.year - 1900;
-    time_in.tm_mon = gps_time.month - 1;
-    time_in.tm_mday = gps_time.day;
-    time_in.tm_hour = gps_time.hours;
-    time_in.tm_min = gps_time.minutes;
-    time_in.tm_sec = gps_time.seconds;
-    time_in.tm_isdst = -1;
-    time_t utc_t = mktime(&time_in);
-    if (utc_t != -1) {
-        gps->data_.utc_timestamp = static_cast<double>(utc_t) + gps_time.ns / 1e9;
-    } else {
-        gps->data_.utc_timestamp = -1.0;
+    gps->data_.utc_timestamp = static_cast<double>(unix_seconds(gps_time.year, gps_time.month, gps_time.day,
+                                                                 gps_time.hours, gps_time.minutes, gps_time.seconds)) +
+                               gps_time.ns / 1e9;
+    gps->utc_tow_ = gps_time.tow;
+    gps->utc_valid_ = true;
+    gps->end_part(kPartUtc);
+}
+
+void PiksiMultiGPS::imu_raw_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
+    (void)sender_id, (void)len;
+    PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    msg_imu_raw_t raw;
+    memcpy(&raw, msg, sizeof(raw));
+    ImuSample sample = scale_imu_raw(raw, gps->imu_info_, gps->frame_rx_);
+    gps->imu_snapshot_.store(sample);
+    for (const ImuCallback& callback : gps->imu_callbacks_) {
+        callback(sample);
+    }
+    if (!gps->imu_pub_) {
+        return;
+    }
+    if (gps->imu_ring_.size() == 0) {
+        gps->imu_oldest_ns_ = sample.host_mono_ns;
+    }
+    if (!gps->imu_ring_.push(sample)) {
+        gps->metrics_.count_imu_dropped();
+    }
+    if (gps->imu_ring_.size() >= static_cast<size_t>(gps->imu_batch_)) {
+        gps->publish_imu();
+    }
+}
+
+void PiksiMultiGPS::imu_aux_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
+    (void)sender_id, (void)len;
+    PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    msg_imu_aux_t aux;
+    memcpy(&aux, msg, sizeof(aux));
+    apply_imu_aux(aux, &gps->imu_info_);
+}
+
+void PiksiMultiGPS::age_corrections_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
+    (void)sender_id, (void)len;
+    PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    msg_age_corrections_t age;
+    memcpy(&age, msg, sizeof(age));
+    gps->corrections_->set_receiver_age(age.age);
+}
+
+// MSG_GPS_TIME precedes the solution messages of its epoch; it is kept aside
+// and merged when that epoch is emitted.
+void PiksiMultiGPS::gps_week_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
+    (void)sender_id, (void)len;
+    PiksiMultiGPS* gps = static_cast<PiksiMultiGPS*>(context);
+    msg_gps_time_t gps_time;
+    memcpy(&gps_time, msg, sizeof(gps_time));
+    if ((gps_time.flags & 0x07) == 0) { // no time solution yet
+        return;
     }
+    gps->gps_time_ = gps_time;
+    gps->gps_time_valid_ = true;
 }
 
 } // namespace piksi
\ No newline at end of file
@@ -0,0 +1,406 @@
+// Reads columnar logs (log_format=columnar) without scanning them: the block
+// index narrows a time range to the blocks that overlap it, and only the
+// requested columns of those blocks are touched.
+//
+// Usage: piksi_query FILE.pcol [--info] [--from T] [--to T] [--columns a,b,...] [--stats]
+//                    [--origin LAT,LON,H] [--out FILE]
+//
+// T is Unix seconds, or +S for S seconds after the first record. Without
+// --info or --stats the selected rows are written as CSV (all columns: the
+// same layout as the CSV log; otherwise the named columns in the given order).
+// --origin recomputes local_e/n/u about another reference point, a block at a
+// time through the batch geodesy kernels; logs older than those columns get
+// them too.
+#include "columnar.hpp"
+#include "epoch_assembler.hpp"
+#include "geodesy.hpp"
+#include "piksi_format.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace piksi;
+
+namespace {
+
+struct Options {
+    std::string path;
+    std::string out;
+    std::string from, to;
+    std::vector<std::string> columns;
+    std::string origin;
+    bool info = false;
+    bool stats = false;
+};
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0
+              << " FILE.pcol [--info] [--from T] [--to T] [--columns a,b,...] [--stats]\n"
+              << "       [--origin LAT,LON,H] [--out FILE]\n"
+              << "  T: Unix seconds, or +S for S seconds after the first record\n"
+              << "  LAT,LON,H: degrees and metres; local_e/n/u are recomputed about this point" << std::endl;
+}
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> out;
+    std::istringstream is(list);
+    std::string item;
+    while (std::getline(is, item, ',')) {
+        if (!item.empty()) {
+            out.push_back(item);
+        }
+    }
+    return out;
+}
+
+bool parse_time(const std::string& text, double start, double fallback, double* t) {
+    if (text.empty()) {
+        *t = fallback;
+        return true;
+    }
+    try {
+        *t = (text[0] == '+') ? start + std::stod(text.substr(1)) : std::stod(text);
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// Row times follow record_time(), read from the two columns it depends on.
+class RowTime {
+public:
+    explicit RowTime(const ColumnarReader& reader)
+        : reader_(reader), utc_(reader.find_column("utc_timestamp")), real_(reader.find_column("host_real_ns")) {}
+
+    double operator()(size_t block, u32 row) const {
+        double utc = utc_ >= 0 ? reader_.value(block, utc_, row) : -1.0;
+        if (utc >= 0.0 || real_ < 0) {
+            return utc;
+        }
+        return reader_.value_s64(block, real_, row) * 1e-9;
+    }
+
+private:
+    const ColumnarReader& reader_;
+    int utc_;
+    int real_;
+};
+
+const char* const kLocalNames[3] = {"local_e", "local_n", "local_u"};
+
+// local_e/n/u about the --origin point. A block's lat, lon and h columns are
+// converted whole, LLH -> ECEF -> ENU, into arrays indexed by row. As in the
+// live path, a row without LLH uses its ECEF position, and a row with neither
+// (per epoch_parts, where the file has it) is 0.
+class LocalColumns {
+public:
+    LocalColumns(const ColumnarReader& reader, const LocalFrame& frame)
+        : reader_(reader), frame_(frame),
+          llh_{reader.find_column("lat"), reader.find_column("lon"), reader.find_column("h")},
+          ecef_{reader.find_column("ecef_x"), reader.find_column("ecef_y"), reader.find_column("ecef_z")},
+          parts_(reader.find_column("epoch_parts")) {}
+
+    bool available() const { return llh_[0] >= 0 && llh_[1] >= 0 && llh_[2] >= 0; }
+
+    double operator()(size_t block, int axis, u32 row) {
+        if (block != block_) {
+            convert(block);
+        }
+        return enu_[axis][row];
+    }
+
+private:
+    const ColumnarReader& reader_;
+    LocalFrame frame_;
+    int llh_[3];
+    int ecef_[3];
+    int parts_;
+    size_t block_ = static_cast<size_t>(-1);
+    std::vector<double> copy_[3]; // lat/lon/h widened, where not stored as f64
+    std::vector<double> enu_[3];
+    std::vector<u8> none_; // rows with neither position
+
+    void convert(size_t block) {
+        u32 rows = reader_.blocks()[block].rows;
+        const double* llh[3];
+        for (int k = 0; k < 3; ++k) {
+            llh[k] = reader_.column_f64(block, llh_[k]);
+            if (!llh[k]) {
+                copy_[k].resize(rows);
+                for (u32 row = 0; row < rows; ++row) {
+                    copy_[k][row] = reader_.value(block, llh_[k], row);
+                }
+                llh[k] = copy_[k].data();
+            }
+            enu_[k].resize(rows);
+        }
+        llh_to_ecef(llh[0], llh[1], llh[2], rows, enu_[0].data(), enu_[1].data(), enu_[2].data());
+        bool has_ecef = ecef_[0] >= 0 && ecef_[1] >= 0 && ecef_[2] >= 0;
+        none_.assign(rows, 0);
+        for (u32 row = 0; parts_ >= 0 && row < rows; ++row) {
+            u8 parts = static_cast<u8>(reader_.value(block, parts_, row));
+            if (parts & kPartLlh) {
+                continue;
+            }
+            if ((parts & kPartEcef) && has_ecef) {
+                for (int k = 0; k < 3; ++k) {
+                    enu_[k][row] = reader_.value(block, ecef_[k], row);
+                }
+            } else {
+                none_[row] = 1;
+            }
+        }
+        frame_.ecef_to_enu(enu_[0].data(), enu_[1].data(), enu_[2].data(), rows, enu_[0].data(), enu_[1].data(),
+                           enu_[2].data());
+        for (u32 row = 0; row < rows; ++row) {
+            if (none_[row]) {
+                enu_[0][row] = enu_[1][row] = enu_[2][row] = 0.0;
+            }
+        }
+        block_ = block;
+    }
+};
+
+struct ColumnStats {
+    u64 count = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double mean = 0.0;
+    double m2 = 0.0; // Welford's running sum of squared deviations
+
+    void add(double x) {
+        count++;
+        min = std::min(min, x);
+        max = std::max(max, x);
+        double delta = x - mean;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }
+};
+
+void print_info(const ColumnarReader& reader, const std::string& path) {
+    const auto& blocks = reader.blocks();
+    std::cout << std::setprecision(15);
+    std::cout << path << ": " << reader.rows() << " rows in " << blocks.size() << " blocks" << std::endl;
+    if (!blocks.empty()) {
+        std::cout << "time: " << reader.t_min() << " .. " << reader.t_max() << " ("
+                  << reader.t_max() - reader.t_min() << " s)" << std::endl;
+        if (!reader.time_ordered()) {
+            std::cout << "blocks not in time order (host clock corrected during the log); ranges are scanned"
+                      << std::endl;
+        }
+    }
+    if (reader.trailing_bytes() > 0) {
+        std::cout << "incomplete last block: " << reader.trailing_bytes() << " bytes ignored" << std::endl;
+    }
+    std::cout << "columns:";
+    for (size_t i = 0; i < reader.column_count(); ++i) {
+        std::cout << " " << reader.column_name(i);
+    }
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--info") {
+            options.info = true;
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (arg == "--from" && i + 1 < argc) {
+            options.from = argv[++i];
+        } else if (arg == "--to" && i + 1 < argc) {
+            options.to = argv[++i];
+        } else if (arg == "--columns" && i + 1 < argc) {
+            options.columns = split(argv[++i]);
+        } else if (arg == "--origin" && i + 1 < argc) {
+            options.origin = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            options.out = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-' && options.path.empty()) {
+            options.path = arg;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.path.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    ColumnarReader reader;
+    if (!reader.open(options.path)) {
+        return 1;
+    }
+    if (options.info) {
+        print_info(reader, options.path);
+        return 0;
+    }
+
+    std::optional<LocalColumns> local;
+    if (!options.origin.empty()) {
+        double lat = 0.0, lon = 0.0, h = 0.0;
+        char extra = 0;
+        if (std::sscanf(options.origin.c_str(), "%lf , %lf , %lf %c", &lat, &lon, &h, &extra) != 3 ||
+            std::fabs(lat) > 90.0 || std::fabs(lon) > 180.0) {
+            usage(argv[0]);
+            return 1;
+        }
+        local.emplace(reader, LocalFrame::at(lat, lon, h));
+        if (!local->available()) {
+            std::cerr << "Query: --origin needs the lat, lon and h columns." << std::endl;
+            return 1;
+        }
+    }
+
+    // Selected columns by name; with --origin, local_e/n/u come from `local`
+    // (local_axis 0..2) whether or not the file has them.
+    std::vector<std::string> names = options.columns;
+    if (options.stats && names.empty()) {
+        for (size_t i = 0; i < reader.column_count(); ++i) {
+            names.push_back(reader.column_name(i));
+        }
+        for (const char* name : kLocalNames) {
+            if (local && reader.find_column(name) < 0) {
+                names.push_back(name);
+            }
+        }
+    }
+    std::vector<int> columns, local_axis;
+    for (const std::string& name : names) {
+        int axis = -1;
+        for (int k = 0; k < 3 && local; ++k) {
+            if (name == kLocalNames[k]) {
+                axis = k;
+            }
+        }
+        int column = reader.find_column(name);
+        if (column < 0 && axis < 0) {
+            std::cerr << "Query: No column '" << name << "' in " << options.path << "." << std::endl;
+            return 1;
+        }
+        columns.push_back(column);
+        local_axis.push_back(axis);
+    }
+    auto cell = [&](size_t block, size_t c, u32 row) {
+        return local_axis[c] >= 0 ? (*local)(block, local_axis[c], row) : reader.value(block, columns[c], row);
+    };
+
+    const auto& blocks = reader.blocks();
+    double start = reader.t_min();
+    double t_from, t_to;
+    if (!parse_time(options.from, start, -std::numeric_limits<double>::infinity(), &t_from) ||
+        !parse_time(options.to, start, std::numeric_limits<double>::infinity(), &t_to)) {
+        usage(argv[0]);
+        return 1;
+    }
+    size_t first, last;
+    reader.blocks_in_range(t_from, t_to, &first, &last);
+    RowTime row_time(reader);
+
+    if (options.stats) {
+        std::vector<ColumnStats> stats(columns.size());
+        for (size_t b = first; b < last; ++b) {
+            bool whole = blocks[b].t_min >= t_from && blocks[b].t_max <= t_to;
+            for (u32 row = 0; row < blocks[b].rows; ++row) {
+                if (!whole) {
+                    double t = row_time(b, row);
+                    if (t < t_from || t > t_to) {
+                        continue;
+                    }
+                }
+                for (size_t c = 0; c < columns.size(); ++c) {
+                    stats[c].add(cell(b, c, row));
+                }
+            }
+        }
+        std::cout << std::left << std::setw(16) << "column" << std::right << std::setw(10) << "count"
+                  << std::setw(22) << "min" << std::setw(22) << "max" << std::setw(22) << "mean"
+                  << std::setw(16) << "std" << std::endl;
+        std::cout << std::setprecision(12);
+        for (size_t c = 0; c < columns.size(); ++c) {
+            const ColumnStats& s = stats[c];
+            double std_dev = s.count > 1 ? std::sqrt(s.m2 / (s.count - 1)) : 0.0;
+            std::cout << std::left << std::setw(16) << names[c] << std::right
+                      << std::setw(10) << s.count;
+            if (s.count > 0) {
+                std::cout << std::setw(22) << s.min << std::setw(22) << s.max << std::setw(22) << s.mean
+                          << std::setw(16) << std::setprecision(6) << std_dev << std::setprecision(12);
+            }
+            std::cout << std::endl;
+        }
+        return 0;
+    }
+
+    FILE* out = options.out.empty() ? stdout : std::fopen(options.out.c_str(), "w");
+    if (!out) {
+        std::cerr << "Query: Cannot write " << options.out << "." << std::endl;
+        return 1;
+    }
+    std::string buffer;
+    u64 rows = 0;
+    if (columns.empty()) {
+        append_csv_header(buffer);
+    } else {
+        for (size_t c = 0; c < columns.size(); ++c) {
+            buffer += (c ? "," : "") + names[c];
+        }
+        buffer += '\n';
+    }
+    char number[32];
+    PiksiData data;
+    for (size_t b = first; b < last; ++b) {
+        for (u32 row = 0; row < blocks[b].rows; ++row) {
+            double t = row_time(b, row);
+            if (t < t_from || t > t_to) {
+                continue;
+            }
+            if (columns.empty()) {
+                reader.read_row(b, row, &data);
+                if (local) {
+                    data.local_e = (*local)(b, 0, row);
+                    data.local_n = (*local)(b, 1, row);
+                    data.local_u = (*local)(b, 2, row);
+                }
+                append_csv_row(buffer, data);
+            } else {
+                for (size_t c = 0; c < columns.size(); ++c) {
+                    ColumnType type = local_axis[c] >= 0 ? ColumnType::kF64 : reader.column_type(columns[c]);
+                    if (type == ColumnType::kF64 || type == ColumnType::kF32) {
+                        snprintf(number, sizeof(number), "%.15g", cell(b, c, row));
+                    } else {
+                        snprintf(number, sizeof(number), "%lld",
+                                 static_cast<long long>(reader.value_s64(b, columns[c], row)));
+                    }
+                    if (c) {
+                        buffer += ',';
+                    }
+                    buffer += number;
+                }
+                buffer += '\n';
+            }
+            rows++;
+            if (buffer.size() >= (1 << 20)) {
+                std::fwrite(buffer.data(), 1, buffer.size(), out);
+                buffer.clear();
+            }
+        }
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), out);
+    if (out != stdout) {
+        std::fclose(out);
+        std::cerr << "Query: Wrote " << rows << " rows to " << options.out << "." << std::endl;
+    }
+    return 0;
+}
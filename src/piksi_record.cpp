@@ -0,0 +1,206 @@
+// Ground-station recorder: subscribes to published solutions and writes them
+// to one session file through the background logger.
+//
+// Usage: piksi_record [key ...] [--format csv|binary|columnar] [--dir DIR] [--fsync none|batch|periodic]
+//                     [--report-s N]
+//
+// Keys default to fdcl/piksi. JSON and binary payloads are both accepted; the
+// seq field of each key's payloads is used to report skipped and repeated
+// solutions along with the receive rate. seq numbers the receiver's
+// solutions, so a key that is coalesced or rate-limited skips some by design:
+// a skip is not necessarily a loss. Topic slices (<key>/llh, /vel, /baseline,
+// /time) hold only part of a solution and are counted but not logged.
+#include "piksi_multi_gps.hpp"
+#include "piksi_format.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void handle_signal(int) {
+    g_stop = 1;
+}
+
+struct KeyStats {
+    u64 received = 0;
+    u64 undecoded = 0;  // payloads that are neither JSON nor binary solutions
+    u64 slices = 0;     // topic slices, not logged
+    u64 skipped = 0;    // seq numbers skipped: coalesced, decimated or lost
+    u64 gaps = 0;       // places where at least one was skipped
+    u64 repeated = 0;   // seq at or below the previous one (publisher restart, reordering)
+    u32 last_seq = 0;
+    bool has_seq = false;
+    u64 window_received = 0;
+};
+
+// Topic slices carry part of a solution: the binary "PT" layout, or JSON on a
+// key ending in a topic name. Logged as rows they would zero the other fields.
+bool is_slice(const std::string& key, const std::vector<uint8_t>& payload) {
+    if (payload.size() >= 2 && payload[0] == 'P' && payload[1] == 'T') {
+        return true;
+    }
+    std::string last = key.substr(key.rfind('/') + 1);
+    for (size_t i = 1; i < piksi::kTopicCount; ++i) {
+        if (last == piksi::topic_name(static_cast<piksi::Topic>(i))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+class Recorder {
+public:
+    explicit Recorder(const piksi::LoggerOptions& options) : logger_(options) {}
+
+    void start() { logger_.start(); }
+    void stop() { logger_.stop(); }
+
+    // Called from Zenoh's threads; one lock keeps the logger single-producer.
+    void receive(const std::string& key, const std::vector<uint8_t>& payload) {
+        piksi::PiksiData data = {};
+        u32 seq = 0;
+        bool slice = is_slice(key, payload);
+        bool ok = !slice && piksi::decode_solution(payload.data(), payload.size(), &data, &seq);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        KeyStats& stats = keys_[key];
+        stats.received++;
+        stats.window_received++;
+        if (slice) {
+            stats.slices++;
+            return;
+        }
+        if (!ok) {
+            stats.undecoded++;
+            return;
+        }
+        if (stats.has_seq) {
+            if (seq > stats.last_seq + 1) {
+                stats.gaps++;
+                stats.skipped += seq - stats.last_seq - 1;
+            } else if (seq <= stats.last_seq) {
+                stats.repeated++;
+            }
+        }
+        stats.last_seq = seq;
+        stats.has_seq = true;
+        logger_.push(data);
+    }
+
+    void report(double window_s, bool final) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        piksi::LoggerStats log = logger_.stats();
+        for (auto& entry : keys_) {
+            KeyStats& stats = entry.second;
+            std::cout << "Record: '" << entry.first << "'";
+            if (!final) {
+                std::cout << " rate=" << std::fixed << std::setprecision(1)
+                          << (window_s > 0.0 ? stats.window_received / window_s : 0.0) << "/s";
+            }
+            std::cout << " received=" << stats.received << " skipped=" << stats.skipped << " (" << stats.gaps
+                      << " gaps) repeated=" << stats.repeated << " undecoded=" << stats.undecoded;
+            if (stats.slices > 0) {
+                std::cout << " slices=" << stats.slices << " (not logged)";
+            }
+            std::cout << std::endl;
+            stats.window_received = 0;
+        }
+        std::cout << "Log: Records written=" << log.written << " dropped=" << log.dropped
+                  << " files=" << log.files << std::endl;
+    }
+
+private:
+    piksi::Logger logger_;
+    std::mutex mutex_;
+    std::map<std::string, KeyStats> keys_;
+};
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0
+              << " [key ...] [--format csv|binary|columnar] [--dir DIR] [--fsync none|batch|periodic] [--report-s N]"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> keys;
+    piksi::LoggerOptions options;
+    options.rotation.suffix = "_piksi_record";
+    options.rotation.fsync = piksi::FsyncPolicy::kPeriodic;
+    int report_s = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            if (!piksi::parse_log_format(argv[++i], &options.format)) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--dir" && i + 1 < argc) {
+            options.rotation.directory = argv[++i];
+        } else if (arg == "--fsync" && i + 1 < argc) {
+            if (!piksi::parse_fsync_policy(argv[++i], &options.rotation.fsync)) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--report-s" && i + 1 < argc) {
+            report_s = std::max(1, std::stoi(argv[++i]));
+        } else if (!arg.empty() && arg[0] != '-') {
+            keys.push_back(arg);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (keys.empty()) {
+        keys.push_back("fdcl/piksi");
+    }
+    options.rotation.suffix += piksi::log_extension(options.format);
+
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+
+    Recorder recorder(options);
+    recorder.start();
+
+    std::shared_ptr<zenoh::Session> session = piksi::PiksiMultiGPS::open_session();
+    std::vector<zenoh::Subscriber<void>> subscribers;
+    for (const std::string& key : keys) {
+        subscribers.push_back(session->declare_subscriber(
+            zenoh::KeyExpr(key),
+            [&recorder](const zenoh::Sample& sample) {
+                recorder.receive(std::string(sample.get_keyexpr().as_string_view()), sample.get_payload().as_vector());
+            },
+            zenoh::closures::none));
+        std::cout << "Zenoh: Subscribed to '" << key << "'." << std::endl;
+    }
+    std::cout << "Record: Writing to " << options.rotation.directory << ". Press Ctrl+C to stop." << std::endl;
+
+    auto last = std::chrono::steady_clock::now();
+    while (!g_stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto now = std::chrono::steady_clock::now();
+        double window = std::chrono::duration<double>(now - last).count();
+        if (window >= report_s) {
+            recorder.report(window, false);
+            last = now;
+        }
+    }
+
+    subscribers.clear(); // no more callbacks once the subscribers are gone
+    recorder.stop();
+    recorder.report(0.0, true);
+    return 0;
+}
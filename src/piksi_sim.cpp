@@ -0,0 +1,540 @@
+// Synthetic Piksi Multi on a pseudo-terminal, for load and soak tests of the
+// unmodified serial path: point port= in config.cfg at the device it prints
+// (or at the --link symlink) and run piksi_gps against it.
+//
+// Usage: piksi_sim [--link PATH] [--rate HZ] [--imu-rate HZ] [--crc-errors P] [--drops P]
+//                  [--burst N] [--tx-buffer BYTES] [--duration S] [--seed N] [--report-s N]
+//
+// --rate is solution epochs per second (seven messages each; at most 1000, the
+// resolution of tow) and --imu-rate IMU_RAW samples per second (0: no IMU).
+// A heartbeat, and IMU_AUX with the IMU on, go out every second. Times are
+// the host's clock as GPS time, so the latency piksi_gps reports is its own.
+//
+// Faults: --crc-errors and --drops are the fractions of frames sent with a
+// corrupted CRC or not sent at all; --burst N holds output back and writes N
+// epochs at a time, at the same average rate.
+//
+// SETTINGS_WRITE, SETTINGS_READ_REQ and SETTINGS_SAVE are answered as a
+// receiver would. Every write is accepted and read back; writing
+// solution.soln_freq also changes the epoch rate. Anything else the host
+// sends is taken for corrections: each epoch carries AGE_CORRECTIONS with the
+// time since the host last sent something.
+//
+// Output never waits for the reader: frames queue in a transmit buffer that
+// drains as fast as the reader empties the pty. A reader that falls behind by
+// more than --tx-buffer bytes (default 64 KiB, which a burst must fit in)
+// overruns it: the buffer and the input still queued on the pty are
+// discarded, so the reader resumes on live data, and the bytes count as
+// overrun. A reader that keeps up shows a small backlog and no overrun.
+#include "sbp_synth.hpp"
+#include "gps_time.hpp"
+#include <libsbp/legacy/api.h>
+#include <libsbp/legacy/compat.h>
+#include <libsbp/legacy/settings.h>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <poll.h>
+#include <random>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace piksi;
+
+namespace {
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void handle_signal(int) {
+    g_stop = 1;
+}
+
+const s64 kSecondNs = 1000000000LL;
+const double kMaxRate = 1000.0;
+
+struct Options {
+    std::string link;
+    double rate = 10.0;
+    double imu_rate = 0.0;
+    double crc_errors = 0.0;
+    double drops = 0.0;
+    int burst = 1;
+    size_t tx_buffer = 1 << 16;
+    double duration_s = 0.0; // 0: until interrupted
+    unsigned seed = 1;
+    int report_s = 1;
+};
+
+struct Counters {
+    u64 frames = 0;    // frames written, corrupted ones included
+    u64 bytes = 0;
+    u64 epochs = 0;
+    u64 corrupted = 0;
+    u64 dropped = 0;   // frames not sent (--drops)
+    u64 overrun = 0;   // bytes lost to a full transmit buffer
+    u64 writes = 0;    // SETTINGS_WRITE requests
+    u64 reads = 0;     // SETTINGS_READ_REQ requests
+    u64 saves = 0;
+    u64 input = 0;     // bytes from the host
+};
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0
+              << " [--link PATH] [--rate HZ] [--imu-rate HZ] [--crc-errors P] [--drops P]\n"
+              << "       [--burst N] [--tx-buffer BYTES] [--duration S] [--seed N] [--report-s N]" << std::endl;
+}
+
+// Splits a settings payload ("section\0name\0value\0...") into its fields.
+std::vector<std::string> split_fields(const u8* msg, u8 len) {
+    std::vector<std::string> fields;
+    const char* p = reinterpret_cast<const char*>(msg);
+    const char* end = p + len;
+    while (p < end) {
+        size_t n = strnlen(p, static_cast<size_t>(end - p));
+        fields.emplace_back(p, n);
+        p += n + 1;
+    }
+    return fields;
+}
+
+class Simulator {
+public:
+    Simulator(const Options& options, int master, int slave)
+        : options_(options), master_(master), slave_(slave), random_(options.seed) {
+        sbp_state_init(&rx_);
+        sbp_state_set_io_context(&rx_, this);
+        sbp_register_callback(&rx_, SBP_MSG_SETTINGS_WRITE, &write_callback, this, &write_node_);
+        sbp_register_callback(&rx_, SBP_MSG_SETTINGS_READ_REQ, &read_req_callback, this, &read_req_node_);
+        sbp_register_callback(&rx_, SBP_MSG_SETTINGS_SAVE, &save_callback, this, &save_node_);
+
+        settings_[key("solution", "soln_freq")] = format_rate(options_.rate);
+        settings_[key("uart0", "baudrate")] = "115200";
+        settings_[key("uart1", "baudrate")] = "115200";
+        settings_[key("imu", "imu_raw_output")] = options_.imu_rate > 0.0 ? "True" : "False";
+        held_.reserve(1 << 16);
+        out_.reserve(options_.tx_buffer);
+        frames_.reserve(1 << 12);
+    }
+
+    void run() {
+        s64 start = clock_ns(CLOCK_MONOTONIC);
+        // Host time as GPS time: mono + gps_offset_ is nanoseconds since the GPS epoch.
+        s64 unix_ns = clock_ns(CLOCK_REALTIME);
+        s64 gps_ns = unix_ns - kGpsEpochUnix * kSecondNs;
+        gps_ns += gps_utc_offset(gps_ns / kSecondNs) * kSecondNs;
+        gps_offset_ = gps_ns - start;
+
+        s64 end = options_.duration_s > 0.0 ? start + static_cast<s64>(options_.duration_s * 1e9) : 0;
+        next_heartbeat_ = start;
+        schedule_epochs(start);
+        next_imu_ = start;
+        s64 imu_period = options_.imu_rate > 0.0 ? static_cast<s64>(1e9 / options_.imu_rate) : 0;
+        next_report_ = start + options_.report_s * kSecondNs;
+        report_start_ = start;
+
+        while (!g_stop) {
+            s64 now = clock_ns(CLOCK_MONOTONIC);
+            if (end > 0 && now >= end) {
+                break;
+            }
+            // After a stall (suspended, debugger) resume on schedule instead of catching up.
+            if (now - next_epoch_ > kSecondNs) {
+                schedule_epochs(now);
+            }
+            if (imu_period > 0 && now - next_imu_ > kSecondNs) {
+                next_imu_ = now;
+            }
+
+            while (next_heartbeat_ <= now) {
+                synth_.heartbeat(frames_);
+                if (imu_period > 0) {
+                    synth_.imu_aux(frames_);
+                }
+                next_heartbeat_ += kSecondNs;
+            }
+            while (imu_period > 0 && next_imu_ <= now) {
+                s64 t = next_imu_ + gps_offset_;
+                synth_.imu_raw(frames_, tow_ms(t), static_cast<u8>((t % 1000000) * 256 / 1000000));
+                next_imu_ += imu_period;
+            }
+            while (next_epoch_ <= now) {
+                s64 t = next_epoch_ + gps_offset_;
+                synth_.epoch(frames_, static_cast<u16>(t / (kSecondsPerWeek * kSecondNs)), tow_ms(t));
+                s64 age_ds = last_input_ > 0 ? (next_epoch_ - last_input_) / 100000000 : 0xFFFF;
+                synth_.age_corrections(frames_, tow_ms(t), static_cast<u16>(std::min<s64>(age_ds, 0xFFFE)));
+                counters_.epochs++;
+                held_epochs_++;
+                next_epoch_ += epoch_period_;
+            }
+            inject_faults(held_);
+            if (held_epochs_ >= options_.burst || options_.burst <= 1) {
+                release();
+                held_epochs_ = 0;
+            }
+            write_out();
+            if (options_.report_s > 0 && now >= next_report_) {
+                report(now);
+                next_report_ += options_.report_s * kSecondNs;
+            }
+
+            s64 next = std::min(next_heartbeat_, next_epoch_);
+            if (imu_period > 0) {
+                next = std::min(next, next_imu_);
+            }
+            if (end > 0) {
+                next = std::min(next, end);
+            }
+            wait(next - clock_ns(CLOCK_MONOTONIC));
+        }
+        release();
+        write_out();
+        if (options_.report_s > 0) {
+            report(clock_ns(CLOCK_MONOTONIC));
+        }
+        print_totals(clock_ns(CLOCK_MONOTONIC) - start);
+    }
+
+private:
+    Options options_;
+    int master_;
+    int slave_; // held open so the pty survives the reader closing it
+    SbpSynth synth_;
+    sbp_state_t rx_;
+    sbp_msg_callbacks_node_t write_node_;
+    sbp_msg_callbacks_node_t read_req_node_;
+    sbp_msg_callbacks_node_t save_node_;
+    std::map<std::string, std::string> settings_; // "section\0name" -> value
+    std::mt19937 random_;
+    std::uniform_real_distribution<double> uniform_{0.0, 1.0};
+
+    std::vector<u8> frames_; // generated, before fault injection
+    std::vector<u8> held_;   // released every --burst epochs
+    std::vector<u8> out_;    // transmit buffer, written as the pty drains
+    int held_epochs_ = 0;
+    u8 rx_buffer_[512];
+    size_t rx_size_ = 0;
+    size_t rx_pos_ = 0;
+
+    s64 gps_offset_ = 0;
+    s64 epoch_period_ = 0;
+    s64 next_epoch_ = 0;
+    s64 next_imu_ = 0;
+    s64 next_heartbeat_ = 0;
+    s64 next_report_ = 0;
+    s64 last_input_ = 0; // when the host last sent anything
+    s64 report_start_ = 0;
+    Counters counters_;
+    Counters reported_;
+
+    static std::string key(const std::string& section, const std::string& name) {
+        return section + '\0' + name;
+    }
+
+    static std::string format_rate(double rate) {
+        char text[32];
+        snprintf(text, sizeof(text), "%g", rate);
+        return text;
+    }
+
+    static u32 tow_ms(s64 gps_ns) {
+        return static_cast<u32>((gps_ns / 1000000) % (kSecondsPerWeek * 1000));
+    }
+
+    // Epochs fall on whole multiples of the period in GPS time, as a receiver's do.
+    void schedule_epochs(s64 now) {
+        epoch_period_ = static_cast<s64>(1e9 / options_.rate);
+        s64 t = now + gps_offset_;
+        next_epoch_ = (t / epoch_period_ + 1) * epoch_period_ - gps_offset_;
+    }
+
+    void inject_faults(std::vector<u8>& out) {
+        size_t i = 0;
+        while (i + 6 <= frames_.size()) {
+            size_t size = 8 + frames_[i + 5];
+            if (options_.drops > 0.0 && uniform_(random_) < options_.drops) {
+                counters_.dropped++;
+            } else {
+                size_t at = out.size();
+                out.insert(out.end(), frames_.begin() + i, frames_.begin() + i + size);
+                if (options_.crc_errors > 0.0 && uniform_(random_) < options_.crc_errors) {
+                    out[at + size - 1] ^= 0x01;
+                    counters_.corrupted++;
+                }
+                counters_.frames++;
+            }
+            i += size;
+        }
+        frames_.clear();
+    }
+
+    void release() {
+        out_.insert(out_.end(), held_.begin(), held_.end());
+        held_.clear();
+        if (out_.size() <= options_.tx_buffer) {
+            return;
+        }
+        int queued = 0;
+        if (::ioctl(slave_, FIONREAD, &queued) == 0 && queued > 0) {
+            tcflush(slave_, TCIFLUSH);
+            counters_.overrun += static_cast<u64>(queued);
+        }
+        counters_.overrun += out_.size();
+        out_.clear();
+    }
+
+    void write_out() {
+        size_t pos = 0;
+        while (pos < out_.size()) {
+            ssize_t n = ::write(master_, out_.data() + pos, out_.size() - pos);
+            if (n > 0) {
+                pos += static_cast<size_t>(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                break; // the pty is full until the reader catches up
+            }
+        }
+        counters_.bytes += pos;
+        out_.erase(out_.begin(), out_.begin() + pos);
+    }
+
+    void wait(s64 timeout_ns) {
+        pollfd pfd = {master_, static_cast<short>(POLLIN | (out_.empty() ? 0 : POLLOUT)), 0};
+        timespec ts = {0, 0};
+        if (timeout_ns > 0) {
+            ts.tv_sec = timeout_ns / kSecondNs;
+            ts.tv_nsec = timeout_ns % kSecondNs;
+        }
+        if (ppoll(&pfd, 1, &ts, nullptr) <= 0) {
+            return;
+        }
+        if (pfd.revents & POLLIN) {
+            ssize_t n = ::read(master_, rx_buffer_, sizeof(rx_buffer_));
+            rx_size_ = n > 0 ? static_cast<size_t>(n) : 0;
+            if (n > 0) {
+                counters_.input += static_cast<u64>(n);
+                last_input_ = clock_ns(CLOCK_MONOTONIC);
+            }
+            rx_pos_ = 0;
+            while (rx_pos_ < rx_size_) {
+                sbp_process(&rx_, &rx_read);
+            }
+        }
+        write_out();
+    }
+
+    void respond(u16 msg_type, const std::string& payload) {
+        // Settings responses skip the burst hold.
+        synth_.message(frames_, msg_type, payload.data(), static_cast<u8>(payload.size()));
+        inject_faults(out_);
+    }
+
+    void report(s64 now) {
+        double dt = (now - report_start_) * 1e-9;
+        if (dt <= 0.0) {
+            return;
+        }
+        printf("Sim: %.0f msg/s  %.1f kB/s  %.1f epochs/s   crc errors %llu  dropped %llu  overrun %llu B  backlog %zu B   "
+                "input %.1f kB/s  settings write %llu read %llu save %llu\n",
+                (counters_.frames - reported_.frames) / dt, (counters_.bytes - reported_.bytes) / dt / 1e3,
+                (counters_.epochs - reported_.epochs) / dt,
+                static_cast<unsigned long long>(counters_.corrupted - reported_.corrupted),
+                static_cast<unsigned long long>(counters_.dropped - reported_.dropped),
+                static_cast<unsigned long long>(counters_.overrun - reported_.overrun), out_.size(),
+                (counters_.input - reported_.input) / dt / 1e3,
+                static_cast<unsigned long long>(counters_.writes), static_cast<unsigned long long>(counters_.reads),
+                static_cast<unsigned long long>(counters_.saves));
+        fflush(stdout);
+        reported_ = counters_;
+        report_start_ = now;
+    }
+
+    void print_totals(s64 elapsed_ns) {
+        std::cout << "Sim: Sent " << counters_.frames << " frames (" << counters_.bytes << " bytes, "
+                  << counters_.epochs << " epochs) in " << elapsed_ns * 1e-9 << " s; " << counters_.corrupted
+                  << " with a bad CRC, " << counters_.dropped << " dropped, " << counters_.overrun
+                  << " bytes overrun." << std::endl;
+    }
+
+    static s32 rx_read(u8 *buff, u32 n, void *context) {
+        Simulator* self = static_cast<Simulator*>(context);
+        size_t count = std::min<size_t>(n, self->rx_size_ - self->rx_pos_);
+        std::memcpy(buff, self->rx_buffer_ + self->rx_pos_, count);
+        self->rx_pos_ += count;
+        return static_cast<s32>(count);
+    }
+
+    static void write_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
+        (void)sender_id;
+        Simulator* self = static_cast<Simulator*>(context);
+        self->counters_.writes++;
+        std::vector<std::string> fields = split_fields(msg, len);
+        if (fields.size() < 3) {
+            return;
+        }
+        u8 status = 0; // accepted
+        if (fields[0] == "solution" && fields[1] == "soln_freq") {
+            char* end = nullptr;
+            double rate = std::strtod(fields[2].c_str(), &end);
+            if (*end != '\0' || !(rate > 0.0 && rate <= kMaxRate)) {
+                status = 1; // value rejected
+            } else {
+                self->options_.rate = rate;
+                self->schedule_epochs(clock_ns(CLOCK_MONOTONIC));
+                std::cout << "Sim: Solution rate set to " << rate << " Hz." << std::endl;
+            }
+        }
+        if (status == 0) {
+            self->settings_[key(fields[0], fields[1])] = fields[2];
+        }
+        std::string payload(1, static_cast<char>(status));
+        payload += fields[0] + '\0' + fields[1] + '\0' + fields[2] + '\0';
+        self->respond(SBP_MSG_SETTINGS_WRITE_RESP, payload);
+    }
+
+    static void read_req_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
+        (void)sender_id;
+        Simulator* self = static_cast<Simulator*>(context);
+        self->counters_.reads++;
+        std::vector<std::string> fields = split_fields(msg, len);
+        if (fields.size() < 2) {
+            return;
+        }
+        // An unknown setting is answered without a value.
+        std::string payload = fields[0] + '\0' + fields[1] + '\0';
+        auto it = self->settings_.find(key(fields[0], fields[1]));
+        if (it != self->settings_.end()) {
+            payload += it->second + '\0';
+        }
+        self->respond(SBP_MSG_SETTINGS_READ_RESP, payload);
+    }
+
+    static void save_callback(u16 sender_id, u8 len, u8 msg[], void *context) {
+        (void)sender_id;
+        (void)len;
+        (void)msg;
+        static_cast<Simulator*>(context)->counters_.saves++;
+    }
+};
+
+bool parse_double(const char* text, double* value) {
+    char* end = nullptr;
+    *value = std::strtod(text, &end);
+    return end != text && *end == '\0';
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        double value = 0.0;
+        bool has_value = i + 1 < argc;
+        if (arg == "--link" && has_value) {
+            options.link = argv[++i];
+        } else if (arg == "--rate" && has_value && parse_double(argv[++i], &value) && value > 0.0 &&
+                   value <= kMaxRate) {
+            options.rate = value;
+        } else if (arg == "--imu-rate" && has_value && parse_double(argv[++i], &value) && value >= 0.0) {
+            options.imu_rate = value;
+        } else if (arg == "--crc-errors" && has_value && parse_double(argv[++i], &value) && value >= 0.0 &&
+                   value <= 1.0) {
+            options.crc_errors = value;
+        } else if (arg == "--drops" && has_value && parse_double(argv[++i], &value) && value >= 0.0 &&
+                   value <= 1.0) {
+            options.drops = value;
+        } else if (arg == "--burst" && has_value && parse_double(argv[++i], &value) && value >= 1.0) {
+            options.burst = static_cast<int>(value);
+        } else if (arg == "--tx-buffer" && has_value && parse_double(argv[++i], &value) && value >= 1024.0) {
+            options.tx_buffer = static_cast<size_t>(value);
+        } else if (arg == "--duration" && has_value && parse_double(argv[++i], &value) && value >= 0.0) {
+            options.duration_s = value;
+        } else if (arg == "--seed" && has_value && parse_double(argv[++i], &value)) {
+            options.seed = static_cast<unsigned>(value);
+        } else if (arg == "--report-s" && has_value && parse_double(argv[++i], &value) && value >= 0.0) {
+            options.report_s = static_cast<int>(value);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        std::cerr << "Sim: Cannot create a pseudo-terminal: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::string device = ptsname(master);
+    int slave = ::open(device.c_str(), O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        std::cerr << "Sim: Cannot open " << device << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    // Raw: no echo of what the host writes, no line editing of binary frames.
+    termios tio;
+    if (tcgetattr(slave, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+    }
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    if (!options.link.empty()) {
+        // Only ever replace a stale link: --link pointing at a real device or
+        // file by mistake must not delete it.
+        struct stat st;
+        if (::lstat(options.link.c_str(), &st) == 0) {
+            if (!S_ISLNK(st.st_mode)) {
+                std::cerr << "Sim: " << options.link << " exists and is not a symlink; not replacing it." << std::endl;
+                return 1;
+            }
+            if (::unlink(options.link.c_str()) != 0) {
+                std::cerr << "Sim: Cannot remove " << options.link << ": " << std::strerror(errno) << std::endl;
+                return 1;
+            }
+        } else if (errno != ENOENT) {
+            std::cerr << "Sim: Cannot check " << options.link << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        if (::symlink(device.c_str(), options.link.c_str()) != 0) {
+            std::cerr << "Sim: Cannot link " << options.link << " to " << device << ": " << std::strerror(errno)
+                      << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Sim: Piksi Multi on " << (options.link.empty() ? device : options.link + " -> " + device)
+              << ", " << options.rate << " Hz solutions";
+    if (options.imu_rate > 0.0) {
+        std::cout << ", " << options.imu_rate << " Hz IMU";
+    }
+    std::cout << "." << std::endl;
+
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    Simulator simulator(options, master, slave);
+    simulator.run();
+
+    // Remove the link only if it is still ours.
+    if (!options.link.empty()) {
+        char target[4096];
+        ssize_t len = ::readlink(options.link.c_str(), target, sizeof(target) - 1);
+        if (len >= 0 && device == std::string(target, len)) {
+            ::unlink(options.link.c_str());
+        }
+    }
+    ::close(slave);
+    ::close(master);
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include "predictor.hpp"
+#include "epoch_assembler.hpp"
+#include "gps_time.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace piksi {
+
+// Reported accuracies are floored so one optimistic fix cannot pin the filter.
+static const double kMinPosSigma = 0.005; // m
+static const double kMinVelSigma = 0.01;  // m/s
+// Velocity variance assumed after a reset without VEL_NED, (10 m/s)^2.
+static const double kUnknownVelVar = 100.0;
+// A longer outage, or time running backwards (a new replay), restarts the filter.
+static const s64 kResetGapNs = 5000000000LL;
+static const s64 kWeekMs = kSecondsPerWeek * 1000;
+
+static double variance(float sigma, double floor) {
+    double s = std::max(static_cast<double>(sigma), floor);
+    return s * s;
+}
+
+StatePredictor::StatePredictor(const PredictorOptions& options) : options_(options) {}
+
+void StatePredictor::update(const PiksiData& data) {
+    bool has_llh = (data.epoch_parts & kPartLlh) != 0;
+    bool has_ecef = (data.epoch_parts & kPartEcef) != 0;
+    bool has_vel = (data.epoch_parts & kPartVel) != 0;
+    if ((!has_llh && !has_ecef) || (data.status & 0x07) == 0 || data.host_mono_ns <= 0) {
+        return;
+    }
+
+    double ecef[3];
+    double r_pos[3];
+    if (has_llh) {
+        llh_to_ecef(data.lat, data.lon, data.h, ecef);
+        r_pos[0] = r_pos[1] = variance(data.S_llh_h, kMinPosSigma);
+        r_pos[2] = variance(data.S_llh_v, kMinPosSigma);
+    } else {
+        ecef[0] = data.ecef_x;
+        ecef[1] = data.ecef_y;
+        ecef[2] = data.ecef_z;
+        r_pos[0] = r_pos[1] = r_pos[2] = variance(data.S_ecef, kMinPosSigma);
+    }
+    double vel[3] = {data.v_n, data.v_e, data.v_d};
+    double r_vel[3];
+    r_vel[0] = r_vel[1] = variance(data.S_rtk_v_h, kMinVelSigma);
+    r_vel[2] = variance(data.S_rtk_v_v, kMinVelSigma);
+
+    s64 t = fix_time(data);
+    if (!valid_ || t <= state_w_.t_ns || t - state_w_.t_ns > kResetGapNs) {
+        double lat = data.lat, lon = data.lon, h = data.h;
+        if (!has_llh) {
+            ecef_to_llh(ecef, &lat, &lon, &h);
+        }
+        state_w_.frame = LocalFrame::at(lat, lon, h);
+        double ned[3];
+        state_w_.frame.ecef_to_ned(ecef, ned);
+        for (int i = 0; i < 3; ++i) {
+            Axis& axis = state_w_.axis[i];
+            axis.x[0] = ned[i];
+            axis.x[1] = has_vel ? vel[i] : 0.0;
+            axis.p[0][0] = r_pos[i];
+            axis.p[0][1] = axis.p[1][0] = 0.0;
+            axis.p[1][1] = has_vel ? r_vel[i] : kUnknownVelVar;
+        }
+        valid_ = true;
+    } else {
+        double dt = (t - state_w_.t_ns) * 1e-9;
+        double q = options_.accel_noise * options_.accel_noise;
+        double ned[3];
+        state_w_.frame.ecef_to_ned(ecef, ned);
+        for (int i = 0; i < 3; ++i) {
+            Axis& axis = state_w_.axis[i];
+            propagate(axis, dt, q, axis);
+            correct(axis, 0, ned[i], r_pos[i]);
+            if (has_vel) {
+                correct(axis, 1, vel[i], r_vel[i]);
+            }
+        }
+    }
+    state_w_.fix = data;
+    state_w_.t_ns = t;
+    state_.store(state_w_);
+}
+
+bool StatePredictor::predict(s64 host_mono_ns, PiksiData& out) const {
+    State s;
+    if (state_.load(s) == 0) {
+        return false;
+    }
+    s64 dt_ns = host_mono_ns - s.t_ns;
+    if (std::llabs(dt_ns) > static_cast<s64>(options_.max_horizon_ms) * 1000000) {
+        return false;
+    }
+    double dt = dt_ns * 1e-9;
+    double q = options_.accel_noise * options_.accel_noise;
+    Axis pred[3];
+    double ned[3];
+    for (int i = 0; i < 3; ++i) {
+        propagate(s.axis[i], dt, q, pred[i]);
+        ned[i] = pred[i].x[0];
+    }
+
+    out = s.fix;
+    double ecef[3];
+    s.frame.ned_to_ecef(ned, ecef);
+    ecef_to_llh(ecef, &out.lat, &out.lon, &out.h);
+    out.ecef_x = ecef[0];
+    out.ecef_y = ecef[1];
+    out.ecef_z = ecef[2];
+    if (options_.local_origin) {
+        double enu[3];
+        options_.local_origin->ecef_to_enu(ecef, enu);
+        out.local_e = enu[0];
+        out.local_n = enu[1];
+        out.local_u = enu[2];
+    }
+    // The baseline moves with the rover; the base is assumed to stay put.
+    out.n += pred[0].x[0] - s.axis[0].x[0];
+    out.e += pred[1].x[0] - s.axis[1].x[0];
+    out.d += pred[2].x[0] - s.axis[2].x[0];
+    out.v_n = pred[0].x[1];
+    out.v_e = pred[1].x[1];
+    out.v_d = pred[2].x[1];
+
+    double var_h = std::max(pred[0].p[0][0], pred[1].p[0][0]);
+    double var_v = pred[2].p[0][0];
+    out.S_llh_h = static_cast<float>(std::sqrt(var_h));
+    out.S_llh_v = static_cast<float>(std::sqrt(var_v));
+    out.S_ecef = static_cast<float>(std::sqrt(std::max(var_h, var_v)));
+    double growth_h = std::max(var_h - std::max(s.axis[0].p[0][0], s.axis[1].p[0][0]), 0.0);
+    double growth_v = std::max(var_v - s.axis[2].p[0][0], 0.0);
+    out.S_rtk_x_h = static_cast<float>(std::sqrt(out.S_rtk_x_h * out.S_rtk_x_h + growth_h));
+    out.S_rtk_x_v = static_cast<float>(std::sqrt(out.S_rtk_x_v * out.S_rtk_x_v + growth_v));
+    out.S_rtk_v_h = static_cast<float>(std::sqrt(std::max(pred[0].p[1][1], pred[1].p[1][1])));
+    out.S_rtk_v_v = static_cast<float>(std::sqrt(pred[2].p[1][1]));
+
+    // Time fields describe the instant predicted for, not the fix.
+    s64 tow = static_cast<s64>(s.fix.tow) + static_cast<s64>(std::llround(dt * 1e3));
+    if (tow >= kWeekMs) {
+        tow -= kWeekMs;
+        out.gps_week = out.gps_week > 0 ? out.gps_week + 1 : 0;
+    } else if (tow < 0) {
+        tow += kWeekMs;
+        out.gps_week = out.gps_week > 0 ? out.gps_week - 1 : 0;
+    }
+    out.tow = static_cast<u32>(tow);
+    if (out.utc_timestamp > 0.0) {
+        out.utc_timestamp += dt;
+        TimeOfDay tod = time_of_day(out.utc_timestamp);
+        out.hr = tod.hr;
+        out.min = tod.min;
+        out.sec = tod.sec;
+        out.ms = tod.ms;
+        out.utc = out.hr + out.min / 60.0 + (out.sec + out.ms / 1000.0) / 3600.0;
+    }
+    if (out.host_real_ns > 0) {
+        out.host_real_ns += host_mono_ns - s.fix.host_mono_ns;
+    }
+    out.host_mono_ns = host_mono_ns;
+    return true;
+}
+
+// Host CLOCK_MONOTONIC at which the fix was valid: arrival minus its age.
+s64 StatePredictor::fix_time(const PiksiData& data) const {
+    s64 latency_ns = 0;
+    if (options_.latency_ms >= 0) {
+        latency_ns = static_cast<s64>(options_.latency_ms) * 1000000;
+    } else if (data.utc_timestamp > 0.0 && data.host_real_ns > 0) {
+        latency_ns = data.host_real_ns - static_cast<s64>(data.utc_timestamp * 1e9);
+        latency_ns = std::max<s64>(0, std::min<s64>(latency_ns, 1000000000LL)); // clock not synchronised
+    }
+    return data.host_mono_ns - latency_ns;
+}
+
+// x' = F x, P' = F P F^T + Q for constant velocity over dt (either direction).
+void StatePredictor::propagate(const Axis& in, double dt, double q, Axis& out) {
+    double a = std::fabs(dt);
+    double p00 = in.p[0][0], p01 = in.p[0][1], p10 = in.p[1][0], p11 = in.p[1][1];
+    out.x[0] = in.x[0] + dt * in.x[1];
+    out.x[1] = in.x[1];
+    out.p[0][0] = p00 + dt * (p01 + p10) + dt * dt * p11 + q * a * a * a / 3.0;
+    out.p[0][1] = p01 + dt * p11 + q * a * a / 2.0;
+    out.p[1][0] = p10 + dt * p11 + q * a * a / 2.0;
+    out.p[1][1] = p11 + q * a;
+}
+
+// Scalar measurement z of state component index with variance r.
+void StatePredictor::correct(Axis& axis, int index, double z, double r) {
+    double s = axis.p[index][index] + r;
+    double k0 = axis.p[0][index] / s;
+    double k1 = axis.p[1][index] / s;
+    double innovation = z - axis.x[index];
+    axis.x[0] += k0 * innovation;
+    axis.x[1] += k1 * innovation;
+    double pi0 = axis.p[index][0], pi1 = axis.p[index][1];
+    axis.p[0][0] -= k0 * pi0;
+    axis.p[0][1] -= k0 * pi1;
+    axis.p[1][0] -= k1 * pi0;
+    axis.p[1][1] -= k1 * pi1;
+}
+
+} // namespace piksi
@@ -0,0 +1,251 @@
+#include "publisher.hpp"
+#include "gps_time.hpp"
+#include <cstring>
+#include <iostream>
+#include <variant>
+#include <vector>
+
+namespace piksi {
+
+#if defined(Z_FEATURE_SHARED_MEMORY) && defined(Z_FEATURE_UNSTABLE_API)
+// Room for a few hundred payloads in flight; a subscriber in another process
+// maps the same segment, so a put costs one memcpy into it and no socket copy.
+static const size_t kShmPoolSize = 256 * 1024;
+
+struct SolutionPublisher::Shm {
+    zenoh::PosixShmProvider provider{zenoh::MemoryLayout(kShmPoolSize, zenoh::AllocAlignment({2}))};
+};
+
+bool SolutionPublisher::shm_supported() { return true; }
+#else
+struct SolutionPublisher::Shm {};
+
+bool SolutionPublisher::shm_supported() { return false; }
+#endif
+
+SolutionPublisher::SolutionPublisher(std::shared_ptr<zenoh::Session> session, const PublisherOptions& options,
+                                     Snapshot<PiksiData>& source, Metrics& metrics)
+    : session_(std::move(session)), options_(options), source_(source), metrics_(metrics) {
+    const char* format = options_.binary ? "binary" : "JSON";
+    for (size_t i = 0; i < kTopicCount; ++i) {
+        double rate = options_.rate_hz[i];
+        if (rate < 0.0) {
+            continue;
+        }
+        Topic topic = static_cast<Topic>(i);
+        std::string key = topic == Topic::kFull ? options_.key : options_.key + "/" + topic_name(topic);
+        topics_[i].pub = session_->declare_publisher(zenoh::KeyExpr(key));
+        topics_[i].period_ms = rate > 0.0 ? static_cast<u32>(1000.0 / rate) : 0;
+        std::cout << "Zenoh: Initialized publisher on key '" << key << "' via UDP (" << format << " payload, ";
+        if (rate > 0.0) {
+            std::cout << "up to " << rate << " Hz)." << std::endl;
+        } else {
+            std::cout << "every solution)." << std::endl;
+        }
+    }
+    if (options_.shm) {
+        if (shm_supported()) {
+            shm_ = std::make_unique<Shm>();
+            std::cout << "Zenoh: Publishing solutions through shared memory." << std::endl;
+        } else {
+            std::cerr << "Zenoh: Warning - shm_enabled needs zenoh-c built with shared memory support. Using UDP." << std::endl;
+        }
+    }
+}
+
+SolutionPublisher::~SolutionPublisher() {
+    stop();
+}
+
+void SolutionPublisher::start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread([this]() { run(); });
+}
+
+void SolutionPublisher::stop() {
+    running_ = false;
+    source_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    // Whatever was stored after the thread's last wakeup still goes out.
+    if (source_.version() > seen_) {
+        PiksiData data;
+        uint64_t before = seen_;
+        seen_ = source_.load(data);
+        if (seen_ > before + 1) {
+            metrics_.count_coalesced(seen_ - before - 1);
+        }
+        publish(data);
+    }
+}
+
+void SolutionPublisher::run() {
+    PiksiData data;
+    while (running_) {
+        uint64_t before = seen_;
+        if (!source_.wait_newer(seen_, data, std::chrono::milliseconds(100))) {
+            continue;
+        }
+        if (seen_ > before + 1) {
+            metrics_.count_coalesced(seen_ - before - 1);
+        }
+        publish(data);
+    }
+}
+
+void SolutionPublisher::publish(const PiksiData& data) {
+    // The snapshot version numbers solutions, so a gap tells subscribers how many were coalesced.
+    u32 seq = static_cast<u32>(seen_);
+    for (size_t i = 0; i < kTopicCount; ++i) {
+        TopicState& topic = topics_[i];
+        if (topic.pub && due(topic, data.tow)) {
+            put(static_cast<Topic>(i), topic, data, seq);
+        }
+    }
+    if (data.host_mono_ns > 0) {
+        metrics_.record(Stage::kPublish, clock_ns(CLOCK_MONOTONIC) - data.host_mono_ns);
+    }
+}
+
+// Rate-limited topics are decimated on receiver time, not host time, so the
+// published solutions stay evenly spaced when the host stalls or replays fast.
+bool SolutionPublisher::due(TopicState& topic, u32 tow) {
+    if (topic.period_ms == 0) {
+        return true;
+    }
+    // A tow going backwards (week rollover, a new replay) restarts the schedule.
+    bool forward = topic.sent && tow >= topic.last_tow;
+    if (forward && tow < topic.last_tow + topic.period_ms) {
+        return false;
+    }
+    // Stay on a period_ms grid so e.g. 3 Hz from a 10 Hz stream is 3 Hz, not 2.5.
+    bool on_grid = forward && tow < topic.last_tow + 2 * topic.period_ms;
+    topic.last_tow = on_grid ? topic.last_tow + topic.period_ms : tow;
+    topic.sent = true;
+    return true;
+}
+
+void SolutionPublisher::put(Topic topic, TopicState& topic_state, const PiksiData& data, u32 seq) {
+    zenoh::Publisher& pub = *topic_state.pub;
+    if (shm_) {
+#if defined(Z_FEATURE_SHARED_MEMORY) && defined(Z_FEATURE_UNSTABLE_API)
+        std::string json;
+        size_t len = topic == Topic::kFull ? kBinarySize : kTopicSize;
+        if (!options_.binary) {
+            json = topic_json(topic, data, seq);
+            len = json.size();
+        }
+        // Never waits for space: one stalled local subscriber must not hold up every topic.
+        auto alloc = shm_->provider.alloc_gc_defrag(len, zenoh::AllocAlignment({0}));
+        if (auto* buffer = std::get_if<zenoh::ZShmMut>(&alloc)) {
+            if (options_.binary) {
+                encode_topic(topic, data, seq, buffer->data()); // straight into the shared segment
+            } else {
+                std::memcpy(buffer->data(), json.data(), len);
+            }
+            pub.put(std::move(*buffer));
+            return;
+        }
+        // Segment exhausted by slow subscribers: fall through to a regular put.
+#endif
+    }
+
+    if (!options_.binary) {
+        pub.put(topic_json(topic, data, seq));
+        return;
+    }
+    u8* buffer = pool_->acquire();
+    if (!buffer) {
+        // Every pooled buffer is still held by Zenoh; fall back to a copy.
+        std::vector<uint8_t> copy(kBinarySize);
+        copy.resize(encode_topic(topic, data, seq, copy.data()));
+        pub.put(zenoh::Bytes(std::move(copy)));
+        return;
+    }
+    size_t len = encode_topic(topic, data, seq, buffer);
+    pub.put(zenoh::Bytes(buffer, len, [pool = pool_](uint8_t* ptr) { pool->release(ptr); }));
+}
+
+PredictionPublisher::PredictionPublisher(std::shared_ptr<zenoh::Session> session, const std::string& key, bool binary,
+                                         double rate_hz, const StatePredictor& predictor)
+    : session_(std::move(session)), binary_(binary), period_ns_(static_cast<s64>(1e9 / rate_hz)),
+      predictor_(predictor) {
+    pub_ = session_->declare_publisher(zenoh::KeyExpr(key));
+    std::cout << "Zenoh: Publishing predicted states on '" << key << "' at " << rate_hz << " Hz ("
+              << (binary_ ? "binary" : "JSON") << " payload)." << std::endl;
+}
+
+PredictionPublisher::~PredictionPublisher() {
+    stop();
+}
+
+void PredictionPublisher::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&PredictionPublisher::run, this);
+}
+
+void PredictionPublisher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    cv_.notify_all();
+    thread_.join();
+    std::cout << "Zenoh: Published " << published() << " predicted states." << std::endl;
+}
+
+// Ticks on a fixed CLOCK_MONOTONIC grid (steady_clock on Linux); a tick that
+// is already past when the thread wakes is skipped rather than sent late.
+void PredictionPublisher::run() {
+    using Clock = std::chrono::steady_clock;
+    std::chrono::nanoseconds period(period_ns_);
+    Clock::time_point next = Clock::now() + period;
+    u32 seq = 0;
+    PiksiData data;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (cv_.wait_until(lock, next, [this] { return !running_; })) {
+            break;
+        }
+        lock.unlock();
+        if (predictor_.predict(clock_ns(CLOCK_MONOTONIC), data)) {
+            put(data, ++seq);
+            published_.fetch_add(1, std::memory_order_relaxed);
+        }
+        next += period;
+        Clock::time_point now = Clock::now();
+        if (next < now) {
+            next += (now - next) / period * period + period;
+        }
+        lock.lock();
+    }
+}
+
+void PredictionPublisher::put(const PiksiData& data, u32 seq) {
+    if (!binary_) {
+        pub_->put(to_json(data, seq));
+        return;
+    }
+    u8* buffer = pool_->acquire();
+    if (!buffer) {
+        std::vector<uint8_t> copy(kBinarySize);
+        copy.resize(encode_binary(data, seq, copy.data()));
+        pub_->put(zenoh::Bytes(std::move(copy)));
+        return;
+    }
+    size_t len = encode_binary(data, seq, buffer);
+    pub_->put(zenoh::Bytes(buffer, len, [pool = pool_](uint8_t* ptr) { pool->release(ptr); }));
+}
+
+} // namespace piksi
@@ -0,0 +1,170 @@
+#include "raw_capture.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace piksi {
+
+RawCapture::RawCapture(const RawCaptureOptions& options)
+    : options_(options), buffers_(std::max<size_t>(2, options.buffers)), file_(options.rotation) {
+    for (Buffer& buffer : buffers_) {
+        buffer.bytes.reset(new u8[options_.buffer_bytes]);
+        buffer.index.reserve(options_.buffer_bytes / 64);
+        free_.push_back(&buffer);
+    }
+    ready_.reserve(buffers_.size());
+}
+
+RawCapture::~RawCapture() {
+    stop();
+}
+
+void RawCapture::start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    writer_ = std::thread(&RawCapture::run, this);
+}
+
+void RawCapture::stop() {
+    if (!running_) {
+        return;
+    }
+    if (active_ && active_->size > 0) {
+        submit();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    writer_.join();
+    file_.close();
+    if (index_) {
+        std::fclose(index_);
+        index_ = nullptr;
+    }
+    RawCaptureStats s = stats();
+    std::cout << "Log: Raw capture wrote " << s.bytes << " bytes to " << s.files << " file(s)";
+    if (s.dropped > 0) {
+        std::cout << ", dropped " << s.dropped << " bytes";
+    }
+    std::cout << "." << std::endl;
+}
+
+RawCaptureStats RawCapture::stats() const {
+    return {written_.load(), dropped_.load(), files_.load()};
+}
+
+void RawCapture::append(const u8* data, size_t n, const HostTime& rx) {
+    if (!active_ && !next_buffer(rx)) {
+        dropped_.fetch_add(n, std::memory_order_relaxed);
+        return;
+    }
+    if (rx.mono_ns != last_rx_.mono_ns) {
+        active_->index.push_back({active_->size, rx.mono_ns, rx.real_ns});
+        last_rx_ = rx;
+    }
+    while (n > 0) {
+        size_t chunk = std::min(n, options_.buffer_bytes - active_->size);
+        std::memcpy(active_->bytes.get() + active_->size, data, chunk);
+        active_->size += chunk;
+        data += chunk;
+        n -= chunk;
+        if (active_->size == options_.buffer_bytes) {
+            submit();
+            if (n > 0 && !next_buffer(rx)) {
+                dropped_.fetch_add(n, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+    flush_if_due(rx.mono_ns);
+}
+
+void RawCapture::flush_if_due(s64 now_ns) {
+    if (active_ && active_->size > 0 && now_ns - active_->started_ns >= options_.flush_ms * 1000000LL) {
+        submit();
+    }
+}
+
+bool RawCapture::next_buffer(const HostTime& rx) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.empty()) {
+            return false;
+        }
+        active_ = free_.back();
+        free_.pop_back();
+    }
+    active_->size = 0;
+    active_->index.clear();
+    active_->started_ns = rx.mono_ns;
+    // Every buffer starts with the time of its first byte.
+    active_->index.push_back({0, rx.mono_ns, rx.real_ns});
+    last_rx_ = rx;
+    return true;
+}
+
+void RawCapture::submit() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(active_);
+    }
+    active_ = nullptr;
+    cv_.notify_one();
+}
+
+void RawCapture::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return !ready_.empty() || !running_; });
+        if (ready_.empty()) {
+            break; // stopped with nothing left to write
+        }
+        Buffer* buffer = ready_.front();
+        ready_.erase(ready_.begin());
+        lock.unlock();
+        write(*buffer);
+        lock.lock();
+        free_.push_back(buffer);
+    }
+}
+
+void RawCapture::write(Buffer& buffer) {
+    if (!file_.write(reinterpret_cast<const char*>(buffer.bytes.get()), buffer.size)) {
+        dropped_ += buffer.size;
+        return;
+    }
+    if (file_.files_opened() != files_) {
+        // The data file was (re)opened for this buffer: start its index.
+        if (index_) {
+            std::fclose(index_);
+        }
+        index_path_ = file_.path();
+        file_offset_ = 0;
+        index_ = std::fopen((index_path_ + ".idx").c_str(), "wb");
+        if (index_) {
+            u16 header[2] = {kRawIndexVersion, 0};
+            std::fwrite("PIDX", 1, 4, index_);
+            std::fwrite(header, sizeof(header), 1, index_);
+        } else {
+            std::cerr << "Log: Cannot create " << index_path_ << ".idx: " << std::strerror(errno) << std::endl;
+        }
+        files_ = file_.files_opened();
+    }
+    if (index_) {
+        for (IndexEntry entry : buffer.index) {
+            entry.offset += file_offset_;
+            std::fwrite(&entry, sizeof(entry), 1, index_);
+        }
+        std::fflush(index_);
+    }
+    file_offset_ += buffer.size;
+    file_.end_batch();
+    written_ += buffer.size;
+}
+
+} // namespace piksi
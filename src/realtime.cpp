@@ -0,0 +1,111 @@
+#include "realtime.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace piksi {
+
+// Stack the acquisition thread may use, touched once so that it is resident
+// before the first frame arrives.
+static const size_t kPrefaultStackBytes = 256 * 1024;
+
+bool parse_cpu_list(const std::string& value, std::vector<int>* cpus) {
+    std::vector<int> out;
+    std::istringstream is(value);
+    std::string item;
+    while (std::getline(is, item, ',')) {
+        try {
+            size_t dash = item.find('-');
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            if (first < 0 || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                out.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    if (out.empty()) {
+        return false;
+    }
+    *cpus = out;
+    return true;
+}
+
+static void prefault_stack() {
+    volatile unsigned char stack[kPrefaultStackBytes];
+    for (size_t i = 0; i < sizeof(stack); i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+bool apply_realtime(const RealtimeOptions& options) {
+    bool ok = true;
+    std::ostringstream applied;
+
+    if (!options.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : options.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            std::cerr << "GPS: Warning - Cannot pin the acquisition thread to rt_cpus: " << std::strerror(err)
+                      << std::endl;
+            ok = false;
+        } else {
+            applied << " CPUs";
+            for (size_t i = 0; i < options.cpus.size(); ++i) {
+                applied << (i ? "," : " ") << options.cpus[i];
+            }
+        }
+    }
+
+    if (options.priority > 0) {
+        sched_param param = {};
+        param.sched_priority = options.priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0) {
+            std::cerr << "GPS: Warning - Cannot use SCHED_FIFO priority " << options.priority << ": "
+                      << std::strerror(err) << " (needs CAP_SYS_NICE or an rtprio limit)" << std::endl;
+            ok = false;
+        } else {
+            applied << (applied.tellp() > 0 ? "," : "") << " SCHED_FIFO " << options.priority;
+        }
+    }
+
+    if (options.lock_memory) {
+#ifdef __GLIBC__
+        // Keep freed memory in the heap instead of returning it to the kernel,
+        // and serve large blocks from it too, so locked pages stay locked.
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+#endif
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            std::cerr << "GPS: Warning - Cannot lock memory: " << std::strerror(errno)
+                      << " (needs CAP_IPC_LOCK or a memlock limit)" << std::endl;
+            ok = false;
+        } else {
+            prefault_stack();
+            applied << (applied.tellp() > 0 ? "," : "") << " memory locked";
+        }
+    }
+
+    if (applied.tellp() > 0) {
+        std::cout << "GPS: Acquisition thread:" << applied.str() << "." << std::endl;
+    }
+    return ok;
+}
+
+} // namespace piksi
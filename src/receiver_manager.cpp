@@ -0,0 +1,75 @@
+#include "receiver_manager.hpp"
+#include <fstream>
+#include <iostream>
+
+namespace piksi {
+
+std::vector<std::string> ReceiverManager::find_sections(const std::string& config_file_path) {
+    std::vector<std::string> sections;
+    std::ifstream config_file(config_file_path);
+    std::string line;
+    const std::string prefix = std::string(PiksiMultiGPS::kDefaultSection) + " ";
+    while (std::getline(config_file, line)) {
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t") + 1);
+        if (line.length() < 2 || line.front() != '[' || line.back() != ']') {
+            continue;
+        }
+        std::string section = line.substr(1, line.length() - 2);
+        if (section == PiksiMultiGPS::kDefaultSection || section.compare(0, prefix.size(), prefix) == 0) {
+            sections.push_back(section);
+        }
+    }
+    return sections;
+}
+
+ReceiverManager::ReceiverManager(const std::string& config_file_path) {
+    std::vector<std::string> sections = find_sections(config_file_path);
+    if (sections.empty()) {
+        sections.push_back(PiksiMultiGPS::kDefaultSection); // defaults, as a lone receiver would use
+    }
+
+    for (const std::string& section : sections) {
+        auto gps = std::make_unique<PiksiMultiGPS>(config_file_path, section, session_);
+        if (!session_) {
+            session_ = gps->get_session(); // shared by the receivers that follow
+        }
+        receivers_.push_back(std::move(gps));
+    }
+}
+
+ReceiverManager::~ReceiverManager() {
+    stop();
+}
+
+void ReceiverManager::start() {
+    for (auto& gps : receivers_) {
+        std::cout << "GPS: Initializing receiver '" << (gps->get_name().empty() ? "default" : gps->get_name())
+                  << "'..." << std::endl;
+        if (!gps->open()) {
+            std::cerr << "GPS: Receiver '" << (gps->get_name().empty() ? "default" : gps->get_name())
+                      << "' could not be opened; the others continue." << std::endl;
+            continue;
+        }
+        gps->configure();
+        gps->start();
+    }
+}
+
+void ReceiverManager::stop() {
+    for (auto& gps : receivers_) {
+        gps->stop();
+        gps->close();
+    }
+}
+
+bool ReceiverManager::running() const {
+    for (const auto& gps : receivers_) {
+        if (gps->running()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace piksi
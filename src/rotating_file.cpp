@@ -0,0 +1,116 @@
+#include "rotating_file.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <ctime>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace piksi {
+
+bool parse_fsync_policy(const std::string& value, FsyncPolicy* policy) {
+    if (value == "none") {
+        *policy = FsyncPolicy::kNone;
+    } else if (value == "batch") {
+        *policy = FsyncPolicy::kBatch;
+    } else if (value == "periodic") {
+        *policy = FsyncPolicy::kPeriodic;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+RotatingFile::RotatingFile(const RotationOptions& options) : options_(options) {}
+
+RotatingFile::~RotatingFile() {
+    close();
+}
+
+bool RotatingFile::open_next() {
+    close();
+
+    std::time_t now = std::time(nullptr);
+    std::tm local_time;
+    localtime_r(&now, &local_time);
+    std::ostringstream base;
+    base << options_.directory << "/" << std::put_time(&local_time, "%Y-%m-%d_%H-%M-%S");
+
+    // Several rotations within one second get a counter appended.
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        path_ = base.str() + (attempt ? "_" + std::to_string(attempt) : "") + options_.suffix;
+        fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ >= 0 || errno != EEXIST) {
+            break;
+        }
+    }
+    if (fd_ < 0) {
+        std::cerr << "Log: Failed to open " << path_ << " for logging: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    bytes_ = 0;
+    files_opened_++;
+    opened_at_ = std::chrono::steady_clock::now();
+    last_sync_ = opened_at_;
+    return header_.empty() || write_all(header_.data(), header_.size());
+}
+
+bool RotatingFile::write_all(const char* data, size_t n) {
+    while (n > 0) {
+        ssize_t written = ::write(fd_, data, n);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Log: Write to " << path_ << " failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        data += written;
+        n -= static_cast<size_t>(written);
+        bytes_ += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+bool RotatingFile::write(const char* data, size_t n) {
+    bool rotate = fd_ < 0;
+    if (!rotate && options_.rotate_bytes > 0 && bytes_ + n > options_.rotate_bytes && bytes_ > header_.size()) {
+        rotate = true;
+    }
+    if (!rotate && options_.rotate_seconds > 0 &&
+        std::chrono::steady_clock::now() - opened_at_ >= std::chrono::seconds(options_.rotate_seconds)) {
+        rotate = true;
+    }
+    if (rotate && !open_next()) {
+        return false;
+    }
+    return write_all(data, n);
+}
+
+void RotatingFile::end_batch() {
+    if (fd_ < 0 || options_.fsync == FsyncPolicy::kNone) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (options_.fsync == FsyncPolicy::kPeriodic &&
+        now - last_sync_ < std::chrono::milliseconds(options_.fsync_period_ms)) {
+        return;
+    }
+    ::fsync(fd_);
+    last_sync_ = now;
+}
+
+void RotatingFile::close() {
+    if (fd_ >= 0) {
+        if (options_.fsync != FsyncPolicy::kNone) {
+            ::fsync(fd_);
+        }
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+} // namespace piksi
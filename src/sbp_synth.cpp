@@ -0,0 +1,135 @@
+#include "sbp_synth.hpp"
+#include "gps_time.hpp"
+#include <libsbp/legacy/compat.h>
+#include <libsbp/legacy/imu.h>
+#include <libsbp/legacy/navigation.h>
+#include <libsbp/legacy/system.h>
+#include <ctime>
+
+namespace piksi {
+
+SbpSynth::SbpSynth(u16 sender_id) : sender_id_(sender_id) {
+    sbp_state_init(&state_);
+}
+
+void SbpSynth::heartbeat(std::vector<u8>& out) {
+    msg_heartbeat_t hb = {};
+    message(out, SBP_MSG_HEARTBEAT, &hb, sizeof(hb));
+}
+
+void SbpSynth::epoch(std::vector<u8>& out, u16 week, u32 tow_ms) {
+    u64 i = epochs_++;
+
+    msg_gps_time_t gps_time = {};
+    gps_time.wn = week;
+    gps_time.tow = tow_ms;
+    gps_time.flags = 1;
+    message(out, SBP_MSG_GPS_TIME, &gps_time, sizeof(gps_time));
+
+    s64 gps_ms = static_cast<s64>(week) * kSecondsPerWeek * 1000 + tow_ms;
+    s64 gps_seconds = gps_ms / 1000;
+    time_t unix_seconds = static_cast<time_t>(kGpsEpochUnix + gps_seconds - gps_utc_offset(gps_seconds));
+    tm civil;
+    gmtime_r(&unix_seconds, &civil);
+    msg_utc_time_t utc = {};
+    utc.flags = 0x09;
+    utc.tow = tow_ms;
+    utc.year = static_cast<u16>(civil.tm_year + 1900);
+    utc.month = static_cast<u8>(civil.tm_mon + 1);
+    utc.day = static_cast<u8>(civil.tm_mday);
+    utc.hours = static_cast<u8>(civil.tm_hour);
+    utc.minutes = static_cast<u8>(civil.tm_min);
+    utc.seconds = static_cast<u8>(civil.tm_sec);
+    utc.ns = static_cast<u32>(gps_ms % 1000) * 1000000;
+    message(out, SBP_MSG_UTC_TIME, &utc, sizeof(utc));
+
+    msg_pos_ecef_t ecef = {};
+    ecef.tow = tow_ms;
+    ecef.x = 1130758.0 + i * 1e-4;
+    ecef.y = -4828605.0;
+    ecef.z = 3991438.0;
+    ecef.accuracy = 15;
+    ecef.n_sats = 14;
+    ecef.flags = 4;
+    message(out, SBP_MSG_POS_ECEF, &ecef, sizeof(ecef));
+
+    msg_pos_llh_t llh = {};
+    llh.tow = tow_ms;
+    llh.lat = 38.899 + i * 1e-9;
+    llh.lon = -77.048;
+    llh.height = 21.5;
+    llh.h_accuracy = 20;
+    llh.v_accuracy = 30;
+    llh.n_sats = 14;
+    llh.flags = 4;
+    message(out, SBP_MSG_POS_LLH, &llh, sizeof(llh));
+
+    msg_baseline_ned_t baseline = {};
+    baseline.tow = tow_ms;
+    baseline.n = 12000 + static_cast<s32>(i % 100);
+    baseline.e = -3400;
+    baseline.d = 150;
+    baseline.h_accuracy = 10;
+    baseline.v_accuracy = 20;
+    baseline.n_sats = 14;
+    baseline.flags = 4;
+    message(out, SBP_MSG_BASELINE_NED, &baseline, sizeof(baseline));
+
+    msg_vel_ned_t vel = {};
+    vel.tow = tow_ms;
+    vel.n = 1200;
+    vel.e = -300;
+    vel.d = 15;
+    vel.h_accuracy = 30;
+    vel.v_accuracy = 50;
+    vel.n_sats = 14;
+    vel.flags = 1;
+    message(out, SBP_MSG_VEL_NED, &vel, sizeof(vel));
+}
+
+void SbpSynth::imu_raw(std::vector<u8>& out, u32 tow_ms, u8 tow_f) {
+    // xorshift32: a few LSB of noise so samples are not all identical.
+    noise_ ^= noise_ << 13;
+    noise_ ^= noise_ >> 17;
+    noise_ ^= noise_ << 5;
+    s16 n = static_cast<s16>(static_cast<int>(noise_ & 0x0F) - 8);
+
+    msg_imu_raw_t raw = {};
+    raw.tow = tow_ms & 0x3FFFFFFF; // time status 0: GPS time of week
+    raw.tow_f = tow_f;
+    raw.acc_x = n;
+    raw.acc_y = static_cast<s16>(-n);
+    raw.acc_z = static_cast<s16>(4096 + n); // 1 g at +-8 g full scale
+    raw.gyr_x = n;
+    raw.gyr_y = 0;
+    raw.gyr_z = static_cast<s16>(-n);
+    message(out, SBP_MSG_IMU_RAW, &raw, sizeof(raw));
+}
+
+void SbpSynth::imu_aux(std::vector<u8>& out) {
+    msg_imu_aux_t aux = {};
+    aux.imu_type = 0;
+    aux.temp = 2 * 512; // 25 deg C
+    aux.imu_conf = 0x12;
+    message(out, SBP_MSG_IMU_AUX, &aux, sizeof(aux));
+}
+
+void SbpSynth::age_corrections(std::vector<u8>& out, u32 tow_ms, u16 age_ds) {
+    msg_age_corrections_t age = {};
+    age.tow = tow_ms;
+    age.age = age_ds;
+    message(out, SBP_MSG_AGE_CORRECTIONS, &age, sizeof(age));
+}
+
+void SbpSynth::message(std::vector<u8>& out, u16 msg_type, const void* payload, u8 len) {
+    sbp_state_set_io_context(&state_, &out);
+    sbp_send_message(&state_, msg_type, sender_id_, len, static_cast<u8*>(const_cast<void*>(payload)), &append_bytes);
+}
+
+s32 SbpSynth::append_bytes(u8 *buff, u32 n, void *context) {
+    std::vector<u8>* out = static_cast<std::vector<u8>*>(context);
+    out->insert(out->end(), buff, buff + n);
+    return static_cast<s32>(n);
+}
+
+} // namespace piksi
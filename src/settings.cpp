@@ -0,0 +1,252 @@
+#include "settings.hpp"
+#include <libsbp/legacy/api.h>
+#include <libsbp/legacy/compat.h>
+#include <libsbp/legacy/settings.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace piksi {
+
+static const u16 kHostSender = 0;
+
+// Human-readable SETTINGS_WRITE_RESP status codes.
+static const char* write_status(int status) {
+    switch (status) {
+    case 0: return "accepted";
+    case 1: return "value rejected";
+    case 2: return "setting does not exist";
+    case 3: return "parse failed";
+    case 4: return "read only";
+    case 5: return "modification disabled";
+    case 6: return "service failed";
+    case 7: return "timeout";
+    default: return "unknown status";
+    }
+}
+
+// Splits a settings payload ("section\0name\0value\0...") into its fields.
+static std::vector<std::string> split_fields(const u8* msg, u8 len) {
+    std::vector<std::string> fields;
+    const char* p = reinterpret_cast<const char*>(msg);
+    const char* end = p + len;
+    while (p < end) {
+        size_t n = strnlen(p, static_cast<size_t>(end - p));
+        fields.emplace_back(p, n);
+        p += n + 1;
+    }
+    return fields;
+}
+
+// Receivers may echo "10" as "10.0"; numeric values compare by value.
+static bool same_value(const std::string& a, const std::string& b) {
+    if (a == b) {
+        return true;
+    }
+    char* end_a = nullptr;
+    char* end_b = nullptr;
+    double x = std::strtod(a.c_str(), &end_a);
+    double y = std::strtod(b.c_str(), &end_b);
+    return !a.empty() && !b.empty() && *end_a == '\0' && *end_b == '\0' && x == y;
+}
+
+bool parse_setting_key(const std::string& key, Setting* setting) {
+    size_t dot = key.find('.');
+    if (dot == std::string::npos || dot == 0 || dot + 1 == key.size()) {
+        return false;
+    }
+    setting->section = key.substr(0, dot);
+    setting->name = key.substr(dot + 1);
+    return true;
+}
+
+SettingsManager::SettingsManager(Transport& transport, int timeout_ms, int retries, Step step)
+    : transport_(transport), timeout_(timeout_ms), retries_(retries), step_(std::move(step)) {
+    sbp_state_init(&state_);
+    sbp_state_set_io_context(&state_, this);
+}
+
+bool SettingsManager::write_all(const std::vector<Setting>& settings) {
+    pending_.clear();
+    for (const Setting& setting : settings) {
+        pending_.push_back({&setting, -1});
+    }
+    auto answered = [this] {
+        for (const Pending& p : pending_) {
+            if (p.status < 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    for (int attempt = 0; attempt <= retries_ && !answered(); ++attempt) {
+        if (attempt > 0) {
+            std::cout << "GPS: Retrying unanswered settings writes (" << attempt << "/" << retries_ << ")..." << std::endl;
+        }
+        for (const Pending& p : pending_) {
+            if (p.status < 0) {
+                const Setting& s = *p.setting;
+                send(SBP_MSG_SETTINGS_WRITE, s.section + '\0' + s.name + '\0' + s.value + '\0');
+            }
+        }
+        pump(answered);
+    }
+
+    bool ok = true;
+    for (const Pending& p : pending_) {
+        const Setting& s = *p.setting;
+        std::string label = s.section + "." + s.name;
+        if (p.status < 0) {
+            std::cerr << "GPS: No response writing " << label << "!" << std::endl;
+            ok = false;
+            continue;
+        }
+        if (p.status != 0) {
+            std::cerr << "GPS: Receiver refused " << label << "=" << s.value << " (" << write_status(p.status) << ")" << std::endl;
+            ok = false;
+            continue;
+        }
+        std::string value;
+        if (!read(s.section, s.name, &value)) {
+            std::cerr << "GPS: Cannot read back " << label << "!" << std::endl;
+            ok = false;
+        } else if (!same_value(value, s.value)) {
+            std::cerr << "GPS: " << label << " reads back as " << value << ", expected " << s.value << "!" << std::endl;
+            ok = false;
+        } else {
+            std::cout << "GPS: Setting " << label << " = " << value << " confirmed." << std::endl;
+        }
+    }
+    pending_.clear();
+    return ok;
+}
+
+bool SettingsManager::read(const std::string& section, const std::string& name, std::string* value) {
+    read_key_ = section + '\0' + name;
+    read_done_ = false;
+    for (int attempt = 0; attempt <= retries_ && !read_done_; ++attempt) {
+        send(SBP_MSG_SETTINGS_READ_REQ, read_key_ + '\0');
+        pump([this] { return read_done_; });
+    }
+    if (read_done_) {
+        *value = read_value_;
+    }
+    return read_done_;
+}
+
+bool SettingsManager::switch_baud(const std::string& uart, int from_baud, int to_baud) {
+    std::cout << "GPS: Switching " << uart << " and the host port to " << to_baud << " baud..." << std::endl;
+    rates_unknown_ = false;
+    if (!write_baud(uart, to_baud)) {
+        return false;
+    }
+
+    if (!transport_.set_baud(to_baud)) {
+        return false;
+    }
+    std::string value;
+    if (read(uart, "baudrate", &value) && same_value(value, std::to_string(to_baud))) {
+        std::cout << "GPS: Link running at " << to_baud << " baud." << std::endl;
+        return true;
+    }
+    std::cerr << "GPS: No response at " << to_baud << " baud, falling back to " << from_baud << "!" << std::endl;
+    rates_unknown_ = !restore_baud(uart, from_baud, to_baud);
+    return false;
+}
+
+// Sends <uart>.baudrate; false only if the receiver explicitly refuses it.
+bool SettingsManager::write_baud(const std::string& uart, int baud) {
+    Setting setting{uart, "baudrate", std::to_string(baud)};
+    pending_ = {{&setting, -1}};
+    send(SBP_MSG_SETTINGS_WRITE, setting.section + '\0' + setting.name + '\0' + setting.value + '\0');
+    // The receiver may change rate before its response is fully out, so a
+    // missing response is not an error; only an explicit refusal is.
+    pump([this] { return pending_[0].status >= 0; });
+    int status = pending_[0].status;
+    pending_.clear();
+    if (status > 0) {
+        std::cerr << "GPS: Receiver refused " << uart << ".baudrate=" << baud << " (" << write_status(status) << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// After a switch that could not be verified, the receiver may still have
+// applied it: if it is silent at from_baud, it is told at to_baud to return.
+// False if it answers at neither rate.
+bool SettingsManager::restore_baud(const std::string& uart, int from_baud, int to_baud) {
+    std::string value;
+    if (transport_.set_baud(from_baud) && read(uart, "baudrate", &value)) {
+        return true; // it never left
+    }
+    std::cerr << "GPS: No response at " << from_baud << " baud either; asking " << uart << " at " << to_baud
+              << " baud to return." << std::endl;
+    if (transport_.set_baud(to_baud) && write_baud(uart, from_baud) && transport_.set_baud(from_baud) &&
+        read(uart, "baudrate", &value) && same_value(value, std::to_string(from_baud))) {
+        std::cout << "GPS: Link back at " << from_baud << " baud." << std::endl;
+        return true;
+    }
+    transport_.set_baud(from_baud);
+    std::cerr << "GPS: Receiver answers at neither " << from_baud << " nor " << to_baud << " baud!" << std::endl;
+    return false;
+}
+
+bool SettingsManager::save() {
+    if (!send(SBP_MSG_SETTINGS_SAVE, std::string())) {
+        return false;
+    }
+    std::cout << "GPS: Settings saved to receiver flash." << std::endl;
+    return true;
+}
+
+bool SettingsManager::send(u16 msg_type, const std::string& payload) {
+    std::vector<u8> buffer(payload.begin(), payload.end());
+    s8 ret = sbp_send_message(&state_, msg_type, kHostSender, static_cast<u8>(buffer.size()), buffer.data(), &port_write);
+    if (ret != SBP_OK) {
+        std::cerr << "GPS: Failed to send settings message: " << static_cast<int>(ret) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SettingsManager::pump(const std::function<bool()>& done) {
+    auto deadline = std::chrono::steady_clock::now() + timeout_;
+    while (!done() && std::chrono::steady_clock::now() < deadline && !transport_.eof()) {
+        // Returns after each byte or read timeout, so the deadline is honoured on a silent port.
+        if (!step_()) {
+            break;
+        }
+    }
+    return done();
+}
+
+s32 SettingsManager::port_write(u8 *buff, u32 n, void *context) {
+    return static_cast<SettingsManager*>(context)->transport_.write(buff, n);
+}
+
+void SettingsManager::on_write_resp(u8 len, const u8 msg[]) {
+    if (len < 1) {
+        return;
+    }
+    std::vector<std::string> fields = split_fields(msg + 1, static_cast<u8>(len - 1));
+    if (fields.size() < 2) {
+        return;
+    }
+    for (Pending& p : pending_) {
+        if (p.status < 0 && p.setting->section == fields[0] && p.setting->name == fields[1]) {
+            p.status = msg[0];
+        }
+    }
+}
+
+void SettingsManager::on_read_resp(u8 len, const u8 msg[]) {
+    std::vector<std::string> fields = split_fields(msg, len);
+    if (fields.size() < 3 || read_done_ || fields[0] + '\0' + fields[1] != read_key_) {
+        return;
+    }
+    read_value_ = fields[2];
+    read_done_ = true;
+}
+
+} // namespace piksi
@@ -0,0 +1,439 @@
+#include "transport.hpp"
+#include <libsbp/legacy/navigation.h>
+#include <iostream>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+namespace piksi {
+
+static const size_t kReplayChunk = 64 * 1024;
+static const size_t kSerialBuffer = 64 * 1024;
+static const s64 kMsPerWeek = 604800000;
+// A jump in time of week larger than this restarts the pacing clock.
+static const s64 kMaxPaceGapMs = 10000;
+// A write is abandoned once the port has taken nothing for this long; the
+// wait for it to drain is sliced so close() is noticed promptly.
+static const s64 kWriteStallMs = 1000;
+static const int kWritePollMs = 10;
+
+SerialTransport::SerialTransport(const std::string& port, int baud_rate, int read_timeout_ms)
+    : port_name_(port), baud_rate_(baud_rate), read_timeout_ms_(read_timeout_ms), rx_(kSerialBuffer) {}
+
+SerialTransport::~SerialTransport() {
+    close();
+}
+
+bool SerialTransport::open() {
+    std::lock_guard<std::mutex> lock(port_mutex_);
+    info() << "GPS: Attempting to open " << port_name_ << " with baud rate " << baud_rate_ << " .." << std::endl;
+
+    if (port_name_.empty()) {
+        error() << "GPS: Check the serial port path of the Piksi!" << std::endl;
+        return false;
+    }
+    release_port(); // never overwrite port_ while it still holds a port
+
+    int result = sp_get_port_by_name(port_name_.c_str(), &port_);
+    if (result != SP_OK) {
+        error() << "GPS: Cannot find provided serial port!" << std::endl;
+        port_ = nullptr;
+        return false;
+    }
+
+    result = sp_open(port_, SP_MODE_READ_WRITE);
+    if (result != SP_OK) {
+        error() << "GPS: Cannot open " << port_name_ << " for reading/writing!" << std::endl;
+        sp_free_port(port_);
+        port_ = nullptr;
+        return false;
+    }
+    info() << "GPS: Port is open" << std::endl;
+
+    if (!setup_port(baud_rate_) || !setup_polling()) {
+        release_port(); // open() is retried on every reconnect attempt
+        return false;
+    }
+    return true;
+}
+
+bool SerialTransport::setup_polling() {
+    if (sp_get_port_handle(port_, &fd_) != SP_OK || fd_ < 0) {
+        error() << "GPS: Cannot get the serial port file descriptor!" << std::endl;
+        return false;
+    }
+    int flags = fcntl(fd_, F_GETFL);
+    if (flags < 0 || fcntl(fd_, F_SETFL, flags | O_NONBLOCK) < 0) {
+        error() << "GPS: Cannot make the serial port non-blocking!" << std::endl;
+        return false;
+    }
+#ifdef __linux__
+    poll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd_;
+    if (poll_fd_ < 0 || epoll_ctl(poll_fd_, EPOLL_CTL_ADD, fd_, &ev) < 0) {
+        error() << "GPS: Cannot set up epoll on the serial port!" << std::endl;
+        return false;
+    }
+#endif
+    head_ = tail_ = 0;
+    return true;
+}
+
+bool SerialTransport::setup_port(int baud) {
+    info() << "GPS: Attempting to configure the serial port..." << std::endl;
+    int result;
+
+    result = sp_set_baudrate(port_, baud);
+    if (result != SP_OK) {
+        error() << "GPS: Cannot set port baud rate!" << std::endl;
+        return false;
+    }
+
+    result = sp_set_flowcontrol(port_, SP_FLOWCONTROL_NONE);
+    if (result != SP_OK) {
+        error() << "GPS: Cannot set flow control!" << std::endl;
+        return false;
+    }
+
+    result = sp_set_bits(port_, 8);
+    if (result != SP_OK) {
+        error() << "GPS: Cannot set data bits!" << std::endl;
+        return false;
+    }
+
+    result = sp_set_parity(port_, SP_PARITY_NONE);
+    if (result != SP_OK) {
+        error() << "GPS: Cannot set parity!" << std::endl;
+        return false;
+    }
+
+    result = sp_set_stopbits(port_, 1);
+    if (result != SP_OK) {
+        error() << "GPS: Cannot set stop bits!" << std::endl;
+        return false;
+    }
+    info() << "GPS: Configuring serial port completed." << std::endl;
+    return true;
+}
+
+bool SerialTransport::set_baud(int baud) {
+    std::lock_guard<std::mutex> lock(port_mutex_);
+    if (!port_) {
+        baud_rate_ = baud;
+        return true;
+    }
+    sp_drain(port_); // let queued output go out at the old rate
+    if (sp_set_baudrate(port_, baud) != SP_OK) {
+        error() << "GPS: Cannot set port baud rate to " << baud << "!" << std::endl;
+        return false;
+    }
+    sp_flush(port_, SP_BUF_INPUT);
+    head_ = tail_ = 0;
+    baud_rate_ = baud;
+    return true;
+}
+
+void SerialTransport::close() {
+    generation_.fetch_add(1); // abandons a write waiting for the port to drain
+    std::lock_guard<std::mutex> lock(port_mutex_);
+    release_port();
+}
+
+// Closes the port and its epoll descriptor; the caller holds port_mutex_.
+void SerialTransport::release_port() {
+    if (poll_fd_ >= 0) {
+        ::close(poll_fd_);
+        poll_fd_ = -1;
+    }
+    fd_ = -1;
+    if (port_) {
+        int result = sp_close(port_);
+        if (result != SP_OK) {
+            error() << "GPS: Cannot close " << port_name_ << " properly!" << std::endl;
+        } else {
+            info() << "GPS: Serial at " << port_name_ << " port closed." << std::endl;
+        }
+        sp_free_port(port_);
+        port_ = nullptr;
+    }
+}
+
+// 1 when the port is readable, 0 on timeout, -1 on error or hangup.
+int SerialTransport::wait_readable() {
+#ifdef __linux__
+    epoll_event ev;
+    int ready = epoll_wait(poll_fd_, &ev, 1, read_timeout_ms_);
+    if (ready > 0 && (ev.events & (EPOLLERR | EPOLLHUP)) && !(ev.events & EPOLLIN)) {
+        return -1;
+    }
+#else
+    pollfd pfd = {fd_, POLLIN, 0};
+    int ready = poll(&pfd, 1, read_timeout_ms_);
+    if (ready > 0 && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) && !(pfd.revents & POLLIN)) {
+        return -1;
+    }
+#endif
+    if (ready < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    return ready > 0 ? 1 : 0;
+}
+
+// Refills the empty receive buffer with whatever the kernel has, waiting up
+// to the read timeout for the first byte.
+s32 SerialTransport::fill() {
+    head_ = tail_ = 0;
+    for (;;) {
+        ssize_t got = ::read(fd_, rx_.data(), rx_.size());
+        if (got > 0) {
+            rx_time_ = host_now();
+            tail_ = static_cast<size_t>(got);
+            stats_.bytes += static_cast<u64>(got);
+            stats_.reads++;
+            return static_cast<s32>(got);
+        }
+        if (got == 0) {
+            return SBP_READ_ERROR; // device went away
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return SBP_READ_ERROR;
+        }
+        int ready = wait_readable();
+        if (ready < 0) {
+            return SBP_READ_ERROR;
+        }
+        if (ready == 0) {
+            stats_.timeouts++;
+            return 0;
+        }
+    }
+}
+
+s32 SerialTransport::read(u8 *buff, u32 n) {
+    if (fd_ < 0) {
+        return SBP_READ_ERROR;
+    }
+    if (head_ == tail_) {
+        s32 got = fill();
+        if (got <= 0) {
+            return got;
+        }
+    }
+    size_t count = std::min<size_t>(n, tail_ - head_);
+    memcpy(buff, rx_.data() + head_, count);
+    head_ += count;
+    return static_cast<s32>(count);
+}
+
+// Writes in non-blocking chunks and waits for the port to drain with
+// port_mutex_ released, so close(), set_baud() and the reader never queue
+// behind a slow UART. A write cut short after a stall has its unsent bytes
+// flushed, so the receiver sees one truncated frame rather than the next
+// frame spliced onto it; after close() there is nothing left to flush.
+s32 SerialTransport::write(const u8 *buff, u32 n) {
+    std::lock_guard<std::mutex> serial(write_mutex_); // whole writes, never interleaved
+    u32 generation = generation_.load();
+    auto stall_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kWriteStallMs);
+    u32 done = 0;
+    bool stalled = false;
+    while (done < n) {
+        int fd;
+        {
+            std::lock_guard<std::mutex> lock(port_mutex_);
+            if (!port_ || generation_.load() != generation) {
+                break; // closed while the link is down, or under this write
+            }
+            int result = sp_nonblocking_write(port_, buff + done, n - done);
+            if (result < 0) {
+                break;
+            }
+            if (result > 0) {
+                done += static_cast<u32>(result);
+                stall_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kWriteStallMs);
+            }
+            fd = fd_;
+        }
+        if (done == n) {
+            break;
+        }
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(stall_deadline -
+                                                                          std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            stalled = true;
+            break;
+        }
+        // A stale fd after a concurrent close() only wakes this early; the
+        // generation check above then ends the write.
+        pollfd pfd = {fd, POLLOUT, 0};
+        poll(&pfd, 1, static_cast<int>(std::min<s64>(left.count(), kWritePollMs)));
+    }
+    if (stalled && done > 0) {
+        std::lock_guard<std::mutex> lock(port_mutex_);
+        if (port_ && generation_.load() == generation) {
+            sp_flush(port_, SP_BUF_OUTPUT);
+        }
+    }
+    if (done == 0 && n > 0) {
+        return SBP_WRITE_ERROR;
+    }
+    return static_cast<s32>(done);
+}
+
+// Time of week (ms) carried by a frame, for the messages that have one.
+static bool frame_tow(u16 msg_type, const u8 *payload, u8 len, u32 *tow) {
+    size_t offset;
+    if (msg_type == SBP_MSG_GPS_TIME) {
+        offset = 2;
+    } else if (msg_type == SBP_MSG_UTC_TIME) {
+        offset = 1;
+    } else if ((msg_type & 0xFF00) == 0x0200) { // navigation messages lead with tow
+        offset = 0;
+    } else {
+        return false;
+    }
+    if (len < offset + sizeof(u32)) {
+        return false;
+    }
+    memcpy(tow, payload + offset, sizeof(u32));
+    return true;
+}
+
+ReplayTransport::ReplayTransport(const std::string& path, bool realtime)
+    : path_(path), realtime_(realtime), buffer_(kReplayChunk) {}
+
+ReplayTransport::~ReplayTransport() {
+    close();
+}
+
+bool ReplayTransport::open() {
+    std::cout << "GPS: Replaying " << (path_ == "-" ? "stdin" : path_)
+              << (realtime_ ? " in real time" : " as fast as possible") << " .." << std::endl;
+
+    file_ = (path_ == "-") ? stdin : std::fopen(path_.c_str(), "rb");
+    if (!file_) {
+        std::cerr << "GPS: Cannot open replay file " << path_ << "!" << std::endl;
+        return false;
+    }
+    file_eof_ = false;
+    head_ = released_ = tail_ = 0;
+    paced_ = false;
+    return true;
+}
+
+void ReplayTransport::close() {
+    if (file_) {
+        if (file_ != stdin) {
+            std::fclose(file_);
+        }
+        file_ = nullptr;
+        std::cout << "GPS: Replay of " << path_ << " closed." << std::endl;
+    }
+}
+
+bool ReplayTransport::eof() const {
+    return !file_ || (file_eof_ && head_ == tail_);
+}
+
+// Make at least n unread bytes available; false if the file ends first.
+bool ReplayTransport::ensure(size_t n) {
+    while (tail_ - head_ < n) {
+        if (file_eof_) {
+            return false;
+        }
+        if (head_ > 0) {
+            memmove(buffer_.data(), buffer_.data() + head_, tail_ - head_);
+            released_ -= head_;
+            tail_ -= head_;
+            head_ = 0;
+        }
+        size_t got = std::fread(buffer_.data() + tail_, 1, buffer_.size() - tail_, file_);
+        if (got == 0) {
+            file_eof_ = true;
+        } else {
+            stats_.bytes += got;
+            stats_.reads++;
+        }
+        tail_ += got;
+    }
+    return true;
+}
+
+// Release the next run of bytes to the parser, sleeping first if pacing requires it.
+bool ReplayTransport::release_next() {
+    if (!ensure(1)) {
+        return false;
+    }
+    if (!realtime_) {
+        released_ = tail_;
+        return true;
+    }
+
+    if (buffer_[head_] != SBP_PREAMBLE) {
+        const void *next = memchr(buffer_.data() + head_, SBP_PREAMBLE, tail_ - head_);
+        released_ = next ? static_cast<const u8 *>(next) - buffer_.data() : tail_;
+        return true;
+    }
+
+    if (!ensure(6) || !ensure(8 + buffer_[head_ + 5])) {
+        released_ = tail_; // truncated frame at the end of the recording
+        return true;
+    }
+    const u8 *frame = buffer_.data() + head_;
+    u16 msg_type = static_cast<u16>(frame[1] | (frame[2] << 8));
+    u8 len = frame[5];
+    u32 tow;
+    if (frame_tow(msg_type, frame + 6, len, &tow)) {
+        pace(tow);
+    }
+    released_ = head_ + 8 + len;
+    return true;
+}
+
+void ReplayTransport::pace(u32 tow) {
+    auto now = std::chrono::steady_clock::now();
+    s64 dt_ms = static_cast<s64>(tow) - base_tow_;
+    if (dt_ms < -kMsPerWeek / 2) {
+        dt_ms += kMsPerWeek; // week rollover
+    }
+    if (!paced_ || dt_ms < 0 || dt_ms > kMaxPaceGapMs) {
+        paced_ = true;
+        base_tow_ = tow;
+        base_time_ = now;
+        return;
+    }
+    std::this_thread::sleep_until(base_time_ + std::chrono::milliseconds(dt_ms));
+}
+
+s32 ReplayTransport::read(u8 *buff, u32 n) {
+    if (!file_) {
+        return SBP_READ_ERROR;
+    }
+    if (head_ == released_) {
+        if (!release_next()) {
+            return 0;
+        }
+        rx_time_ = host_now();
+    }
+    size_t count = std::min<size_t>(n, released_ - head_);
+    memcpy(buff, buffer_.data() + head_, count);
+    head_ += count;
+    return static_cast<s32>(count);
+}
+
+s32 ReplayTransport::write(const u8 *buff, u32 n) {
+    (void)buff;
+    return static_cast<s32>(n); // nothing listens on a recording
+}
+
+} // namespace piksi
@@ -0,0 +1,180 @@
+// Accuracy checks for the geodesy kernels (ctest: geodesy).
+//
+// llh_to_ecef() is checked against points worked out independently; the
+// batch ecef_to_llh() against the iterated scalar reference where that
+// converges, and by round trip over the whole range geodesy.hpp documents,
+// poles and the ~45 km inner limit included; the batch rotations, on every
+// kernel the CPU has, against the scalar ones and by round trip.
+#include "geodesy.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Largest error, in metres, any check allows.
+const double kTolerance = 1e-7;
+
+int failures = 0;
+
+void expect(const std::string& what, double error, double tolerance = kTolerance) {
+    if (!(error <= tolerance)) {
+        std::cerr << "Geodesy: " << what << " is off by " << error << " m (allowed " << tolerance << " m)" << std::endl;
+        failures++;
+    }
+}
+
+double distance(const double a[3], const double b[3]) {
+    return std::hypot(a[0] - b[0], a[1] - b[1], a[2] - b[2]);
+}
+
+struct Points {
+    std::vector<double> a, b, c;
+    explicit Points(size_t n) : a(n), b(n), c(n) {}
+    size_t size() const { return a.size(); }
+};
+
+// Same fixed-seed generator as piksi_bench, so failures reproduce.
+struct Random {
+    unsigned long long state = 0x2545F4914F6CDD1DULL;
+    double uniform(double lo, double hi) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return lo + (hi - lo) * static_cast<double>(state >> 11) / 9007199254740992.0;
+    }
+};
+
+// n points with heights in [h_lo, h_hi]; every fourth within 0.01 degrees of
+// a pole and every sixteenth exactly on one.
+Points random_llh(Random& random, size_t n, double h_lo, double h_hi) {
+    Points llh(n);
+    for (size_t i = 0; i < n; ++i) {
+        double pole = (i % 2) ? 90.0 : -90.0;
+        llh.a[i] = (i % 16 == 0) ? pole : (i % 4 == 0) ? pole - std::copysign(random.uniform(0.0, 0.01), pole)
+                                                        : random.uniform(-90.0, 90.0);
+        llh.b[i] = random.uniform(-180.0, 180.0);
+        llh.c[i] = random.uniform(h_lo, h_hi);
+    }
+    return llh;
+}
+
+void check_known_points() {
+    struct Known {
+        double lat, lon, h;
+        double ecef[3];
+    };
+    // WGS-84: equatorial radius a, polar radius b = a (1 - f).
+    const Known known[] = {
+        {0.0, 0.0, 0.0, {6378137.0, 0.0, 0.0}},
+        {90.0, 0.0, 0.0, {0.0, 0.0, 6356752.314245}},
+        {-90.0, 0.0, -100.0, {0.0, 0.0, -6356652.314245}},
+        {0.0, 90.0, 1000.0, {0.0, 6379137.0, 0.0}},
+        {0.0, 180.0, 0.0, {-6378137.0, 0.0, 0.0}},
+        {45.0, 45.0, 0.0, {3194419.145061, 3194419.145061, 4487348.408866}},
+        {45.0, -135.0, 20200000.0, {-13294419.145061, -13294419.145061, 18770905.388834}},
+    };
+    for (const Known& k : known) {
+        std::string name = "(" + std::to_string(k.lat) + ", " + std::to_string(k.lon) + ", " + std::to_string(k.h) + ")";
+        double ecef[3];
+        piksi::llh_to_ecef(k.lat, k.lon, k.h, ecef);
+        expect("llh_to_ecef " + name, distance(ecef, k.ecef), 1e-6); // the table has micrometres
+        double x, y, z;
+        piksi::llh_to_ecef(&k.lat, &k.lon, &k.h, 1, &x, &y, &z);
+        double batch[3] = {x, y, z};
+        expect("batch llh_to_ecef " + name, distance(batch, k.ecef), 1e-6);
+
+        double lat, lon, h;
+        piksi::ecef_to_llh(&k.ecef[0], &k.ecef[1], &k.ecef[2], 1, &lat, &lon, &h);
+        double back[3];
+        piksi::llh_to_ecef(lat, lon, h, back);
+        expect("batch ecef_to_llh " + name, distance(back, k.ecef), 1e-6);
+        expect("batch ecef_to_llh height " + name, std::fabs(h - k.h), 1e-6);
+    }
+}
+
+// Batch ecef_to_llh against the scalar reference and, for every point, back
+// through llh_to_ecef to where it started.
+void check_ecef_to_llh(const std::string& band, const Points& llh, bool against_reference) {
+    size_t n = llh.size();
+    Points ecef(n), out(n);
+    piksi::llh_to_ecef(llh.a.data(), llh.b.data(), llh.c.data(), n, ecef.a.data(), ecef.b.data(), ecef.c.data());
+    piksi::ecef_to_llh(ecef.a.data(), ecef.b.data(), ecef.c.data(), n, out.a.data(), out.b.data(), out.c.data());
+    double round_trip = 0.0, reference = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double p[3] = {ecef.a[i], ecef.b[i], ecef.c[i]}, back[3];
+        piksi::llh_to_ecef(out.a[i], out.b[i], out.c[i], back);
+        round_trip = std::max(round_trip, distance(back, p));
+        if (against_reference) {
+            double lat, lon, h, ref[3];
+            piksi::ecef_to_llh(p, &lat, &lon, &h);
+            piksi::llh_to_ecef(lat, lon, h, ref);
+            reference = std::max(reference, distance(back, ref));
+        }
+    }
+    expect("batch ecef_to_llh round trip, " + band, round_trip);
+    if (against_reference) {
+        expect("batch ecef_to_llh against the scalar reference, " + band, reference);
+    }
+}
+
+void check_rotations(Random& random) {
+    const size_t n = 4099; // not a multiple of the vector width, so the tails run too
+    Points llh = random_llh(random, n, -1000.0, 50000.0), ecef(n), ref(n), enu(n), back(n);
+    piksi::llh_to_ecef(llh.a.data(), llh.b.data(), llh.c.data(), n, ecef.a.data(), ecef.b.data(), ecef.c.data());
+    piksi::LocalFrame frame = piksi::LocalFrame::at(38.9, -77.0, 10.0);
+
+    double zero[3] = {0.0, 0.0, 0.0}, up[3] = {0.0, 0.0, 100.0}, out[3], expected[3];
+    frame.ecef_to_enu(frame.origin, out);
+    expect("ecef_to_enu of the origin", distance(out, zero));
+    piksi::llh_to_ecef(38.9, -77.0, 110.0, expected);
+    frame.enu_to_ecef(up, out);
+    expect("enu_to_ecef 100 m up", distance(out, expected));
+
+    for (size_t i = 0; i < n; ++i) {
+        double p[3] = {ecef.a[i], ecef.b[i], ecef.c[i]}, q[3];
+        frame.ecef_to_enu(p, q);
+        ref.a[i] = q[0], ref.b[i] = q[1], ref.c[i] = q[2];
+    }
+    const char* best = piksi::set_geodesy_simd(true);
+    std::vector<const char*> kernels{"scalar"};
+    if (std::string(best) != "scalar") {
+        kernels.push_back(best);
+    }
+    for (const char* kernel : kernels) {
+        piksi::set_geodesy_simd(std::string(kernel) != "scalar");
+        frame.ecef_to_enu(ecef.a.data(), ecef.b.data(), ecef.c.data(), n, enu.a.data(), enu.b.data(), enu.c.data());
+        frame.enu_to_ecef(enu.a.data(), enu.b.data(), enu.c.data(), n, back.a.data(), back.b.data(), back.c.data());
+        double worst = 0.0, round_trip = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            worst = std::max(worst, std::hypot(enu.a[i] - ref.a[i], enu.b[i] - ref.b[i], enu.c[i] - ref.c[i]));
+            round_trip = std::max(round_trip,
+                                  std::hypot(back.a[i] - ecef.a[i], back.b[i] - ecef.b[i], back.c[i] - ecef.c[i]));
+        }
+        expect(std::string("batch ecef_to_enu (") + kernel + ") against the scalar one", worst);
+        expect(std::string("batch enu round trip (") + kernel + ")", round_trip);
+    }
+    piksi::set_geodesy_simd(true);
+}
+
+} // namespace
+
+int main() {
+    Random random;
+    const size_t n = 100000;
+    check_known_points();
+    // The iterated reference converges to well below kTolerance down to
+    // 1000 km below the surface; deeper, only the round trip is checked.
+    check_ecef_to_llh("near the surface", random_llh(random, n, -1000.0, 50000.0), true);
+    check_ecef_to_llh("up to GNSS and geostationary orbits", random_llh(random, n, 50000.0, 45000000.0), true);
+    check_ecef_to_llh("down to 1000 km below the surface", random_llh(random, n, -1000000.0, -1000.0), true);
+    check_ecef_to_llh("down to ~50 km from the centre", random_llh(random, n, -6300000.0, -1000000.0), false);
+    check_rotations(random);
+
+    if (failures > 0) {
+        std::cerr << "Geodesy: " << failures << " check(s) failed." << std::endl;
+        return 1;
+    }
+    std::cout << "Geodesy: all checks passed (" << piksi::geodesy_simd() << " kernels)." << std::endl;
+    return 0;
+}